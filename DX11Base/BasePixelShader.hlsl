@@ -43,30 +43,22 @@ struct SpotLight {
 	//-------------------------
 };
 
-cbuffer ExternalData : register(b0) {
+// The fixed lights, list sizes and camera - uploaded once per frame
+cbuffer perFrame : register(b0) {
 	DirectionalLight dirLight_1;
 	
 	AmbientLight ambientLight;
 	
-	PointLight pointLight1;
-	PointLight pointLight2;
-	PointLight pointLight3;
-	PointLight pointLight4;
-
-	PointLight outerPointLight1;
-	PointLight outerPointLight2;
-	PointLight outerPointLight3;
-	PointLight outerPointLight4;
-	PointLight outerPointLight5;
-	PointLight outerPointLight6;
-	PointLight outerPointLight7;
-	PointLight outerPointLight8;
-
-	SpotLight spotLight;
-	
 	float3 cameraPosition;
+	uint pointLightCount;
+	//-------------------------
+	uint spotLightCount;
 };
 
+// Any number of point and spot lights, uploaded whenever the lists change
+StructuredBuffer<PointLight> pointLights : register(t2);
+StructuredBuffer<SpotLight> spotLights : register(t3);
+
 struct VertexToPixel
 {
 
@@ -156,70 +148,21 @@ float4 main(VertexToPixel input) : SV_TARGET
 	//Ambient light
 	float4 ambient = surfaceColor * ambientLight.ambientColor;
 
-	//Point light
-	//point light 1
-	ComputePointLight(input, pointLight1, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-	//point light 2
-	ComputePointLight(input, pointLight2, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-	//point light 3
-	ComputePointLight(input, pointLight3, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-	//point light 4
-	ComputePointLight(input, pointLight4, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	
-	
-	//Outer Point light 1
-	ComputePointLight(input, outerPointLight1, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 2
-	ComputePointLight(input, outerPointLight2, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 3
-	ComputePointLight(input, outerPointLight3, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 4
-	ComputePointLight(input, outerPointLight4, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 5
-	ComputePointLight(input, outerPointLight5, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 6
-	ComputePointLight(input, outerPointLight6, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 7
-	ComputePointLight(input, outerPointLight7, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Outer Point light 8
-	ComputePointLight(input, outerPointLight8, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
-
-	//Spot light
-	ComputeSpotLight(input, spotLight, surfaceColor, D, S);
-	diffuse += D;
-	specular += S;
+	//Point lights
+	for (uint p = 0; p < pointLightCount; p++)
+	{
+		ComputePointLight(input, pointLights[p], surfaceColor, D, S);
+		diffuse += D;
+		specular += S;
+	}
+
+	//Spot lights
+	for (uint s = 0; s < spotLightCount; s++)
+	{
+		ComputeSpotLight(input, spotLights[s], surfaceColor, D, S);
+		diffuse += D;
+		specular += S;
+	}
 
 	//Total light
 	float4 totalLight = diffuse + specular + ambient;
@@ -1,7 +1,12 @@
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
+// Constant Buffers for external (C++) data - one that
+// changes per draw, and one uploaded once per frame
+cbuffer perObject : register(b0)
 {
 	matrix world;
+};
+
+cbuffer perFrame : register(b1)
+{
 	matrix view;
 	matrix projection;
 };
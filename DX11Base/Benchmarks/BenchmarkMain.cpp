@@ -0,0 +1,41 @@
+#include "Benchmarks.h"
+
+#include <cstring>
+
+struct Entry
+{
+	const char* name;
+	void (*run)();
+};
+
+// Only what this platform's headers can build
+static const Entry entries[] =
+{
+	{ "jobs", RunJobSystemBenchmark },
+	{ "sort", RunDrawSorterBenchmark },
+	{ "commands", RunCommandBufferBenchmark },
+#if defined(HAVE_DIRECTXMATH)
+	{ "bvh", RunDynamicBVHBenchmark },
+#endif
+};
+
+// --------------------------------------------------------
+// Runs everything, or only what's named on the command line
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const unsigned int entryCount = sizeof(entries) / sizeof(entries[0]);
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		bool selected = argc < 2;
+		for (int a = 1; a < argc; a++)
+		{
+			if (strcmp(argv[a], entries[i].name) == 0)
+				selected = true;
+		}
+
+		if (selected)
+			entries[i].run();
+	}
+	return 0;
+}
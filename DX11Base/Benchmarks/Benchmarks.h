@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdio>
+
+// --------------------------------------------------------
+// Standalone CPU benchmarks
+//
+// Nothing here opens a window or creates a device, and
+// nothing passes or fails - each one prints its timings.
+// Pass/fail checks belong in Tests.
+// --------------------------------------------------------
+void RunJobSystemBenchmark();
+void RunDrawSorterBenchmark();
+void RunCommandBufferBenchmark();
+
+// These need DirectXMath
+void RunDynamicBVHBenchmark();
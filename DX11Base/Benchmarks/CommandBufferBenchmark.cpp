@@ -0,0 +1,82 @@
+#include "Benchmarks.h"
+#include "../CommandBuffer.h"
+#include "../LinearArena.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Records a frame's worth of typical instanced draws again
+// and again, replaying each onto the null backend
+// --------------------------------------------------------
+void RunCommandBufferBenchmark()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const unsigned int drawCount = 100000;
+	const int iterations = 20;
+
+	// Stand-ins for device objects - the null backend never
+	// looks through them
+	ID3D11InputLayout* layout = (ID3D11InputLayout*)(uintptr_t)0x1000;
+	ID3D11VertexShader* vertexShader = (ID3D11VertexShader*)(uintptr_t)0x2000;
+	ID3D11PixelShader* pixelShader = (ID3D11PixelShader*)(uintptr_t)0x3000;
+	ID3D11Buffer* constantBuffer = (ID3D11Buffer*)(uintptr_t)0x4000;
+	ID3D11Buffer* instanceBuffer = (ID3D11Buffer*)(uintptr_t)0x5000;
+	const unsigned int TriangleList = 4;	// D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+	const unsigned int R32Uint = 42;		// DXGI_FORMAT_R32_UINT
+	unsigned char constants[128] = {};
+
+	LinearArena arena;
+	CommandBuffer commands(&arena);
+	NullCommandBackend backend;
+
+	double recordTotal = 0;
+	double replayTotal = 0;
+	unsigned int spills = 0;
+	for (int n = 0; n <= iterations; n++)
+	{
+		commands.Clear();
+		arena.Reset();
+
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			uintptr_t mesh = 0x10000 + (i / 16) * 16;
+			uintptr_t material = 0x80000 + (i / 64) * 16;
+			commands.RecordBindPipeline(layout, vertexShader, pixelShader, TriangleList);
+			commands.RecordUpdateConstantBuffer(constantBuffer, constants, sizeof(constants));
+			commands.RecordBindConstantBuffer(VertexStage, 0, constantBuffer);
+			commands.RecordBindShaderResource(PixelStage, 0, (ID3D11ShaderResourceView*)material);
+			commands.RecordBindShaderResource(PixelStage, 1, (ID3D11ShaderResourceView*)(material + 8));
+			commands.RecordBindSampler(PixelStage, 0, (ID3D11SamplerState*)(uintptr_t)0x6000);
+			commands.RecordBindVertexBuffer(0, (ID3D11Buffer*)mesh, 48, 0);
+			commands.RecordBindVertexBuffer(1, instanceBuffer, 64, 0);
+			commands.RecordBindIndexBuffer((ID3D11Buffer*)(mesh + 8), R32Uint, 0);
+			commands.RecordDrawIndexedInstanced(36, 1, 0, 0, i);
+		}
+		double recordMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		backend.Reset();
+		start = Clock::now();
+		backend.Execute(commands);
+		double replayMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		// The first run only sizes the arena
+		if (n > 0)
+		{
+			recordTotal += recordMs;
+			replayTotal += replayMs;
+			spills += arena.GetOverflowCount();
+		}
+	}
+
+	double recordMs = recordTotal / iterations;
+	double replayMs = replayTotal / iterations;
+	printf("\nCommand buffer (%u draws x %d iterations)\n", drawCount, iterations);
+	printf("  Record:      %7.3f ms  %7.2f Mdraws/s\n", recordMs, drawCount / recordMs / 1000.0);
+	printf("  Null replay: %7.3f ms  %7.2f Mdraws/s\n", replayMs, drawCount / replayMs / 1000.0);
+	printf("  %u commands, %u draws, %.1f KB of arena, %u heap allocations after warm up\n",
+		commands.GetCount(), backend.GetDrawCount(), arena.GetUsed() / 1024.0, spills);
+}
@@ -0,0 +1,77 @@
+#include "Benchmarks.h"
+#include "../DrawSorter.h"
+#include "../JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// Sorting throughput at 100k draws, against std::sort
+// --------------------------------------------------------
+void RunDrawSorterBenchmark()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const unsigned int drawCount = 100000;
+	const int iterations = 20;
+
+	// Keys shaped like a real frame - a few passes and shaders,
+	// a few hundred materials and meshes, depth all over
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<unsigned int> pass(0, 1), shader(0, 7), material(0, 255), mesh(0, 511);
+	std::uniform_real_distribution<float> depth(0.1f, 100.0f);
+
+	std::vector<unsigned long long> sourceKeys(drawCount);
+	for (unsigned int i = 0; i < drawCount; i++)
+		sourceKeys[i] = DrawSorter::MakeKey(pass(rng), shader(rng), material(rng), mesh(rng), depth(rng), 0.1f, 100.0f);
+
+	printf("\nDraw key sort (%u draws x %d iterations)\n", drawCount, iterations);
+
+	// Baseline - comparison sort of key/index pairs
+	std::vector<std::pair<unsigned long long, unsigned int>> pairs(drawCount);
+	Clock::time_point start = Clock::now();
+	for (int n = 0; n < iterations; n++)
+	{
+		for (unsigned int i = 0; i < drawCount; i++)
+			pairs[i] = std::make_pair(sourceKeys[i], i);
+		std::sort(pairs.begin(), pairs.end());
+	}
+	double baseline = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+	printf("  std::sort:   %7.3f ms  %7.2f Mdraws/s\n", baseline, drawCount / baseline / 1000.0);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads);
+		DrawSorter sorter;
+		std::vector<unsigned long long> keys;
+		std::vector<unsigned int> values(drawCount);
+
+		double total = 0;
+		bool sorted = true;
+		for (int n = 0; n <= iterations; n++)
+		{
+			keys = sourceKeys;
+			for (unsigned int i = 0; i < drawCount; i++)
+				values[i] = i;
+
+			start = Clock::now();
+			sorter.Sort(keys, values, jobs);
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			// The first run only warms up threads and scratch memory
+			if (n > 0) total += ms;
+			sorted = sorted && std::is_sorted(keys.begin(), keys.end()) && keys[0] == sourceKeys[values[0]];
+		}
+
+		double ms = total / iterations;
+		printf("  %2u threads:  %7.3f ms  %7.2f Mdraws/s  %5.2fx%s\n", threads, ms, drawCount / ms / 1000.0, baseline / ms, sorted ? "" : "  NOT SORTED");
+	}
+}
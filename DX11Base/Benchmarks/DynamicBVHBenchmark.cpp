@@ -0,0 +1,135 @@
+#include "Benchmarks.h"
+#include "../DynamicBVH.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------------
+// Benchmark - random unit-ish boxes spread at a constant
+// density, moved a little each "frame", then queried with
+// spheres, rays and a frustum-sized convex volume
+// --------------------------------------------------------
+void RunDynamicBVHBenchmark()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	auto ms = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	const int sizes[3] = { 10000, 100000, 1000000 };
+	const int queryCount = 1000;
+	const int scanCount = 20;
+
+	printf("\nDynamic BVH benchmark (build times in ms, query times in us per query)\n");
+	printf("  %8s %9s %9s %9s %7s %9s %9s %9s %9s\n", "boxes", "insert", "rebuild", "move 10%", "height", "sphere", "scan", "ray", "volume");
+
+	for (int s = 0; s < 3; s++)
+	{
+		int count = sizes[s];
+		float worldSize = 4.0f * powf((float)count, 1.0f / 3.0f);
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(0.0f, worldSize);
+		std::uniform_real_distribution<float> size(0.25f, 1.0f);
+		std::uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+
+		std::vector<XMFLOAT3> boxMin(count), boxMax(count);
+		for (int i = 0; i < count; i++)
+		{
+			boxMin[i] = XMFLOAT3(position(rng), position(rng), position(rng));
+			float extent = size(rng);
+			boxMax[i] = XMFLOAT3(boxMin[i].x + extent, boxMin[i].y + extent, boxMin[i].z + extent);
+		}
+
+		DynamicBVH tree(0.1f, count * 2);
+		std::vector<int> proxies(count);
+
+		// Incremental build
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++)
+			proxies[i] = tree.Insert(boxMin[i], boxMax[i], i);
+		double insertTime = ms(start);
+
+		start = Clock::now();
+		tree.Rebuild();
+		double rebuildTime = ms(start);
+
+		// One frame of 10% of everything moving a little
+		start = Clock::now();
+		for (int i = 0; i < count; i += 10)
+		{
+			XMFLOAT3 d(jitter(rng), jitter(rng), jitter(rng));
+			boxMin[i] = XMFLOAT3(boxMin[i].x + d.x, boxMin[i].y + d.y, boxMin[i].z + d.z);
+			boxMax[i] = XMFLOAT3(boxMax[i].x + d.x, boxMax[i].y + d.y, boxMax[i].z + d.z);
+			tree.Move(proxies[i], boxMin[i], boxMax[i]);
+		}
+		tree.Optimize();
+		double moveTime = ms(start);
+
+		// Sphere queries, against a brute force scan of the same spheres.
+		// The tree tests fat boxes, so it may only ever find more.
+		std::vector<XMFLOAT3> centers(queryCount);
+		for (int q = 0; q < queryCount; q++)
+			centers[q] = XMFLOAT3(position(rng), position(rng), position(rng));
+
+		size_t sphereHits = 0;
+		start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+			tree.QuerySphere(centers[q], 4.0f, [&sphereHits](unsigned int) { sphereHits++; });
+		double sphereTime = ms(start);
+
+		// The scan is far too slow to run every query through
+		size_t scanHits = 0;
+		size_t sphereScanHits = 0;
+		for (int q = 0; q < scanCount; q++)
+			tree.QuerySphere(centers[q], 4.0f, [&sphereScanHits](unsigned int) { sphereScanHits++; });
+
+		start = Clock::now();
+		for (int q = 0; q < scanCount; q++)
+		{
+			XMVECTOR c = XMLoadFloat3(&centers[q]);
+			for (int i = 0; i < count; i++)
+			{
+				XMVECTOR offset = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat3(&boxMin[i]), c), XMVectorSubtract(c, XMLoadFloat3(&boxMax[i]))), XMVectorZero());
+				if (XMVectorGetX(XMVector3LengthSq(offset)) <= 16.0f)
+					scanHits++;
+			}
+		}
+		double scanTime = ms(start);
+
+		// Rays across the whole world, stopping at the first box entered
+		start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			XMFLOAT3 direction(jitter(rng), jitter(rng), jitter(rng));
+			XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+			tree.QueryRay(centers[q], direction, worldSize, [](unsigned int, float enter) { return enter; });
+		}
+		double rayTime = ms(start);
+
+		// A frustum-sized convex volume - a box with 6 inward planes
+		// covering roughly a tenth of the world along each axis
+		size_t volumeHits = 0;
+		start = Clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			XMFLOAT3 c = centers[q];
+			float r = worldSize * 0.05f;
+			XMFLOAT4 planes[6] =
+			{
+				XMFLOAT4(1, 0, 0, -(c.x - r)), XMFLOAT4(-1, 0, 0, c.x + r),
+				XMFLOAT4(0, 1, 0, -(c.y - r)), XMFLOAT4(0, -1, 0, c.y + r),
+				XMFLOAT4(0, 0, 1, -(c.z - r)), XMFLOAT4(0, 0, -1, c.z + r)
+			};
+			tree.QueryPlanes(planes, 6, [&volumeHits](unsigned int) { volumeHits++; });
+		}
+		double volumeTime = ms(start);
+
+		double us = 1000.0 / queryCount;
+		printf("  %8d %9.2f %9.2f %9.3f %7d %9.2f %9.1f %9.2f %9.2f%s\n",
+			count, insertTime, rebuildTime, moveTime, tree.GetHeight(),
+			sphereTime * us, scanTime * 1000.0 / scanCount, rayTime * us, volumeTime * us,
+			sphereScanHits >= scanHits ? "" : "  (MISSED HITS)");
+	}
+}
@@ -0,0 +1,60 @@
+#include "Benchmarks.h"
+#include "../JobSystem.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Scaling benchmark - transforms a large batch of points
+// with every thread count from 1 to the hardware count
+// --------------------------------------------------------
+void RunJobSystemBenchmark()
+{
+	const unsigned int itemCount = 1 << 20;
+	const int iterations = 8;
+	std::vector<float> data(itemCount * 4, 1.0f);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+
+	double singleThreadRate = 0;
+	printf("\nJob system scaling (%u items x %d iterations)\n", itemCount, iterations);
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem jobs(threads);
+		float* points = &data[0];
+
+		auto work = [points](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				float* p = points + i * 4;
+				for (int k = 0; k < 16; k++)
+				{
+					float x = p[0] * 0.99f + p[1] * 0.01f;
+					float y = p[1] * 0.99f - p[0] * 0.01f;
+					p[0] = x; p[1] = y;
+					p[2] = std::sqrt(x * x + y * y);
+				}
+			}
+		};
+
+		// Warm up the threads and caches first
+		jobs.ParallelFor(itemCount, 0, work);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			jobs.ParallelFor(itemCount, 0, work);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		double rate = (double)itemCount * iterations / ms;
+		if (threads == 1) singleThreadRate = rate;
+
+		printf("  %2u threads: %8.2f ms  %10.0f items/ms  %5.2fx\n", threads, ms, rate, rate / singleThreadRate);
+	}
+}
@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "FrustumPlanes.h"
 #include <Windows.h>
 
 using namespace DirectX;
@@ -14,6 +15,9 @@ Camera::Camera(float x, float y, float z)
 
 	XMStoreFloat4x4(&viewMatrix, XMMatrixIdentity());
 	XMStoreFloat4x4(&projMatrix, XMMatrixIdentity());
+
+	viewDirty = true;
+	frustumDirty = true;
 }
 
 // Nothing to really do
@@ -29,6 +33,7 @@ void Camera::MoveRelative(float x, float y, float z)
 
 	// Move in that direction
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
+	viewDirty = true;
 }
 
 // Moves the camera in world space (not local space)
@@ -38,6 +43,7 @@ void Camera::MoveAbsolute(float x, float y, float z)
 	position.x += x;
 	position.y += y;
 	position.z += z;
+	viewDirty = true;
 }
 
 // Rotate on the X and/or Y axis
@@ -52,6 +58,7 @@ void Camera::Rotate(float x, float y)
 
 	// Recreate the quaternion
 	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(xRotation, yRotation, 0));
+	viewDirty = true;
 }
 
 // Camera's update, which looks for key presses
@@ -79,10 +86,12 @@ void Camera::Update(float dt)
 		xRotation = 0;
 		xRotation = 0;
 		XMStoreFloat4(&rotation, XMQuaternionIdentity());
+		viewDirty = true;
 	}
 
-	// Update the view every frame - could be optimized
-	UpdateViewMatrix();
+	// Only rebuild the view if something moved
+	if (viewDirty)
+		UpdateViewMatrix();
 }
 
 // Creates a new view matrix based on current position and orientation
@@ -98,6 +107,8 @@ void Camera::UpdateViewMatrix()
 		XMVectorSet(0, 1, 0, 0));
 
 	XMStoreFloat4x4(&viewMatrix, XMMatrixTranspose(view));
+	viewDirty = false;
+	frustumDirty = true;
 }
 
 // Updates the projection matrix
@@ -109,4 +120,21 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 		0.1f,				// Near clip plane distance
 		100.0f);			// Far clip plane distance
 	XMStoreFloat4x4(&projMatrix, XMMatrixTranspose(P)); // Transpose for HLSL!
+	frustumDirty = true;
+}
+
+// Returns the frustum planes, rebuilding them if the view
+// or projection changed since the last call
+const XMFLOAT4* Camera::GetFrustumPlanes()
+{
+	if (frustumDirty)
+	{
+		// Stored matrices are transposed, so undo that first
+		XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+		XMMATRIX proj = XMMatrixTranspose(XMLoadFloat4x4(&projMatrix));
+		ExtractFrustumPlanes(XMMatrixMultiply(view, proj), frustumPlanes);
+		frustumDirty = false;
+	}
+
+	return frustumPlanes;
 }
@@ -23,6 +23,11 @@ public:
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
 
+	// The six planes (left, right, bottom, top, near, far) bounding
+	// what the camera can see, with normals pointing inward.  Only
+	// recalculated after the camera has actually changed.
+	const DirectX::XMFLOAT4* GetFrustumPlanes();
+
 private:
 	// Camera matrices
 	DirectX::XMFLOAT4X4 viewMatrix;
@@ -34,5 +39,10 @@ private:
 	DirectX::XMFLOAT4 rotation;
 	float xRotation;
 	float yRotation;
+
+	// Cached frustum, and what needs rebuilding
+	DirectX::XMFLOAT4 frustumPlanes[6];
+	bool viewDirty;
+	bool frustumDirty;
 };
 
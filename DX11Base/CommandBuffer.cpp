@@ -0,0 +1,161 @@
+#include "CommandBuffer.h"
+
+#include <cstring>
+
+CommandBuffer::CommandBuffer(LinearArena* arena)
+{
+	this->arena = arena;
+	first = 0;
+	last = 0;
+	count = 0;
+}
+
+template <typename T>
+T* CommandBuffer::Append(CommandType type)
+{
+	T* command = arena->Allocate<T>();
+	command->type = type;
+	command->next = 0;
+
+	if (last)
+		last->next = command;
+	else
+		first = command;
+	last = command;
+	count++;
+	return command;
+}
+
+void CommandBuffer::RecordBindPipeline(ID3D11InputLayout* inputLayout, ID3D11VertexShader* vertexShader, ID3D11PixelShader* pixelShader, unsigned int topology)
+{
+	BindPipeline* command = Append<BindPipeline>(BindPipelineCommand);
+	command->inputLayout = inputLayout;
+	command->vertexShader = vertexShader;
+	command->pixelShader = pixelShader;
+	command->topology = topology;
+}
+
+void CommandBuffer::RecordBindVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+{
+	BindVertexBuffer* command = Append<BindVertexBuffer>(BindVertexBufferCommand);
+	command->slot = slot;
+	command->buffer = buffer;
+	command->stride = stride;
+	command->offset = offset;
+}
+
+void CommandBuffer::RecordBindIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	BindIndexBuffer* command = Append<BindIndexBuffer>(BindIndexBufferCommand);
+	command->buffer = buffer;
+	command->format = format;
+	command->offset = offset;
+}
+
+void CommandBuffer::RecordBindConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer)
+{
+	BindResource<ID3D11Buffer>* command = Append<BindResource<ID3D11Buffer>>(BindConstantBufferCommand);
+	command->stage = stage;
+	command->slot = slot;
+	command->resource = buffer;
+}
+
+void CommandBuffer::RecordBindShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	BindResource<ID3D11ShaderResourceView>* command = Append<BindResource<ID3D11ShaderResourceView>>(BindShaderResourceCommand);
+	command->stage = stage;
+	command->slot = slot;
+	command->resource = srv;
+}
+
+void CommandBuffer::RecordBindSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler)
+{
+	BindResource<ID3D11SamplerState>* command = Append<BindResource<ID3D11SamplerState>>(BindSamplerCommand);
+	command->stage = stage;
+	command->slot = slot;
+	command->resource = sampler;
+}
+
+void CommandBuffer::RecordUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size)
+{
+	// The caller's copy will have changed by the time this is replayed
+	void* copy = arena->Allocate(size);
+	memcpy(copy, data, size);
+
+	UpdateConstantBuffer* command = Append<UpdateConstantBuffer>(UpdateConstantBufferCommand);
+	command->buffer = buffer;
+	command->data = copy;
+	command->size = size;
+}
+
+void* CommandBuffer::RecordUpdateConstantBuffer(ID3D11Buffer* buffer, unsigned int size)
+{
+	void* data = arena->Allocate(size);
+
+	UpdateConstantBuffer* command = Append<UpdateConstantBuffer>(UpdateConstantBufferCommand);
+	command->buffer = buffer;
+	command->data = data;
+	command->size = size;
+	return data;
+}
+
+void CommandBuffer::RecordDraw(unsigned int vertexCount, unsigned int startVertex)
+{
+	Draw* command = Append<Draw>(DrawCommand);
+	command->vertexCount = vertexCount;
+	command->startVertex = startVertex;
+}
+
+void CommandBuffer::RecordDrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	RecordDrawIndexedInstanced(indexCount, 0, startIndex, baseVertex, 0);
+}
+
+void CommandBuffer::RecordDrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	DrawIndexed* command = Append<DrawIndexed>(DrawIndexedCommand);
+	command->indexCount = indexCount;
+	command->instanceCount = instanceCount;
+	command->startIndex = startIndex;
+	command->baseVertex = baseVertex;
+	command->startInstance = startInstance;
+}
+
+void CommandBuffer::Clear()
+{
+	first = 0;
+	last = 0;
+	count = 0;
+}
+
+// --------------------------------------------------------
+// Null backend
+// --------------------------------------------------------
+void NullCommandBackend::Execute(const CommandBuffer& commands)
+{
+	for (const CommandBuffer::Command* command = commands.GetFirst(); command; command = command->next)
+	{
+		commandCounts[command->type]++;
+
+		if (command->type == CommandBuffer::UpdateConstantBufferCommand)
+		{
+			constantBytes += static_cast<const CommandBuffer::UpdateConstantBuffer*>(command)->size;
+		}
+		else if (command->type == CommandBuffer::DrawCommand)
+		{
+			vertices += static_cast<const CommandBuffer::Draw*>(command)->vertexCount;
+		}
+		else if (command->type == CommandBuffer::DrawIndexedCommand)
+		{
+			const CommandBuffer::DrawIndexed* draw = static_cast<const CommandBuffer::DrawIndexed*>(command);
+			vertices += (unsigned long long)draw->indexCount * (draw->instanceCount ? draw->instanceCount : 1);
+		}
+	}
+}
+
+void NullCommandBackend::Reset()
+{
+	memset(commandCounts, 0, sizeof(commandCounts));
+	vertices = 0;
+	constantBytes = 0;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "LinearArena.h"
+#include "ShaderStage.h"
+
+// Commands only ever hold these as pointers, so recording and the
+// null backend build without the D3D headers
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11SamplerState;
+struct ID3D11ShaderResourceView;
+struct ID3D11VertexShader;
+
+// --------------------------------------------------------
+// API agnostic list of rendering commands
+//
+// Render records what it wants drawn - pipeline binds,
+// resource binds, constant buffer contents and draws - as
+// small plain structs, and a Backend plays them back later.
+// The D3D11 backend (D3D11CommandBackend.h) replays them onto
+// a real context, and the null backend only counts them, so
+// recording and submission can be tested and measured headless.
+//
+// Every command, and any constant buffer data it carries, is
+// bump allocated from a LinearArena, so recording never
+// touches the heap.  Commands are chained through a next
+// pointer, which keeps the order even if the arena has to
+// spill into a second block.  Clear() the buffer before the
+// arena is Reset().
+//
+// Render targets, viewports, clears and the fixed function
+// states are still set per pass, outside any buffer.
+// --------------------------------------------------------
+class CommandBuffer
+{
+public:
+	enum CommandType
+	{
+		BindPipelineCommand,
+		BindVertexBufferCommand,
+		BindIndexBufferCommand,
+		BindConstantBufferCommand,
+		BindShaderResourceCommand,
+		BindSamplerCommand,
+		UpdateConstantBufferCommand,
+		DrawCommand,
+		DrawIndexedCommand,
+		CommandTypeCount
+	};
+
+	struct Command
+	{
+		CommandType type;
+		const Command* next;
+	};
+
+	struct BindPipeline : Command
+	{
+		ID3D11InputLayout* inputLayout;
+		ID3D11VertexShader* vertexShader;
+		ID3D11PixelShader* pixelShader;		// Null for depth only passes
+		unsigned int topology;				// D3D11_PRIMITIVE_TOPOLOGY
+	};
+
+	struct BindVertexBuffer : Command
+	{
+		unsigned int slot;
+		ID3D11Buffer* buffer;
+		unsigned int stride;
+		unsigned int offset;
+	};
+
+	struct BindIndexBuffer : Command
+	{
+		ID3D11Buffer* buffer;
+		unsigned int format;		// DXGI_FORMAT
+		unsigned int offset;
+	};
+
+	// Constant buffers, SRVs and samplers
+	template <typename T>
+	struct BindResource : Command
+	{
+		ShaderStage stage;
+		unsigned int slot;
+		T* resource;
+	};
+
+	struct UpdateConstantBuffer : Command
+	{
+		ID3D11Buffer* buffer;
+		const void* data;		// Copied into the arena when recorded
+		unsigned int size;
+	};
+
+	struct Draw : Command
+	{
+		unsigned int vertexCount;
+		unsigned int startVertex;
+	};
+
+	// A plain indexed draw when instanceCount is zero
+	struct DrawIndexed : Command
+	{
+		unsigned int indexCount;
+		unsigned int instanceCount;
+		unsigned int startIndex;
+		int baseVertex;
+		unsigned int startInstance;
+	};
+
+	// Plays a whole buffer back, in order
+	class Backend
+	{
+	public:
+		virtual ~Backend() {}
+		virtual void Execute(const CommandBuffer& commands) = 0;
+	};
+
+	CommandBuffer(LinearArena* arena);
+
+	void RecordBindPipeline(ID3D11InputLayout* inputLayout, ID3D11VertexShader* vertexShader, ID3D11PixelShader* pixelShader, unsigned int topology);
+	void RecordBindVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+	void RecordBindIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+	void RecordBindConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer);
+	void RecordBindShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* srv);
+	void RecordBindSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler);
+	void RecordUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size);
+
+	// Same, but hands back the size bytes for the caller to fill
+	// in, which must happen before the buffer is replayed
+	void* RecordUpdateConstantBuffer(ID3D11Buffer* buffer, unsigned int size);
+	void RecordDraw(unsigned int vertexCount, unsigned int startVertex);
+	void RecordDrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void RecordDrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	// Forgets the commands - the arena keeps their memory until it's reset
+	void Clear();
+
+	const Command* GetFirst() const { return first; }
+	unsigned int GetCount() const { return count; }
+	bool IsEmpty() const { return count == 0; }
+
+private:
+	LinearArena* arena;
+	Command* first;
+	Command* last;
+	unsigned int count;
+
+	template <typename T>
+	T* Append(CommandType type);
+};
+
+// --------------------------------------------------------
+// Replays nothing - just counts what it was given, for tests
+// and CPU benchmarks without a device
+// --------------------------------------------------------
+class NullCommandBackend : public CommandBuffer::Backend
+{
+public:
+	NullCommandBackend() { Reset(); }
+
+	void Execute(const CommandBuffer& commands);
+	void Reset();
+
+	unsigned int GetCommandCount(CommandBuffer::CommandType type) const { return commandCounts[type]; }
+	unsigned int GetDrawCount() const { return commandCounts[CommandBuffer::DrawCommand] + commandCounts[CommandBuffer::DrawIndexedCommand]; }
+	unsigned long long GetPrimitiveVertexCount() const { return vertices; }
+	unsigned long long GetConstantBytes() const { return constantBytes; }
+
+private:
+	unsigned int commandCounts[CommandBuffer::CommandTypeCount];
+	unsigned long long vertices;		// Vertices or indices, times instances
+	unsigned long long constantBytes;
+};
@@ -0,0 +1,80 @@
+#include "D3D11CommandBackend.h"
+
+D3D11CommandBackend::D3D11CommandBackend(ID3D11DeviceContext* context, StateCache* stateCache)
+{
+	this->context = context;
+	this->stateCache = stateCache;
+}
+
+void D3D11CommandBackend::Execute(const CommandBuffer& commands)
+{
+	for (const CommandBuffer::Command* command = commands.GetFirst(); command; command = command->next)
+	{
+		switch (command->type)
+		{
+		case CommandBuffer::BindPipelineCommand:
+		{
+			const CommandBuffer::BindPipeline* bind = static_cast<const CommandBuffer::BindPipeline*>(command);
+			stateCache->SetInputLayout(bind->inputLayout);
+			stateCache->SetVertexShader(bind->vertexShader);
+			stateCache->SetPixelShader(bind->pixelShader);
+			stateCache->SetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)bind->topology);
+			break;
+		}
+		case CommandBuffer::BindVertexBufferCommand:
+		{
+			const CommandBuffer::BindVertexBuffer* bind = static_cast<const CommandBuffer::BindVertexBuffer*>(command);
+			stateCache->SetVertexBuffer(bind->slot, bind->buffer, bind->stride, bind->offset);
+			break;
+		}
+		case CommandBuffer::BindIndexBufferCommand:
+		{
+			const CommandBuffer::BindIndexBuffer* bind = static_cast<const CommandBuffer::BindIndexBuffer*>(command);
+			stateCache->SetIndexBuffer(bind->buffer, (DXGI_FORMAT)bind->format, bind->offset);
+			break;
+		}
+		case CommandBuffer::BindConstantBufferCommand:
+		{
+			const CommandBuffer::BindResource<ID3D11Buffer>* bind = static_cast<const CommandBuffer::BindResource<ID3D11Buffer>*>(command);
+			stateCache->SetConstantBuffer(bind->stage, bind->slot, bind->resource);
+			break;
+		}
+		case CommandBuffer::BindShaderResourceCommand:
+		{
+			const CommandBuffer::BindResource<ID3D11ShaderResourceView>* bind = static_cast<const CommandBuffer::BindResource<ID3D11ShaderResourceView>*>(command);
+			stateCache->SetShaderResource(bind->stage, bind->slot, bind->resource);
+			break;
+		}
+		case CommandBuffer::BindSamplerCommand:
+		{
+			const CommandBuffer::BindResource<ID3D11SamplerState>* bind = static_cast<const CommandBuffer::BindResource<ID3D11SamplerState>*>(command);
+			stateCache->SetSampler(bind->stage, bind->slot, bind->resource);
+			break;
+		}
+		case CommandBuffer::UpdateConstantBufferCommand:
+		{
+			const CommandBuffer::UpdateConstantBuffer* update = static_cast<const CommandBuffer::UpdateConstantBuffer*>(command);
+			context->UpdateSubresource(update->buffer, 0, 0, update->data, 0, 0);
+			stateCache->CountConstantUpload(update->size);
+			break;
+		}
+		case CommandBuffer::DrawCommand:
+		{
+			const CommandBuffer::Draw* draw = static_cast<const CommandBuffer::Draw*>(command);
+			context->Draw(draw->vertexCount, draw->startVertex);
+			break;
+		}
+		case CommandBuffer::DrawIndexedCommand:
+		{
+			const CommandBuffer::DrawIndexed* draw = static_cast<const CommandBuffer::DrawIndexed*>(command);
+			if (draw->instanceCount == 0)
+				context->DrawIndexed(draw->indexCount, draw->startIndex, draw->baseVertex);
+			else
+				context->DrawIndexedInstanced(draw->indexCount, draw->instanceCount, draw->startIndex, draw->baseVertex, draw->startInstance);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
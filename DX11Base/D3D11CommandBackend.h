@@ -0,0 +1,23 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "CommandBuffer.h"
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Replays commands onto a device context.  Binds go through
+// the state cache, so repeats are still dropped.
+// --------------------------------------------------------
+class D3D11CommandBackend : public CommandBuffer::Backend
+{
+public:
+	D3D11CommandBackend(ID3D11DeviceContext* context, StateCache* stateCache);
+	void SetContext(ID3D11DeviceContext* context) { this->context = context; }
+
+	void Execute(const CommandBuffer& commands);
+
+private:
+	ID3D11DeviceContext* context;
+	StateCache* stateCache;
+};
@@ -2,6 +2,7 @@
 
 #include <WindowsX.h>
 #include <sstream>
+#include <cassert>
 
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
@@ -57,6 +58,18 @@ DXCore::DXCore(
 	backBufferRTV = 0;
 	depthStencilView = 0;
 
+	// Variable timestep until asked otherwise
+	SetFixedTimeStep(false);
+	interpolationAlpha = 1.0f;
+	accumulator = 0.0;
+	simulationTime = 0.0;
+
+	// Everything on one thread by default
+	useRenderThread = false;
+	renderThreadRunning = false;
+	framesPublished = 0;
+	framesDrawn = 0;
+
 	// Query performance counter for accurate timing information
 	__int64 perfFreq;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
@@ -367,23 +380,168 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			// Start or stop the render thread if the mode changed
+			if (useRenderThread != renderThread.joinable())
+			{
+				if (useRenderThread) StartRenderThread();
+				else StopRenderThread();
+			}
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if (titleBarStats)
 				UpdateTitleBarStats();
 
 			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			if (useFixedTimeStep)
+			{
+				// Bank this frame's time, but never more than a few ticks'
+				// worth, so one slow frame can't snowball into a spiral of death
+				accumulator += deltaTime;
+				if (accumulator > fixedTimeStep * maxTicksPerFrame)
+					accumulator = fixedTimeStep * maxTicksPerFrame;
+
+				// Simulate in whole ticks
+				while (accumulator >= fixedTimeStep)
+				{
+					simulationTime += fixedTimeStep;
+					Update(fixedTimeStep, (float)simulationTime);
+					accumulator -= fixedTimeStep;
+				}
+
+				// Whatever is left over is how far into the next tick we are
+				interpolationAlpha = (float)(accumulator / fixedTimeStep);
+			}
+			else
+			{
+				Update(deltaTime, totalTime);
+				interpolationAlpha = 1.0f;
+			}
+
+			PublishFrame(deltaTime, totalTime);
+
+			if (renderThread.joinable())
+			{
+				// Tell the render thread there's a new frame, then stay
+				// at most one frame ahead of it so the next update
+				// overlaps with drawing this one
+				std::unique_lock<std::mutex> lock(frameMutex);
+				unsigned int published = framesPublished.fetch_add(1) + 1;
+				framePublishedCondition.notify_one();
+				frameDrawnCondition.wait(lock, [this, published]() { return published - framesDrawn.load() <= 1; });
+			}
+			else
+			{
+				Draw(deltaTime, totalTime);
+			}
 		}
 	}
 
+	// The render thread has to be gone before anything it uses is
+	StopRenderThread();
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return msg.wParam;
 }
 
 
+// --------------------------------------------------------
+// Launches the render thread, which takes over the immediate
+// context and Present() until StopRenderThread()
+// --------------------------------------------------------
+void DXCore::StartRenderThread()
+{
+	if (renderThread.joinable())
+		return;
+
+	renderThreadRunning = true;
+	renderThread = std::thread(&DXCore::RenderThreadLoop, this);
+}
+
+// --------------------------------------------------------
+// Finishes the frame being drawn (if any) and joins the
+// render thread, handing the context back to this thread
+// --------------------------------------------------------
+void DXCore::StopRenderThread()
+{
+	if (!renderThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+		renderThreadRunning = false;
+	}
+	framePublishedCondition.notify_one();
+	renderThread.join();
+
+	// Anything published but not drawn is simply dropped
+	framesDrawn.store(framesPublished.load());
+}
+
+// --------------------------------------------------------
+// Draws each newly published frame as soon as it shows up
+// --------------------------------------------------------
+void DXCore::RenderThreadLoop()
+{
+	// Give this thread its own job queue so Draw() can use jobs too.
+	// It would still work through the shared queue without one,
+	// but the slots are sized for exactly this.
+	bool registered = jobSystem.RegisterExternalThread();
+	assert(registered && "Out of job system slots for the render thread");
+	(void)registered;
+
+	__int64 lastDrawTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&lastDrawTime);
+
+	for (;;)
+	{
+		// Sleep until the game thread has something new
+		unsigned int published;
+		{
+			std::unique_lock<std::mutex> lock(frameMutex);
+			framePublishedCondition.wait(lock, [this]() { return framesPublished.load() != framesDrawn.load() || !renderThreadRunning; });
+			if (!renderThreadRunning)
+				break;
+			published = framesPublished.load();
+		}
+
+		// The render thread keeps its own clock
+		__int64 now;
+		QueryPerformanceCounter((LARGE_INTEGER*)&now);
+		float drawDelta = (float)((now - lastDrawTime) * perfCounterSeconds);
+		float drawTotal = (float)((now - startTime) * perfCounterSeconds);
+		lastDrawTime = now;
+
+		Draw(drawDelta, drawTotal);
+
+		{
+			std::lock_guard<std::mutex> lock(frameMutex);
+			framesDrawn.store(published);
+		}
+		frameDrawnCondition.notify_one();
+	}
+
+	jobSystem.UnregisterExternalThread();
+}
+
+
+// --------------------------------------------------------
+// Switches between variable and fixed-timestep updates
+//
+// enabled			- Run Update() at a fixed rate?
+// ticksPerSecond	- Simulation rate when enabled
+// maxTicksPerFrame - Most ticks run in one frame before
+//					  the simulation is allowed to fall behind
+// --------------------------------------------------------
+void DXCore::SetFixedTimeStep(bool enabled, float ticksPerSecond, int maxTicksPerFrame)
+{
+	this->useFixedTimeStep = enabled;
+	this->fixedTimeStep = 1.0f / max(ticksPerSecond, 1.0f);
+	this->maxTicksPerFrame = max(maxTicksPerFrame, 1);
+}
+
+
 // --------------------------------------------------------
 // Sends an OS-level Quit message to our process, which
 // will be handled by our message processing function
@@ -444,7 +602,8 @@ void DXCore::UpdateTitleBarStats()
 		"    Width: " << width <<
 		"    Height: " << height <<
 		"    FPS: " << fpsFrameCount <<
-		"    Frame Time: " << mspf << "ms";
+		"    Frame Time: " << mspf << "ms" <<
+		GetDebugStats();
 
 	// Append the version of DirectX the app is using
 	switch (dxFeatureLevel)
@@ -540,9 +699,14 @@ LRESULT DXCore::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		height = HIWORD(lParam);
 
 		// If DX is initialized, resize 
-		// our required buffers
+		// our required buffers.  The render thread
+		// is stopped first since it owns the context,
+		// and the game loop restarts it next frame.
 		if (device)
+		{
+			StopRenderThread();
 			OnResize();
+		}
 
 		return 0;
 
@@ -3,6 +3,12 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "JobSystem.h"
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
@@ -43,6 +49,15 @@ public:
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Called on the game thread once per frame, after Update() and
+	// before that frame is drawn.  In render thread mode this is the
+	// place to copy whatever Draw() needs, since Draw() runs on the
+	// render thread while the next Update() is already under way.
+	virtual void PublishFrame(float deltaTime, float totalTime) { }
+
+	// Extra text for the title bar stats, refreshed once a second
+	virtual std::string GetDebugStats() { return std::string(); }
+
 	// Convenience methods for handling mouse input, since we
 	// can easily grab mouse input from OS-level messages
 	virtual void OnMouseDown(WPARAM buttonState, int x, int y) { }
@@ -71,6 +86,25 @@ protected:
 
 	D3D11_VIEWPORT viewport;
 
+	// Work-stealing scheduler shared by the whole program
+	JobSystem jobSystem;
+
+	// Fixed-timestep simulation.  When enabled, Update() is called
+	// with exactly fixedTimeStep seconds, as many times per frame as
+	// needed to catch up (up to maxTicksPerFrame), and Draw() gets
+	// interpolationAlpha - how far we are between the last two ticks.
+	void SetFixedTimeStep(bool enabled, float ticksPerSecond = 60.0f, int maxTicksPerFrame = 5);
+	bool	useFixedTimeStep;
+	float	fixedTimeStep;
+	int		maxTicksPerFrame;
+	float	interpolationAlpha;
+
+	// Render thread mode.  When set, Draw() runs on its own thread a
+	// frame behind Update(), which only waits if it gets more than one
+	// frame ahead.  Can be changed at any time - the game loop starts
+	// or stops the thread at the start of the next frame.
+	bool	useRenderThread;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -83,6 +117,25 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	// Fixed-timestep bookkeeping
+	double accumulator;
+	double simulationTime;
+
+	// Render thread and the frame counters it syncs on.  Both
+	// threads sleep on the conditions rather than spin - counters
+	// only change with frameMutex held.
+	std::thread renderThread;
+	std::atomic<bool> renderThreadRunning;
+	std::atomic<unsigned int> framesPublished;
+	std::atomic<unsigned int> framesDrawn;
+	std::mutex frameMutex;
+	std::condition_variable framePublishedCondition;
+	std::condition_variable frameDrawnCondition;
+
+	void StartRenderThread();
+	void StopRenderThread();
+	void RenderThreadLoop();
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
@@ -0,0 +1,50 @@
+// Uploaded once per frame - world matrices come per instance
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+// Per vertex from slot 0, per instance from slot 1.  The world
+// matrix rows are stored just as they'd go in a constant buffer
+// (transposed), so the matrix is applied from the left.
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD0;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+};
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMALWS;
+	float3 tangent		: TANGENTWS;
+	float3 worldPos		: POSITIONWS;
+	float2 uv			: TEXCOORD;
+};
+
+VertexToPixel main(in VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+
+	float4 worldPos = mul(world, float4(input.position, 1.0f));
+	output.position = mul(mul(worldPos, view), projection);
+
+	output.worldPos = worldPos.xyz;
+
+	output.normal = normalize(mul((float3x3)world, input.normal));
+
+	output.tangent = normalize(mul((float3x3)world, input.tangent));
+
+	output.uv = input.uv;
+
+	return output;
+}
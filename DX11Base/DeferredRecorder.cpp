@@ -0,0 +1,69 @@
+#include "DeferredRecorder.h"
+
+DeferredRecorder::DeferredRecorder()
+{
+	contextCount = 0;
+	rangeCount = 0;
+}
+
+DeferredRecorder::~DeferredRecorder()
+{
+	for (unsigned int i = 0; i < contextCount; i++)
+	{
+		if (recorders[i].commandList) recorders[i].commandList->Release();
+		recorders[i].context->Release();
+	}
+}
+
+unsigned int DeferredRecorder::Initialize(ID3D11Device* device, unsigned int contextCount)
+{
+	if (contextCount > MaxContexts)
+		contextCount = MaxContexts;
+
+	// The runtime emulates command lists if the driver can't,
+	// so this only fails if something is badly wrong
+	this->contextCount = 0;
+	for (unsigned int i = 0; i < contextCount; i++)
+	{
+		if (FAILED(device->CreateDeferredContext(0, &recorders[i].context)))
+			break;
+
+		recorders[i].target.SetContext(recorders[i].context);
+		recorders[i].backend.SetContext(recorders[i].context);
+		this->contextCount++;
+	}
+	return this->contextCount;
+}
+
+void DeferredRecorder::Finish(Recorder& recorder, const Pass& pass)
+{
+	recorder.stateCache.Invalidate();
+	recorder.stateCache.SetRenderTargets(pass.targetCount, pass.targets, pass.depth);
+	recorder.stateCache.SetRasterizerState(pass.rasterizer);
+	recorder.context->RSSetViewports(1, &pass.viewport);
+
+	recorder.backend.Execute(recorder.commands);
+	recorder.context->FinishCommandList(FALSE, &recorder.commandList);
+}
+
+unsigned int DeferredRecorder::GetConstantBytes() const
+{
+	unsigned int bytes = 0;
+	for (unsigned int r = 0; r < contextCount; r++)
+		bytes += recorders[r].stateCache.GetConstantBytes();
+	return bytes;
+}
+
+void DeferredRecorder::Execute(ID3D11DeviceContext* immediateContext)
+{
+	for (unsigned int r = 0; r < rangeCount; r++)
+	{
+		if (!recorders[r].commandList)
+			continue;
+
+		immediateContext->ExecuteCommandList(recorders[r].commandList, FALSE);
+		recorders[r].commandList->Release();
+		recorders[r].commandList = 0;
+	}
+	rangeCount = 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "D3D11CommandBackend.h"
+#include "JobSystem.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Multi-threaded draw recording on deferred contexts
+//
+// A list of draws is split into one contiguous range per
+// deferred context.  Each range is recorded into its own
+// command buffer on a worker, replayed onto its deferred
+// context there, and finished into a D3D11 command list.
+// Execute() then runs the lists on the immediate context in
+// range order, so the draws land exactly as they were sorted.
+//
+// Workers use shader scratch slots 1 and up (one per range),
+// leaving slot 0 to whatever thread owns the immediate context.
+//
+// ExecuteCommandList() leaves the immediate context in its
+// default state, so the caller must Invalidate() its state
+// cache afterwards.
+// --------------------------------------------------------
+class DeferredRecorder
+{
+public:
+	static const unsigned int MaxContexts = ISimpleShader::ScratchCount - 1;
+
+	// Below this many draws per range, one thread is quicker
+	static const unsigned int MinDrawsPerContext = 128;
+
+	// What each deferred context needs set before it draws -
+	// they all start out in the default state
+	struct Pass
+	{
+		UINT targetCount;
+		ID3D11RenderTargetView* const* targets;
+		ID3D11DepthStencilView* depth;
+		D3D11_VIEWPORT viewport;
+		ID3D11RasterizerState* rasterizer;
+	};
+
+	DeferredRecorder();
+	~DeferredRecorder();
+
+	// Creates up to contextCount deferred contexts, returning
+	// how many were made
+	unsigned int Initialize(ID3D11Device* device, unsigned int contextCount);
+	unsigned int GetContextCount() const { return contextCount; }
+
+	// Is a list this long worth splitting up?
+	bool ShouldSplit(unsigned int count) const { return contextCount > 1 && count >= MinDrawsPerContext * 2; }
+
+	// Calls record(begin, end, commands) for each range of
+	// [0, count) on the job system, and finishes the results
+	// into command lists.  Blocks until they're all ready.
+	template <typename Func>
+	void Record(unsigned int count, const Pass& pass, JobSystem& jobSystem, Func& record);
+
+	// Runs the finished lists in order, then releases them
+	void Execute(ID3D11DeviceContext* immediateContext);
+
+	unsigned int GetRangeCount() const { return rangeCount; }
+
+	// Constant buffer bytes the last Record() uploaded, over every range
+	unsigned int GetConstantBytes() const;
+
+private:
+	struct Recorder
+	{
+		ID3D11DeviceContext* context;
+		LinearArena arena;
+		CommandBuffer commands;
+		ContextStateTarget target;
+		StateCache stateCache;
+		D3D11CommandBackend backend;
+		ID3D11CommandList* commandList;
+
+		Recorder() : commands(&arena), stateCache(&target), backend(0, &stateCache)
+		{
+			context = 0;
+			commandList = 0;
+		}
+	};
+
+	Recorder recorders[MaxContexts];
+	unsigned int contextCount;
+	unsigned int rangeCount;
+
+	// Sets the pass up on a range's deferred context, replays
+	// its commands and finishes them into a command list
+	void Finish(Recorder& recorder, const Pass& pass);
+};
+
+template <typename Func>
+void DeferredRecorder::Record(unsigned int count, const Pass& pass, JobSystem& jobSystem, Func& record)
+{
+	rangeCount = count / MinDrawsPerContext;
+	if (rangeCount > contextCount) rangeCount = contextCount;
+	if (rangeCount == 0) rangeCount = 1;
+
+	for (unsigned int r = 0; r < contextCount; r++)
+		recorders[r].stateCache.ResetStats();
+
+	auto recordRanges = [&](unsigned int begin, unsigned int end)
+	{
+		unsigned int previousScratch = ISimpleShader::GetThreadScratch();
+		for (unsigned int r = begin; r < end; r++)
+		{
+			Recorder& recorder = recorders[r];
+			recorder.commands.Clear();
+			recorder.arena.Reset();
+
+			ISimpleShader::SetThreadScratch(r + 1);
+			record(count * r / rangeCount, count * (r + 1) / rangeCount, recorder.commands);
+			Finish(recorder, pass);
+		}
+		ISimpleShader::SetThreadScratch(previousScratch);
+	};
+	jobSystem.ParallelFor(rangeCount, 1, recordRanges);
+}
@@ -0,0 +1,33 @@
+
+// Full size depth buffer from the g-buffer pass
+Texture2D<float> depthTexture	: register(t0);
+
+cbuffer ExternalData : register(b0)
+{
+	int2 sourceSize;
+	int scale;
+}
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+};
+
+// Keeps the farthest depth under each output pixel, so the
+// small buffer never claims anything is nearer than it was
+float main(VertexToPixel input) : SV_TARGET
+{
+	int2 origin = int2(input.position.xy) * scale;
+
+	float farthest = 0.0f;
+	for (int y = 0; y < scale; y++)
+	{
+		for (int x = 0; x < scale; x++)
+		{
+			int2 sampleIndices = min(origin + int2(x, y), sourceSize - 1);
+			farthest = max(farthest, depthTexture.Load(int3(sampleIndices, 0)));
+		}
+	}
+
+	return farthest;
+}
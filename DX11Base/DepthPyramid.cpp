@@ -0,0 +1,236 @@
+#include "DepthPyramid.h"
+
+#include <cfloat>
+#include <cmath>
+
+// Points this close to (or behind) the camera plane can't be
+// projected, so they're dropped or treated as visible
+static const float NearW = 1e-4f;
+
+// Widest crack between reprojected texels that gets filled in
+static const unsigned int MaxGapFill = 2;
+
+DepthPyramid::DepthPyramid()
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+}
+
+// Sizes every level, reusing memory when the size hasn't changed
+void DepthPyramid::Resize(unsigned int width, unsigned int height)
+{
+	unsigned int count = 1;
+	for (unsigned int w = width, h = height; w > 1 || h > 1; count++)
+	{
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	levels.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		levels[i].width = width;
+		levels[i].height = height;
+		levels[i].depth.resize(width * height);
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+}
+
+void DepthPyramid::Build(const float* depth, unsigned int width, unsigned int height, FXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	Resize(width, height);
+
+	Level& base = levels[0];
+	for (unsigned int i = 0; i < width * height; i++)
+		base.depth[i] = depth[i];
+
+	BuildLevels();
+}
+
+// --------------------------------------------------------
+// Forward reprojection: each texel is unprojected with the
+// view it was rendered from and projected into the current
+// one.  Where several land on the same pixel the farthest
+// wins, keeping the result conservative.
+// --------------------------------------------------------
+void DepthPyramid::Reproject(const float* depth, unsigned int width, unsigned int height, FXMMATRIX sourceViewProjection, CXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	Resize(width, height);
+
+	// Negative marks "nothing landed here yet"
+	Level& base = levels[0];
+	for (unsigned int i = 0; i < width * height; i++)
+		base.depth[i] = -1.0f;
+
+	XMMATRIX sourceToCurrent = XMMatrixMultiply(XMMatrixInverse(0, sourceViewProjection), viewProjection);
+	float invWidth = 1.0f / width;
+	float invHeight = 1.0f / height;
+
+	for (unsigned int y = 0; y < height; y++)
+	{
+		float ndcY = 1.0f - (y + 0.5f) * invHeight * 2.0f;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			// Empty sky can't hide anything, so don't move it
+			float z = depth[y * width + x];
+			if (z >= 1.0f)
+				continue;
+
+			float ndcX = (x + 0.5f) * invWidth * 2.0f - 1.0f;
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(ndcX, ndcY, z, 1.0f), sourceToCurrent));
+			if (clip.w < NearW)
+				continue;
+
+			float invW = 1.0f / clip.w;
+			float currentZ = clip.z * invW;
+			if (currentZ < 0.0f || currentZ > 1.0f)
+				continue;
+
+			int px = (int)floorf((clip.x * invW * 0.5f + 0.5f) * width);
+			int py = (int)floorf((0.5f - clip.y * invW * 0.5f) * height);
+			if (px < 0 || py < 0 || px >= (int)width || py >= (int)height)
+				continue;
+
+			float& target = base.depth[py * width + px];
+			target = currentZ > target ? currentZ : target;
+		}
+	}
+
+	// Moving closer spreads the texels apart and leaves cracks
+	// between them.  A gap with landed texels close by on both
+	// sides (left and right, or above and below) takes the
+	// farthest of them.  A second pass fills where a crack along
+	// x crosses one along y.  Anything else is a real hole,
+	// which can't hide anything - the far plane.
+	for (int pass = 0; pass < 2; pass++)
+	{
+		scratch = base.depth;
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				float& target = base.depth[y * width + x];
+				if (target >= 0.0f)
+					continue;
+
+				float left = -1.0f, right = -1.0f, up = -1.0f, down = -1.0f;
+				for (unsigned int step = 1; step <= MaxGapFill; step++)
+				{
+					if (left < 0.0f && x >= step) left = scratch[y * width + x - step];
+					if (right < 0.0f && x + step < width) right = scratch[y * width + x + step];
+					if (up < 0.0f && y >= step) up = scratch[(y - step) * width + x];
+					if (down < 0.0f && y + step < height) down = scratch[(y + step) * width + x];
+				}
+
+				if (left >= 0.0f && right >= 0.0f)
+					target = fmaxf(left, right);
+				if (up >= 0.0f && down >= 0.0f)
+					target = fmaxf(target, fmaxf(up, down));
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < width * height; i++)
+	{
+		if (base.depth[i] < 0.0f)
+			base.depth[i] = 1.0f;
+	}
+
+	BuildLevels();
+}
+
+// Each texel keeps the farthest of the (up to) four below it -
+// odd sizes fold their last row or column into the final texel
+void DepthPyramid::BuildLevels()
+{
+	for (size_t i = 1; i < levels.size(); i++)
+	{
+		const Level& below = levels[i - 1];
+		Level& level = levels[i];
+
+		for (unsigned int y = 0; y < level.height; y++)
+		{
+			unsigned int y0 = y * 2;
+			unsigned int y1 = y0 + 1 < below.height ? y0 + 1 : y0;
+			for (unsigned int x = 0; x < level.width; x++)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = x0 + 1 < below.width ? x0 + 1 : x0;
+
+				float a = below.depth[y0 * below.width + x0];
+				float b = below.depth[y0 * below.width + x1];
+				float c = below.depth[y1 * below.width + x0];
+				float d = below.depth[y1 * below.width + x1];
+				float ab = a > b ? a : b;
+				float cd = c > d ? c : d;
+				level.depth[y * level.width + x] = ab > cd ? ab : cd;
+			}
+		}
+	}
+}
+
+bool DepthPyramid::IsVisible(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax) const
+{
+	if (levels.empty())
+		return true;
+
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	const Level& base = levels[0];
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z,
+			1.0f);
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, vp));
+		if (clip.w < NearW)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float sx = (clip.x * invW * 0.5f + 0.5f) * base.width;
+		float sy = (0.5f - clip.y * invW * 0.5f) * base.height;
+		minX = fminf(minX, sx); maxX = fmaxf(maxX, sx);
+		minY = fminf(minY, sy); maxY = fmaxf(maxY, sy);
+		minZ = fminf(minZ, clip.z * invW);
+	}
+
+	int x0 = (int)floorf(minX), x1 = (int)floorf(maxX);
+	int y0 = (int)floorf(minY), y1 = (int)floorf(maxY);
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > (int)base.width - 1) x1 = base.width - 1;
+	if (y1 > (int)base.height - 1) y1 = base.height - 1;
+
+	// Entirely off screen
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Lowest level where the rectangle touches no more than three
+	// texels each way - a level coarser would only need two, but
+	// would often pull in a big neighbouring texel that's open
+	unsigned int span = (unsigned int)((x1 - x0) > (y1 - y0) ? (x1 - x0) : (y1 - y0)) + 1;
+	unsigned int levelIndex = 0;
+	while ((2u << levelIndex) < span && levelIndex + 1 < levels.size())
+		levelIndex++;
+
+	const Level& level = levels[levelIndex];
+	for (int y = y0 >> levelIndex; y <= (y1 >> levelIndex); y++)
+	{
+		for (int x = x0 >> levelIndex; x <= (x1 >> levelIndex); x++)
+		{
+			if (level.depth[y * level.width + x] > minZ)
+				return true;
+		}
+	}
+
+	return false;
+}
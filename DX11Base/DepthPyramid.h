@@ -0,0 +1,64 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// CPU hierarchical-Z pyramid for occlusion testing
+//
+// Level 0 is a small depth buffer in the current camera's
+// view, and every level above it halves the size and keeps
+// the farthest depth of the texels below.  A box is hidden
+// if its nearest depth is behind the farthest depth of every
+// texel its screen rectangle covers, and picking the level
+// where that rectangle spans at most 3x3 texels keeps each
+// test to a handful of reads.
+//
+// The depth normally comes from an earlier GPU frame, so
+// Reproject() first moves it into the current view.  Depth
+// is post-projection z/w (0 near, 1 far), and there's no
+// GPU code here, so it can all be driven with made up depth.
+// --------------------------------------------------------
+class DepthPyramid
+{
+public:
+	DepthPyramid();
+
+	// Builds the pyramid straight from depth already in the
+	// current view.  Matrices are regular (non-transposed).
+	void Build(const float* depth, unsigned int width, unsigned int height, FXMMATRIX viewProjection);
+
+	// Takes depth rendered with an older view-projection, moves
+	// every texel to where it lands for the current one, then
+	// builds the pyramid.  Pixels nothing lands on are left at
+	// the far plane, so holes never hide anything.
+	void Reproject(const float* depth, unsigned int width, unsigned int height, FXMMATRIX sourceViewProjection, CXMMATRIX viewProjection);
+
+	// Could any part of this world space box be seen?
+	bool IsVisible(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax) const;
+
+	bool IsReady() const { return !levels.empty(); }
+	void Reset() { levels.clear(); }
+
+	unsigned int GetLevelCount() const { return (unsigned int)levels.size(); }
+	unsigned int GetWidth(unsigned int level) const { return levels[level].width; }
+	unsigned int GetHeight(unsigned int level) const { return levels[level].height; }
+	float GetDepth(unsigned int level, unsigned int x, unsigned int y) const { return levels[level].depth[y * levels[level].width + x]; }
+
+private:
+	struct Level
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<float> depth;
+	};
+
+	std::vector<Level> levels;
+	std::vector<float> scratch;
+	XMFLOAT4X4 viewProjection;
+
+	void Resize(unsigned int width, unsigned int height);
+	void BuildLevels();
+};
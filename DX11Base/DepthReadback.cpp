@@ -0,0 +1,164 @@
+#include "DepthReadback.h"
+
+#include <cstring>
+
+DepthReadback::DepthReadback()
+{
+	sourceWidth = 0;
+	sourceHeight = 0;
+	width = 0;
+	height = 0;
+	downsampleTexture = 0;
+	downsampleRTV = 0;
+	writeIndex = 0;
+	readIndex = 0;
+	latestFresh = false;
+
+	for (unsigned int i = 0; i < RingSize; i++)
+	{
+		ring[i].staging = 0;
+		ring[i].pending = false;
+	}
+}
+
+DepthReadback::~DepthReadback()
+{
+	Release();
+}
+
+bool DepthReadback::Init(ID3D11Device* device, unsigned int sourceWidth, unsigned int sourceHeight)
+{
+	Release();
+
+	this->sourceWidth = sourceWidth;
+	this->sourceHeight = sourceHeight;
+	width = (sourceWidth + Downsample - 1) / Downsample;
+	height = (sourceHeight + Downsample - 1) / Downsample;
+
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(desc));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R32_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	if (FAILED(device->CreateTexture2D(&desc, 0, &downsampleTexture)) ||
+		FAILED(device->CreateRenderTargetView(downsampleTexture, 0, &downsampleRTV)))
+		return false;
+
+	// Same size and format, but readable by the CPU
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	for (unsigned int i = 0; i < RingSize; i++)
+	{
+		if (FAILED(device->CreateTexture2D(&desc, 0, &ring[i].staging)))
+			return false;
+	}
+
+	return true;
+}
+
+void DepthReadback::Release()
+{
+	if (downsampleRTV) { downsampleRTV->Release(); downsampleRTV = 0; }
+	if (downsampleTexture) { downsampleTexture->Release(); downsampleTexture = 0; }
+
+	for (unsigned int i = 0; i < RingSize; i++)
+	{
+		if (ring[i].staging) { ring[i].staging->Release(); ring[i].staging = 0; }
+		ring[i].pending = false;
+	}
+
+	writeIndex = 0;
+	readIndex = 0;
+}
+
+void DepthReadback::Capture(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthSRV,
+	SimpleVertexShader* fullscreenVertexShader, SimplePixelShader* downsamplePixelShader, const XMFLOAT4X4& viewProjection)
+{
+	// Every staging texture is still waiting on the GPU - skip
+	// this frame rather than block
+	Slot& slot = ring[writeIndex];
+	if (!downsampleRTV || slot.pending)
+		return;
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)width;
+	viewport.Height = (float)height;
+	viewport.MaxDepth = 1.0f;
+
+	context->OMSetRenderTargets(1, &downsampleRTV, 0);
+	context->RSSetViewports(1, &viewport);
+
+	fullscreenVertexShader->SetShader();
+
+	int sourceSize[2] = { (int)sourceWidth, (int)sourceHeight };
+	downsamplePixelShader->SetData("sourceSize", sourceSize, sizeof(sourceSize));
+	downsamplePixelShader->SetInt("scale", (int)Downsample);
+	downsamplePixelShader->SetShaderResourceView("depthTexture", depthSRV);
+	downsamplePixelShader->CopyAllBufferData();
+	downsamplePixelShader->SetShader();
+
+	ID3D11Buffer* nothing = 0;
+	UINT stride = 0;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+	context->Draw(3, 0);
+
+	// Let go of the depth so it can be bound for output again
+	downsamplePixelShader->SetShaderResourceView("depthTexture", 0);
+
+	context->CopyResource(slot.staging, downsampleTexture);
+	slot.viewProjection = viewProjection;
+	slot.pending = true;
+	writeIndex = (writeIndex + 1) % RingSize;
+}
+
+void DepthReadback::Poll(ID3D11DeviceContext* context)
+{
+	// Copies finish in order, so stop at the first that isn't done
+	while (ring[readIndex].pending)
+	{
+		Slot& slot = ring[readIndex];
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT hr = context->Map(slot.staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+		if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+			return;
+
+		if (SUCCEEDED(hr))
+		{
+			std::lock_guard<std::mutex> lock(latestMutex);
+			latestDepth.resize(width * height);
+			for (unsigned int y = 0; y < height; y++)
+				memcpy(&latestDepth[y * width], (const char*)mapped.pData + y * mapped.RowPitch, width * sizeof(float));
+			latestViewProjection = slot.viewProjection;
+			latestFresh = true;
+
+			context->Unmap(slot.staging, 0);
+		}
+
+		slot.pending = false;
+		readIndex = (readIndex + 1) % RingSize;
+	}
+}
+
+bool DepthReadback::TakeLatest(std::vector<float>& depth, unsigned int& width, unsigned int& height, XMFLOAT4X4& viewProjection)
+{
+	std::lock_guard<std::mutex> lock(latestMutex);
+	if (!latestFresh)
+		return false;
+
+	depth = latestDepth;
+	width = this->width;
+	height = this->height;
+	viewProjection = latestViewProjection;
+	latestFresh = false;
+	return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <mutex>
+#include <vector>
+
+#include "SimpleShader.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Asynchronous readback of a downsampled depth buffer
+//
+// Each frame the full size depth is shrunk on the GPU (keeping
+// the farthest depth of every block) and copied into the next
+// of a small ring of staging textures.  Those are mapped a few
+// frames later with DO_NOT_WAIT, so the CPU never stalls on
+// the GPU - if a copy isn't done yet it's simply tried again
+// next frame, and if the ring is full a capture is skipped.
+//
+// Capture() and Poll() belong to whichever thread draws, and
+// TakeLatest() to the thread that wants the depth.
+// --------------------------------------------------------
+class DepthReadback
+{
+public:
+	static const unsigned int RingSize = 3;
+	static const unsigned int Downsample = 4;
+
+	DepthReadback();
+	~DepthReadback();
+
+	// Creates the small depth target and the staging ring for a
+	// full size depth buffer of the given size
+	bool Init(ID3D11Device* device, unsigned int sourceWidth, unsigned int sourceHeight);
+	void Release();
+
+	// Shrinks the depth and queues its copy back to the CPU.  The
+	// depth buffer must not be bound for output, and render targets
+	// and the viewport are left for the caller to restore.  The
+	// matrix is the regular (non-transposed) view * projection the
+	// depth was rendered with.
+	void Capture(ID3D11DeviceContext* context, ID3D11ShaderResourceView* depthSRV,
+		SimpleVertexShader* fullscreenVertexShader, SimplePixelShader* downsamplePixelShader, const XMFLOAT4X4& viewProjection);
+
+	// Picks up any copies the GPU has finished, without waiting
+	void Poll(ID3D11DeviceContext* context);
+
+	// Copies out the newest finished depth, if there is one that
+	// hasn't been taken yet
+	bool TakeLatest(std::vector<float>& depth, unsigned int& width, unsigned int& height, XMFLOAT4X4& viewProjection);
+
+private:
+	struct Slot
+	{
+		ID3D11Texture2D* staging;
+		XMFLOAT4X4 viewProjection;
+		bool pending;
+	};
+
+	unsigned int sourceWidth;
+	unsigned int sourceHeight;
+	unsigned int width;
+	unsigned int height;
+
+	ID3D11Texture2D* downsampleTexture;
+	ID3D11RenderTargetView* downsampleRTV;
+
+	Slot ring[RingSize];
+	unsigned int writeIndex;
+	unsigned int readIndex;
+
+	// Newest finished readback, shared between threads
+	std::mutex latestMutex;
+	std::vector<float> latestDepth;
+	XMFLOAT4X4 latestViewProjection;
+	bool latestFresh;
+};
@@ -3,6 +3,10 @@ cbuffer ExternalData : register(b0)
 {
 	float3 lightColor;
 	float3 lightDir;
+	matrix view;
+	matrix shadowViewProjection[4];
+	float4 cascadeSplits;		// View depth where each cascade ends
+	int cascadeCount;
 }
 
 Texture2D positionGB	: register(t0);
@@ -10,6 +14,10 @@ Texture2D normalGB		: register(t1);
 Texture2D diffuseGB		: register(t2);
 SamplerState Sampler	: register(s0);
 
+// One slice per cascade, compared in hardware for 2x2 PCF
+Texture2DArray shadowMap				: register(t3);
+SamplerComparisonState shadowSampler	: register(s1);
+
 struct VertexToPixel
 {
 	float4 position		: SV_POSITION;
@@ -30,5 +38,22 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float lightAmountDL = saturate(dot(normal, L));
 	float3 color = lightColor * lightAmountDL * diffuse;
 
+	// Nearest cascade that reaches this far - past the last one
+	// there's no shadow at all
+	float viewDepth = mul(float4(position, 1.0f), view).z;
+	int cascade = cascadeCount;
+	for (int i = cascadeCount - 1; i >= 0; i--)
+	{
+		if (viewDepth <= cascadeSplits[i])
+			cascade = i;
+	}
+
+	if (cascade < cascadeCount)
+	{
+		float4 shadowPosition = mul(float4(position, 1.0f), shadowViewProjection[cascade]);
+		float2 shadowUV = shadowPosition.xy * float2(0.5f, -0.5f) + 0.5f;
+		color *= shadowMap.SampleCmpLevelZero(shadowSampler, float3(shadowUV, cascade), shadowPosition.z);
+	}
+
 	return float4(color, 1.0f);
 }
\ No newline at end of file
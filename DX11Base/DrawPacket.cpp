@@ -0,0 +1,124 @@
+#include "DrawPacket.h"
+
+#include <cstring>
+
+bool DrawPacket::Build(Mesh* mesh, Material* material, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap,
+	SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+{
+	if (!vertexShader->IsShaderValid())
+		return false;
+	if (pixelShader && (!pixelShader->IsShaderValid() || pixelShader->GetBufferCount() > 0))
+		return false;
+
+	inputLayout = vertexShader->GetInputLayout();
+	this->vertexShader = vertexShader->GetDirectXShader();
+	this->pixelShader = pixelShader ? pixelShader->GetDirectXShader() : 0;
+
+	vertexBuffer = mesh->GetVertexBuffer();
+	indexBuffer = mesh->GetIndexBuffer();
+	vertexStride = sizeof(Vertex);
+	indexCount = mesh->GetIndexCount();
+
+	objectBuffer = 0;
+	objectBufferSlot = 0;
+	objectBufferSize = 0;
+	worldOffset = NoOffset;
+
+	const SimpleConstantBuffer* cb = vertexShader->GetBufferInfo("perObject");
+	if (cb)
+	{
+		objectBuffer = cb->ConstantBuffer;
+		objectBufferSlot = cb->BindIndex;
+		objectBufferSize = cb->Size;
+
+		const SimpleShaderVariable* world = vertexShader->GetVariableInfo("world");
+		if (world && world->Size == sizeof(XMFLOAT4X4) && vertexShader->GetBufferInfo(world->ConstantBufferIndex) == cb)
+			worldOffset = world->ByteOffset;
+	}
+
+	//Material textures go wherever the pixel shader wants them
+	resourceCount = 0;
+	samplerCount = 0;
+	if (pixelShader)
+	{
+		const SimpleSRV* textureInfo = pixelShader->GetShaderResourceViewInfo("textureSRV");
+		const SimpleSRV* normalInfo = pixelShader->GetShaderResourceViewInfo("normalMapSRV");
+		const SimpleSampler* samplerInfo = pixelShader->GetSamplerInfo("basicSampler");
+		if (textureInfo)
+		{
+			resourceSlots[resourceCount] = textureInfo->BindIndex;
+			resources[resourceCount++] = texture;
+		}
+		if (normalInfo)
+		{
+			resourceSlots[resourceCount] = normalInfo->BindIndex;
+			resources[resourceCount++] = normalMap;
+		}
+		if (samplerInfo)
+		{
+			samplerSlots[samplerCount] = samplerInfo->BindIndex;
+			samplers[samplerCount++] = material->GetMaterialSampler();
+		}
+	}
+	return true;
+}
+
+void DrawPacket::Record(CommandBuffer& commands, const XMFLOAT4X4* world) const
+{
+	commands.RecordBindPipeline(inputLayout, vertexShader, pixelShader, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	if (objectBuffer)
+	{
+		unsigned char* constants = (unsigned char*)commands.RecordUpdateConstantBuffer(objectBuffer, objectBufferSize);
+		memset(constants, 0, objectBufferSize);
+		if (worldOffset != NoOffset && world)
+			memcpy(constants + worldOffset, world, sizeof(XMFLOAT4X4));
+		commands.RecordBindConstantBuffer(VertexStage, objectBufferSlot, objectBuffer);
+	}
+
+	for (unsigned int r = 0; r < resourceCount; r++)
+		commands.RecordBindShaderResource(PixelStage, resourceSlots[r], resources[r]);
+	for (unsigned int s = 0; s < samplerCount; s++)
+		commands.RecordBindSampler(PixelStage, samplerSlots[s], samplers[s]);
+
+	commands.RecordBindVertexBuffer(0, vertexBuffer, vertexStride, 0);
+	commands.RecordBindIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+}
+
+DrawPacketCache::DrawPacketCache(unsigned int capacity, HandlePool<Mesh>& meshes, HandlePool<Material>& materials, HandlePool<ID3D11ShaderResourceView*>& textures)
+	: meshes(meshes), materials(materials), textures(textures)
+{
+	this->capacity = capacity;
+	entries.reserve(capacity);
+}
+
+const DrawPacket* DrawPacketCache::Get(MeshHandle mesh, MaterialHandle material, SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+{
+	//Only runs as entities are created, so a plain search will do
+	for (Entry& entry : entries)
+	{
+		if (entry.mesh == mesh && entry.material == material && entry.vertexShader == vertexShader && entry.pixelShader == pixelShader)
+			return &entry.packet;
+	}
+
+	if (entries.size() == capacity)
+		return 0;
+
+	Mesh* meshObject = meshes.Get(mesh);
+	Material* materialObject = materials.Get(material);
+	if (!meshObject || !materialObject)
+		return 0;
+
+	Entry entry = { mesh, material, vertexShader, pixelShader };
+	if (!entry.packet.Build(meshObject, materialObject, GetTexture(materialObject->GetMaterialTexture()), GetTexture(materialObject->GetNormalTexture()), vertexShader, pixelShader))
+		return 0;
+
+	entries.push_back(entry);
+	return &entries.back().packet;
+}
+
+ID3D11ShaderResourceView* DrawPacketCache::GetTexture(TextureHandle handle)
+{
+	ID3D11ShaderResourceView** srv = textures.Get(handle);
+	return srv ? *srv : 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Mesh.h"
+#include "Material.h"
+#include "SimpleShader.h"
+#include "CommandBuffer.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// One draw with everything resolved up front
+//
+// Built once, when an entity is created, for each pass it
+// draws in: the mesh's buffers, the shaders, every texture and
+// sampler at its register, and where the world matrix goes in
+// the vertex shader's perObject constant buffer.  Recording
+// then only patches the world matrix into fresh constant
+// buffer data and copies the binds out - no name lookups, no
+// hashing and no shader scratch, so any number of threads can
+// record the same packet at once.
+//
+// Only per object data belongs to the packet.  Any other
+// constant buffers (perFrame, perCascade) are the pass's to
+// upload and bind, once, before its packets are recorded.
+// --------------------------------------------------------
+struct DrawPacket
+{
+	static const unsigned int MaxResources = 4;
+	static const unsigned int NoOffset = 0xFFFFFFFF;
+
+	ID3D11InputLayout* inputLayout;
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;		// Null for depth only passes
+
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	unsigned int vertexStride;
+	unsigned int indexCount;
+
+	// Pixel shader textures and samplers, each with its register
+	unsigned int resourceCount;
+	unsigned int resourceSlots[MaxResources];
+	ID3D11ShaderResourceView* resources[MaxResources];
+	unsigned int samplerCount;
+	unsigned int samplerSlots[MaxResources];
+	ID3D11SamplerState* samplers[MaxResources];
+
+	// The vertex shader's perObject constants - null if it has none
+	ID3D11Buffer* objectBuffer;
+	unsigned int objectBufferSlot;
+	unsigned int objectBufferSize;
+	unsigned int worldOffset;		// NoOffset if it has no world matrix
+
+	// Resolves the mesh and material (with its textures, already
+	// looked up) against the shaders - no pixel shader for depth
+	// only.  False if the pixel shader needs constants, which a
+	// packet can't provide.
+	bool Build(Mesh* mesh, Material* material, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap,
+		SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+
+	// Records every bind, with the world matrix patched in (null
+	// for packets without one), ready for a draw
+	void Record(CommandBuffer& commands, const XMFLOAT4X4* world) const;
+};
+
+// --------------------------------------------------------
+// Owns the packets, one per mesh, material and shader pair
+//
+// Entities drawn the same way share a packet, so comparing
+// packet pointers is enough to batch them.  Storage is
+// reserved up front and packets never move.
+//
+// Packets are keyed by handle, generation and all, so a mesh
+// or material created in a destroyed one's slot gets a packet
+// of its own rather than the old one's stale pointers.
+// --------------------------------------------------------
+class DrawPacketCache
+{
+public:
+	DrawPacketCache(unsigned int capacity, HandlePool<Mesh>& meshes, HandlePool<Material>& materials, HandlePool<ID3D11ShaderResourceView*>& textures);
+
+	// Null if the cache is full, a handle is stale or the packet
+	// can't be built
+	const DrawPacket* Get(MeshHandle mesh, MaterialHandle material, SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+
+	unsigned int GetCount() const { return (unsigned int)entries.size(); }
+
+private:
+	struct Entry
+	{
+		MeshHandle mesh;
+		MaterialHandle material;
+		SimpleVertexShader* vertexShader;
+		SimplePixelShader* pixelShader;
+		DrawPacket packet;
+	};
+
+	std::vector<Entry> entries;
+	unsigned int capacity;
+	HandlePool<Mesh>& meshes;
+	HandlePool<Material>& materials;
+	HandlePool<ID3D11ShaderResourceView*>& textures;
+
+	ID3D11ShaderResourceView* GetTexture(TextureHandle handle);
+};
@@ -0,0 +1,110 @@
+#include "DrawSorter.h"
+
+#include <algorithm>
+
+unsigned long long DrawSorter::MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float viewDepth, float nearZ, float farZ)
+{
+	float depth = (viewDepth - nearZ) / (farZ - nearZ);
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	unsigned long long depthMax = (1ull << DepthBits) - 1;
+
+	unsigned long long key = pass & 0xF;
+	key = (key << ShaderBits) | (shader & ((1u << ShaderBits) - 1));
+	key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+	key = (key << MeshBits) | (mesh & ((1u << MeshBits) - 1));
+	key = (key << DepthBits) | (unsigned long long)(depth * depthMax);
+	return key;
+}
+
+void DrawSorter::Sort(std::vector<unsigned long long>& keys, std::vector<unsigned int>& values, JobSystem& jobSystem)
+{
+	unsigned int count = (unsigned int)keys.size();
+	if (count < 2)
+		return;
+
+	keyScratch.resize(count);
+	valueScratch.resize(count);
+
+	unsigned int blockCount = (count + MinBlockSize - 1) / MinBlockSize;
+	if (blockCount > MaxBlocks)
+		blockCount = MaxBlocks;
+	unsigned int blockSize = (count + blockCount - 1) / blockCount;
+	blockOffsets.resize(blockCount * Buckets);
+
+	unsigned long long* sourceKeys = &keys[0];
+	unsigned int* sourceValues = &values[0];
+	unsigned long long* destKeys = &keyScratch[0];
+	unsigned int* destValues = &valueScratch[0];
+	unsigned int* offsets = &blockOffsets[0];
+	bool inScratch = false;
+
+	for (unsigned int shift = 0; shift < 64; shift += RadixBits)
+	{
+		// Digit counts for each block
+		auto countDigits = [=](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int block = begin; block < end; block++)
+			{
+				unsigned int* counts = offsets + block * Buckets;
+				std::fill(counts, counts + Buckets, 0u);
+
+				unsigned int first = block * blockSize;
+				unsigned int last = std::min(first + blockSize, count);
+				for (unsigned int i = first; i < last; i++)
+					counts[(sourceKeys[i] >> shift) & (Buckets - 1)]++;
+			}
+		};
+		jobSystem.ParallelFor(blockCount, 1, countDigits);
+
+		// Nothing to do if every key has the same digit here
+		unsigned int firstDigit = (sourceKeys[0] >> shift) & (Buckets - 1);
+		unsigned int sameDigit = 0;
+		for (unsigned int block = 0; block < blockCount; block++)
+			sameDigit += offsets[block * Buckets + firstDigit];
+		if (sameDigit == count)
+			continue;
+
+		// Counts to output offsets - digit major, then block order,
+		// which keeps equal digits in their incoming order
+		unsigned int running = 0;
+		for (unsigned int digit = 0; digit < Buckets; digit++)
+		{
+			for (unsigned int block = 0; block < blockCount; block++)
+			{
+				unsigned int digitCount = offsets[block * Buckets + digit];
+				offsets[block * Buckets + digit] = running;
+				running += digitCount;
+			}
+		}
+
+		// Every block writes its own slice of each bucket
+		auto scatter = [=](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int block = begin; block < end; block++)
+			{
+				unsigned int* next = offsets + block * Buckets;
+
+				unsigned int first = block * blockSize;
+				unsigned int last = std::min(first + blockSize, count);
+				for (unsigned int i = first; i < last; i++)
+				{
+					unsigned int index = next[(sourceKeys[i] >> shift) & (Buckets - 1)]++;
+					destKeys[index] = sourceKeys[i];
+					destValues[index] = sourceValues[i];
+				}
+			}
+		};
+		jobSystem.ParallelFor(blockCount, 1, scatter);
+
+		std::swap(sourceKeys, destKeys);
+		std::swap(sourceValues, destValues);
+		inScratch = !inScratch;
+	}
+
+	// Odd number of passes leaves the result in the scratch arrays
+	if (inScratch)
+	{
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Draw ordering by 64-bit sort key
+//
+// Every visible draw gets a key packing, from the top bit
+// down, its pass, shader, material, mesh and quantized view
+// depth.  Sorting the keys groups draws that share state and,
+// within a group, puts them front to back so early-Z can throw
+// away as much as possible.
+//
+//   63-60 pass | 59-52 shader | 51-40 material | 39-28 mesh | 27-0 depth
+//
+// The sort is an LSD radix sort, one byte per pass.  Each pass
+// counts digits per block in parallel, turns the counts into
+// stable output offsets, then scatters every block in parallel.
+// Passes where all keys share the same digit are skipped, which
+// is most of them when only a few fields actually vary.
+// --------------------------------------------------------
+class DrawSorter
+{
+public:
+	enum Pass
+	{
+		PassGBuffer = 0,
+		PassForward = 1,
+	};
+
+	static const unsigned int ShaderBits = 8;
+	static const unsigned int MaterialBits = 12;
+	static const unsigned int MeshBits = 12;
+	static const unsigned int DepthBits = 28;
+
+	// Ids are masked to their field width.  viewDepth is clamped
+	// to [nearZ, farZ] and quantized linearly, nearest first.
+	static unsigned long long MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float viewDepth, float nearZ, float farZ);
+
+	// Sorts keys ascending, moving each value with its key.  Scratch
+	// memory is kept between calls.
+	void Sort(std::vector<unsigned long long>& keys, std::vector<unsigned int>& values, JobSystem& jobSystem);
+
+private:
+	static const unsigned int RadixBits = 8;
+	static const unsigned int Buckets = 1 << RadixBits;
+	static const unsigned int MinBlockSize = 4096;	// Smaller blocks aren't worth a job
+	static const unsigned int MaxBlocks = 64;
+
+	std::vector<unsigned long long> keyScratch;
+	std::vector<unsigned int> valueScratch;
+	std::vector<unsigned int> blockOffsets;		// Buckets per block
+};
@@ -0,0 +1,480 @@
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+const float DynamicBVH::RebuildCostRatio = 1.5f;
+
+// Helpers for working with min/max boxes
+static void Union(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB, XMFLOAT3& outMin, XMFLOAT3& outMax)
+{
+	XMStoreFloat3(&outMin, XMVectorMin(XMLoadFloat3(&minA), XMLoadFloat3(&minB)));
+	XMStoreFloat3(&outMax, XMVectorMax(XMLoadFloat3(&maxA), XMLoadFloat3(&maxB)));
+}
+
+static float SurfaceArea(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	float x = boundsMax.x - boundsMin.x;
+	float y = boundsMax.y - boundsMin.y;
+	float z = boundsMax.z - boundsMin.z;
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+static float UnionArea(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+{
+	XMFLOAT3 boundsMin, boundsMax;
+	Union(minA, maxA, minB, maxB, boundsMin, boundsMax);
+	return SurfaceArea(boundsMin, boundsMax);
+}
+
+// --------------------------------------------------------
+// Creates an empty tree
+//
+// fatMargin		- How far leaf boxes are grown on each side
+// initialCapacity	- Nodes to reserve up front (the tree needs
+//					  about two per proxy)
+// --------------------------------------------------------
+DynamicBVH::DynamicBVH(float fatMargin, int initialCapacity)
+{
+	this->fatMargin = fatMargin;
+	nodes.reserve(initialCapacity);
+
+	root = NullNode;
+	freeList = NullNode;
+	proxyCount = 0;
+	changesSinceRebuild = 0;
+	costAfterRebuild = 0.0f;
+}
+
+int DynamicBVH::AllocateNode()
+{
+	int index;
+	if (freeList != NullNode)
+	{
+		index = freeList;
+		freeList = nodes[index].parent;
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node& node = nodes[index];
+	node.parent = NullNode;
+	node.child1 = NullNode;
+	node.child2 = NullNode;
+	node.height = 0;
+	node.userData = 0;
+	return index;
+}
+
+void DynamicBVH::FreeNode(int index)
+{
+	nodes[index].parent = freeList;
+	nodes[index].height = -1;
+	freeList = index;
+}
+
+int DynamicBVH::Insert(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, unsigned int userData)
+{
+	int proxy = AllocateNode();
+	Node& node = nodes[proxy];
+	node.boundsMin = XMFLOAT3(boundsMin.x - fatMargin, boundsMin.y - fatMargin, boundsMin.z - fatMargin);
+	node.boundsMax = XMFLOAT3(boundsMax.x + fatMargin, boundsMax.y + fatMargin, boundsMax.z + fatMargin);
+	node.userData = userData;
+
+	InsertLeaf(proxy);
+	proxyCount++;
+	changesSinceRebuild++;
+	return proxy;
+}
+
+void DynamicBVH::Remove(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	proxyCount--;
+	changesSinceRebuild++;
+}
+
+void DynamicBVH::Clear()
+{
+	nodes.clear();
+	root = NullNode;
+	freeList = NullNode;
+	proxyCount = 0;
+	changesSinceRebuild = 0;
+	costAfterRebuild = 0.0f;
+}
+
+bool DynamicBVH::Move(int proxy, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	// Still inside the fat box?  Then the tree doesn't change
+	Node& node = nodes[proxy];
+	if (node.boundsMin.x <= boundsMin.x && node.boundsMin.y <= boundsMin.y && node.boundsMin.z <= boundsMin.z &&
+		boundsMax.x <= node.boundsMax.x && boundsMax.y <= node.boundsMax.y && boundsMax.z <= node.boundsMax.z)
+		return false;
+
+	RemoveLeaf(proxy);
+	node.boundsMin = XMFLOAT3(boundsMin.x - fatMargin, boundsMin.y - fatMargin, boundsMin.z - fatMargin);
+	node.boundsMax = XMFLOAT3(boundsMax.x + fatMargin, boundsMax.y + fatMargin, boundsMax.z + fatMargin);
+	InsertLeaf(proxy);
+
+	changesSinceRebuild++;
+	return true;
+}
+
+// --------------------------------------------------------
+// Only bothers measuring the tree once a decent fraction of
+// it has changed, since measuring touches every node
+// --------------------------------------------------------
+bool DynamicBVH::Optimize()
+{
+	if (changesSinceRebuild < proxyCount / 4 + 1)
+		return false;
+
+	changesSinceRebuild = 0;
+	if (GetCost() <= costAfterRebuild * RebuildCostRatio)
+		return false;
+
+	Rebuild();
+	return true;
+}
+
+float DynamicBVH::GetCost() const
+{
+	float cost = 0.0f;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].height > 0)
+			cost += SurfaceArea(nodes[i].boundsMin, nodes[i].boundsMax);
+	}
+	return cost;
+}
+
+// --------------------------------------------------------
+// Walks down from the root picking whichever side grows the
+// surface area the least, then pairs the leaf with the node
+// it stopped at under a new parent
+// --------------------------------------------------------
+void DynamicBVH::InsertLeaf(int leaf)
+{
+	if (root == NullNode)
+	{
+		root = leaf;
+		nodes[root].parent = NullNode;
+		return;
+	}
+
+	XMFLOAT3 leafMin = nodes[leaf].boundsMin;
+	XMFLOAT3 leafMax = nodes[leaf].boundsMax;
+
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		const Node& node = nodes[index];
+		float area = SurfaceArea(node.boundsMin, node.boundsMax);
+		float combinedArea = UnionArea(node.boundsMin, node.boundsMax, leafMin, leafMax);
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		int children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; i++)
+		{
+			const Node& child = nodes[children[i]];
+			float newArea = UnionArea(child.boundsMin, child.boundsMax, leafMin, leafMax);
+			if (child.IsLeaf())
+				childCost[i] = newArea + inheritanceCost;
+			else
+				childCost[i] = (newArea - SurfaceArea(child.boundsMin, child.boundsMax)) + inheritanceCost;
+		}
+
+		// Stop here if going down either side costs more
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	int sibling = index;
+
+	// Create the new parent (this may grow the node array,
+	// so no references into it are held across the call)
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].height = nodes[sibling].height + 1;
+	Union(leafMin, leafMax, nodes[sibling].boundsMin, nodes[sibling].boundsMax, nodes[newParent].boundsMin, nodes[newParent].boundsMax);
+
+	if (oldParent != NullNode)
+	{
+		if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		root = newParent;
+	}
+
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	// Fix up heights and boxes on the way back up
+	Refit(nodes[leaf].parent);
+}
+
+void DynamicBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = NullNode;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	// The sibling takes the parent's place
+	if (grandParent != NullNode)
+	{
+		if (nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+
+		nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		Refit(grandParent);
+	}
+	else
+	{
+		root = sibling;
+		nodes[sibling].parent = NullNode;
+		FreeNode(parent);
+	}
+}
+
+// --------------------------------------------------------
+// Rebalances and recomputes every node from here to the root
+// --------------------------------------------------------
+void DynamicBVH::Refit(int index)
+{
+	while (index != NullNode)
+	{
+		index = Balance(index);
+
+		Node& node = nodes[index];
+		const Node& child1 = nodes[node.child1];
+		const Node& child2 = nodes[node.child2];
+
+		node.height = 1 + (child1.height > child2.height ? child1.height : child2.height);
+		Union(child1.boundsMin, child1.boundsMax, child2.boundsMin, child2.boundsMax, node.boundsMin, node.boundsMax);
+
+		index = node.parent;
+	}
+}
+
+// --------------------------------------------------------
+// If one side of node A is more than one level taller than
+// the other, rotates that side's child up to take A's place.
+// Returns the index of whichever node is now at A's position.
+// --------------------------------------------------------
+int DynamicBVH::Balance(int iA)
+{
+	Node* A = &nodes[iA];
+	if (A->IsLeaf() || A->height < 2)
+		return iA;
+
+	int iB = A->child1;
+	int iC = A->child2;
+	Node* B = &nodes[iB];
+	Node* C = &nodes[iC];
+
+	int balance = C->height - B->height;
+
+	// Rotate C up
+	if (balance > 1)
+	{
+		int iF = C->child1;
+		int iG = C->child2;
+		Node* F = &nodes[iF];
+		Node* G = &nodes[iG];
+
+		// Swap A and C
+		C->child1 = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+
+		// A's old parent should now point to C
+		if (C->parent != NullNode)
+		{
+			if (nodes[C->parent].child1 == iA)
+				nodes[C->parent].child1 = iC;
+			else
+				nodes[C->parent].child2 = iC;
+		}
+		else
+		{
+			root = iC;
+		}
+
+		// Keep the taller of F and G under C
+		if (F->height > G->height)
+		{
+			C->child2 = iF;
+			A->child2 = iG;
+			G->parent = iA;
+			Union(B->boundsMin, B->boundsMax, G->boundsMin, G->boundsMax, A->boundsMin, A->boundsMax);
+			Union(A->boundsMin, A->boundsMax, F->boundsMin, F->boundsMax, C->boundsMin, C->boundsMax);
+			A->height = 1 + (B->height > G->height ? B->height : G->height);
+			C->height = 1 + (A->height > F->height ? A->height : F->height);
+		}
+		else
+		{
+			C->child2 = iG;
+			A->child2 = iF;
+			F->parent = iA;
+			Union(B->boundsMin, B->boundsMax, F->boundsMin, F->boundsMax, A->boundsMin, A->boundsMax);
+			Union(A->boundsMin, A->boundsMax, G->boundsMin, G->boundsMax, C->boundsMin, C->boundsMax);
+			A->height = 1 + (B->height > F->height ? B->height : F->height);
+			C->height = 1 + (A->height > G->height ? A->height : G->height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1)
+	{
+		int iD = B->child1;
+		int iE = B->child2;
+		Node* D = &nodes[iD];
+		Node* E = &nodes[iE];
+
+		// Swap A and B
+		B->child1 = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+
+		// A's old parent should now point to B
+		if (B->parent != NullNode)
+		{
+			if (nodes[B->parent].child1 == iA)
+				nodes[B->parent].child1 = iB;
+			else
+				nodes[B->parent].child2 = iB;
+		}
+		else
+		{
+			root = iB;
+		}
+
+		// Keep the taller of D and E under B
+		if (D->height > E->height)
+		{
+			B->child2 = iD;
+			A->child1 = iE;
+			E->parent = iA;
+			Union(C->boundsMin, C->boundsMax, E->boundsMin, E->boundsMax, A->boundsMin, A->boundsMax);
+			Union(A->boundsMin, A->boundsMax, D->boundsMin, D->boundsMax, B->boundsMin, B->boundsMax);
+			A->height = 1 + (C->height > E->height ? C->height : E->height);
+			B->height = 1 + (A->height > D->height ? A->height : D->height);
+		}
+		else
+		{
+			B->child2 = iE;
+			A->child1 = iD;
+			D->parent = iA;
+			Union(C->boundsMin, C->boundsMax, D->boundsMin, D->boundsMax, A->boundsMin, A->boundsMax);
+			Union(A->boundsMin, A->boundsMax, E->boundsMin, E->boundsMax, B->boundsMin, B->boundsMax);
+			A->height = 1 + (C->height > D->height ? C->height : D->height);
+			B->height = 1 + (A->height > E->height ? A->height : E->height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+// --------------------------------------------------------
+// Throws away every internal node and rebuilds top-down,
+// splitting at the median along the widest axis
+// --------------------------------------------------------
+void DynamicBVH::Rebuild()
+{
+	rebuildLeaves.clear();
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].height == 0)
+			rebuildLeaves.push_back((int)i);
+		else if (nodes[i].height > 0)
+			FreeNode((int)i);
+	}
+
+	root = rebuildLeaves.empty() ? NullNode : BuildTopDown(&rebuildLeaves[0], (int)rebuildLeaves.size());
+	if (root != NullNode)
+		nodes[root].parent = NullNode;
+
+	changesSinceRebuild = 0;
+	costAfterRebuild = GetCost();
+}
+
+int DynamicBVH::BuildTopDown(int* leaves, int count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	// Find the axis the leaf centers are most spread along
+	XMVECTOR centerMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR centerMax = XMVectorReplicate(-FLT_MAX);
+	for (int i = 0; i < count; i++)
+	{
+		XMVECTOR center = XMVectorAdd(XMLoadFloat3(&nodes[leaves[i]].boundsMin), XMLoadFloat3(&nodes[leaves[i]].boundsMax));
+		centerMin = XMVectorMin(centerMin, center);
+		centerMax = XMVectorMax(centerMax, center);
+	}
+
+	XMFLOAT3 spread;
+	XMStoreFloat3(&spread, XMVectorSubtract(centerMax, centerMin));
+	int axis = 0;
+	if (spread.y > spread.x) axis = 1;
+	if (spread.z > (axis == 0 ? spread.x : spread.y)) axis = 2;
+
+	// Split the leaves in half around the median center
+	const std::vector<Node>& n = nodes;
+	int half = count / 2;
+	std::nth_element(leaves, leaves + half, leaves + count, [&n, axis](int a, int b)
+	{
+		const float* minA = &n[a].boundsMin.x;
+		const float* maxA = &n[a].boundsMax.x;
+		const float* minB = &n[b].boundsMin.x;
+		const float* maxB = &n[b].boundsMax.x;
+		return minA[axis] + maxA[axis] < minB[axis] + maxB[axis];
+	});
+
+	int index = AllocateNode();
+	int child1 = BuildTopDown(leaves, half);
+	int child2 = BuildTopDown(leaves + half, count - half);
+
+	Node& node = nodes[index];
+	node.child1 = child1;
+	node.child2 = child2;
+	node.height = 1 + (nodes[child1].height > nodes[child2].height ? nodes[child1].height : nodes[child2].height);
+	Union(nodes[child1].boundsMin, nodes[child1].boundsMax, nodes[child2].boundsMin, nodes[child2].boundsMax, node.boundsMin, node.boundsMax);
+	nodes[child1].parent = index;
+	nodes[child2].parent = index;
+
+	return index;
+}
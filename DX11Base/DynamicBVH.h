@@ -0,0 +1,280 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Dynamic bounding volume hierarchy of axis-aligned boxes
+//
+// Leaves hold "fat" boxes - the real bounds grown by a margin -
+// so an object can move a little without touching the tree at
+// all.  Once it leaves its fat box it is removed and reinserted,
+// and the tree is kept balanced with AVL-style rotations on the
+// way back up.  Reinserting is cheap but slowly lowers quality,
+// so Optimize() watches the surface area cost of the tree and
+// rebuilds it from scratch once it has degraded far enough.
+//
+// Proxies are node indices.  Queries hand back the userData
+// given to Insert(), and never allocate.
+// --------------------------------------------------------
+class DynamicBVH
+{
+public:
+	static const int NullNode = -1;
+
+	DynamicBVH(float fatMargin = 0.1f, int initialCapacity = 256);
+
+	// Adds a box and returns its proxy
+	int Insert(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, unsigned int userData);
+	void Remove(int proxy);
+	void Clear();
+
+	// Updates a proxy's bounds.  Returns true only if it had to
+	// be reinserted (i.e. it left its fat box).
+	bool Move(int proxy, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax);
+
+	// Call once per frame after moving things - rebuilds the tree
+	// if enough has changed that its quality has dropped.  Returns
+	// true if it rebuilt.
+	bool Optimize();
+	void Rebuild();
+
+	unsigned int GetUserData(int proxy) const { return nodes[proxy].userData; }
+	int GetProxyCount() const { return proxyCount; }
+	int GetHeight() const { return root == NullNode ? 0 : nodes[root].height; }
+
+	// Surface area heuristic cost - the summed area of every
+	// internal node.  Lower means cheaper queries.
+	float GetCost() const;
+
+	// Calls func(userData) for every box touching the convex volume
+	// bounded by the planes.  Planes are (a, b, c, d) with the inside
+	// where ax + by + cz + d >= 0, so a view frustum is 6 of them.
+	template <typename Func>
+	void QueryPlanes(const XMFLOAT4* planes, int planeCount, Func func) const;
+
+	// Calls func(userData) for every box touching the sphere
+	template <typename Func>
+	void QuerySphere(const XMFLOAT3& center, float radius, Func func) const;
+
+	// Calls func(userData, entryDistance) for every box the ray hits
+	// within maxDistance, in no particular order.  func returns the
+	// distance to clip the ray to - maxDistance to keep going, a
+	// closer hit to prune everything behind it, or 0 to stop.
+	template <typename Func>
+	void QueryRay(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, Func func) const;
+
+private:
+	struct Node
+	{
+		XMFLOAT3 boundsMin;
+		XMFLOAT3 boundsMax;
+		int parent;				// Next free node while on the free list
+		int child1;
+		int child2;
+		int height;				// 0 for leaves, -1 for free nodes
+		unsigned int userData;
+
+		bool IsLeaf() const { return child1 == NullNode; }
+	};
+
+	// Deepest traversal we support - far more than a balanced
+	// tree of any size that fits in memory will ever need
+	static const int StackSize = 256;
+
+	// How much worse than a fresh build the tree may get
+	static const float RebuildCostRatio;
+
+	std::vector<Node> nodes;
+	std::vector<int> rebuildLeaves;
+	int root;
+	int freeList;
+	int proxyCount;
+	float fatMargin;
+
+	int changesSinceRebuild;
+	float costAfterRebuild;
+
+	int AllocateNode();
+	void FreeNode(int index);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int index);
+	void Refit(int index);
+	int BuildTopDown(int* leaves, int count);
+};
+
+template <typename Func>
+void DynamicBVH::QueryPlanes(const XMFLOAT4* planes, int planeCount, Func func) const
+{
+	if (root == NullNode)
+		return;
+
+	// Transpose the planes into groups of four (structure of arrays)
+	// so each box is tested against four planes per instruction.
+	// Unused lanes get a plane every point is inside of.
+	const int MaxGroups = 4;
+	XMVECTOR planeX[MaxGroups], planeY[MaxGroups], planeZ[MaxGroups], planeW[MaxGroups];
+	int groupCount = (planeCount + 3) / 4;
+	if (groupCount > MaxGroups)
+		groupCount = MaxGroups;
+
+	for (int g = 0; g < groupCount; g++)
+	{
+		XMFLOAT4 p[4];
+		for (int i = 0; i < 4; i++)
+		{
+			int index = g * 4 + i;
+			p[i] = index < planeCount ? planes[index] : XMFLOAT4(0, 0, 0, 1);
+		}
+
+		XMMATRIX m = XMMatrixTranspose(XMMATRIX(XMLoadFloat4(&p[0]), XMLoadFloat4(&p[1]), XMLoadFloat4(&p[2]), XMLoadFloat4(&p[3])));
+		planeX[g] = m.r[0];
+		planeY[g] = m.r[1];
+		planeZ[g] = m.r[2];
+		planeW[g] = m.r[3];
+	}
+
+	// Stack entries carry a flag in the low bit for "already known
+	// to be fully inside", so whole subtrees skip the plane tests
+	int stack[StackSize];
+	int count = 0;
+	stack[count++] = root << 1;
+
+	XMVECTOR half = XMVectorReplicate(0.5f);
+	while (count > 0)
+	{
+		int entry = stack[--count];
+		const Node& node = nodes[entry >> 1];
+		int inside = entry & 1;
+
+		if (!inside)
+		{
+			XMVECTOR boundsMin = XMLoadFloat3(&node.boundsMin);
+			XMVECTOR boundsMax = XMLoadFloat3(&node.boundsMax);
+			XMVECTOR center = XMVectorMultiply(XMVectorAdd(boundsMin, boundsMax), half);
+			XMVECTOR extent = XMVectorMultiply(XMVectorSubtract(boundsMax, boundsMin), half);
+
+			XMVECTOR cx = XMVectorSplatX(center), cy = XMVectorSplatY(center), cz = XMVectorSplatZ(center);
+			XMVECTOR ex = XMVectorSplatX(extent), ey = XMVectorSplatY(extent), ez = XMVectorSplatZ(extent);
+
+			bool outside = false;
+			bool fullyInside = true;
+			for (int g = 0; g < groupCount && !outside; g++)
+			{
+				// Signed distance of the center, and the box's
+				// projected radius, along each plane normal
+				XMVECTOR distance = XMVectorMultiplyAdd(planeX[g], cx, XMVectorMultiplyAdd(planeY[g], cy, XMVectorMultiplyAdd(planeZ[g], cz, planeW[g])));
+				XMVECTOR radius = XMVectorMultiplyAdd(XMVectorAbs(planeX[g]), ex, XMVectorMultiplyAdd(XMVectorAbs(planeY[g]), ey, XMVectorMultiply(XMVectorAbs(planeZ[g]), ez)));
+
+				outside = !XMVector4GreaterOrEqual(XMVectorAdd(distance, radius), XMVectorZero());
+				fullyInside = fullyInside && XMVector4GreaterOrEqual(XMVectorSubtract(distance, radius), XMVectorZero());
+			}
+
+			if (outside)
+				continue;
+
+			inside = fullyInside ? 1 : 0;
+		}
+
+		if (node.IsLeaf())
+		{
+			func(node.userData);
+		}
+		else
+		{
+			stack[count++] = (node.child1 << 1) | inside;
+			stack[count++] = (node.child2 << 1) | inside;
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBVH::QuerySphere(const XMFLOAT3& center, float radius, Func func) const
+{
+	if (root == NullNode)
+		return;
+
+	XMVECTOR c = XMLoadFloat3(&center);
+	XMVECTOR radiusSq = XMVectorReplicate(radius * radius);
+
+	int stack[StackSize];
+	int count = 0;
+	stack[count++] = root;
+
+	while (count > 0)
+	{
+		const Node& node = nodes[stack[--count]];
+
+		// Distance from the center to the closest point on the box
+		XMVECTOR below = XMVectorSubtract(XMLoadFloat3(&node.boundsMin), c);
+		XMVECTOR above = XMVectorSubtract(c, XMLoadFloat3(&node.boundsMax));
+		XMVECTOR offset = XMVectorMax(XMVectorMax(below, above), XMVectorZero());
+		if (XMVector3Greater(XMVector3LengthSq(offset), radiusSq))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			func(node.userData);
+		}
+		else
+		{
+			stack[count++] = node.child1;
+			stack[count++] = node.child2;
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBVH::QueryRay(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, Func func) const
+{
+	if (root == NullNode)
+		return;
+
+	XMVECTOR o = XMLoadFloat3(&origin);
+	XMVECTOR invDir = XMVectorReciprocal(XMLoadFloat3(&direction));
+
+	int stack[StackSize];
+	int count = 0;
+	stack[count++] = root;
+
+	while (count > 0)
+	{
+		const Node& node = nodes[stack[--count]];
+
+		// Slab test on all three axes at once
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.boundsMin), o), invDir);
+		XMVECTOR t2 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.boundsMax), o), invDir);
+		XMFLOAT3 tNear, tFar;
+		XMStoreFloat3(&tNear, XMVectorMin(t1, t2));
+		XMStoreFloat3(&tFar, XMVectorMax(t1, t2));
+
+		float enter = tNear.x > tNear.y ? tNear.x : tNear.y;
+		enter = enter > tNear.z ? enter : tNear.z;
+		enter = enter > 0.0f ? enter : 0.0f;
+
+		float exit = tFar.x < tFar.y ? tFar.x : tFar.y;
+		exit = exit < tFar.z ? exit : tFar.z;
+		exit = exit < maxDistance ? exit : maxDistance;
+
+		if (enter > exit)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			float clip = func(node.userData, enter);
+			if (clip <= 0.0f)
+				return;
+			if (clip < maxDistance)
+				maxDistance = clip;
+		}
+		else
+		{
+			stack[count++] = node.child1;
+			stack[count++] = node.child2;
+		}
+	}
+}
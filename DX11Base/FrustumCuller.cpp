@@ -0,0 +1,139 @@
+#include "FrustumCuller.h"
+
+FrustumCuller::FrustumCuller()
+{
+	count = 0;
+	eyePosition = XMFLOAT3(0, 0, 0);
+	pixelScale = 0.0f;
+	minPixelRadius = 0.0f;
+}
+
+void FrustumCuller::SetContributionCull(const XMFLOAT3& eyePosition, float pixelScale, float minPixelRadius)
+{
+	this->eyePosition = eyePosition;
+	this->pixelScale = pixelScale;
+	this->minPixelRadius = minPixelRadius;
+}
+
+// Forgets every box but keeps the memory for next frame
+void FrustumCuller::Clear()
+{
+	centerX.clear(); centerY.clear(); centerZ.clear();
+	extentX.clear(); extentY.clear(); extentZ.clear();
+	count = 0;
+}
+
+unsigned int FrustumCuller::Add(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	centerX.push_back((boundsMin.x + boundsMax.x) * 0.5f);
+	centerY.push_back((boundsMin.y + boundsMax.y) * 0.5f);
+	centerZ.push_back((boundsMin.z + boundsMax.z) * 0.5f);
+	extentX.push_back((boundsMax.x - boundsMin.x) * 0.5f);
+	extentY.push_back((boundsMax.y - boundsMin.y) * 0.5f);
+	extentZ.push_back((boundsMax.z - boundsMin.z) * 0.5f);
+	return count++;
+}
+
+void FrustumCuller::Cull(const XMFLOAT4 planes[6], JobSystem& jobSystem, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	if (count == 0)
+		return;
+
+	// Pad the last group with empty boxes at the origin -
+	// their results are never read
+	unsigned int groupCount = (count + 3) / 4;
+	unsigned int padded = groupCount * 4;
+	centerX.resize(padded, 0.0f); centerY.resize(padded, 0.0f); centerZ.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f); extentY.resize(padded, 0.0f); extentZ.resize(padded, 0.0f);
+	results.resize(padded);
+
+	XMVECTOR p[6];
+	for (int i = 0; i < 6; i++)
+		p[i] = XMLoadFloat4(&planes[i]);
+
+	// Each job writes its own slice of results, so there's
+	// nothing to synchronize until the compaction below
+	auto cullRange = [this, &p](unsigned int begin, unsigned int end) { CullGroups(p, begin, end); };
+	jobSystem.ParallelFor(groupCount, 256, cullRange);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (results[i])
+			visible.push_back(i);
+	}
+
+	// Drop the padding so Add() keeps appending in the right place
+	centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+	extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+}
+
+// --------------------------------------------------------
+// Tests groups of four boxes at a time.  For each plane, a
+// box is outside if even its corner furthest along the normal
+// (center distance plus projected extent) is behind it.
+//
+// A box is too small when radius / distance * pixelScale comes
+// out under the minimum, which is compared squared on both
+// sides to skip the square root and divide.
+// --------------------------------------------------------
+void FrustumCuller::CullGroups(const XMVECTOR* planes, unsigned int firstGroup, unsigned int lastGroup)
+{
+	// Splat each plane's coefficients across all four lanes once
+	XMVECTOR nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+	for (int i = 0; i < 6; i++)
+	{
+		nx[i] = XMVectorSplatX(planes[i]);
+		ny[i] = XMVectorSplatY(planes[i]);
+		nz[i] = XMVectorSplatZ(planes[i]);
+		d[i] = XMVectorSplatW(planes[i]);
+		ax[i] = XMVectorAbs(nx[i]);
+		ay[i] = XMVectorAbs(ny[i]);
+		az[i] = XMVectorAbs(nz[i]);
+	}
+
+	bool contribution = minPixelRadius > 0.0f;
+	XMVECTOR eyeX = XMVectorReplicate(eyePosition.x);
+	XMVECTOR eyeY = XMVectorReplicate(eyePosition.y);
+	XMVECTOR eyeZ = XMVectorReplicate(eyePosition.z);
+	XMVECTOR scaleSq = XMVectorReplicate(pixelScale * pixelScale);
+	XMVECTOR minRadiusSq = XMVectorReplicate(minPixelRadius * minPixelRadius);
+
+	for (unsigned int g = firstGroup; g < lastGroup; g++)
+	{
+		unsigned int i = g * 4;
+		XMVECTOR cx = XMLoadFloat4((const XMFLOAT4*)&centerX[i]);
+		XMVECTOR cy = XMLoadFloat4((const XMFLOAT4*)&centerY[i]);
+		XMVECTOR cz = XMLoadFloat4((const XMFLOAT4*)&centerZ[i]);
+		XMVECTOR ex = XMLoadFloat4((const XMFLOAT4*)&extentX[i]);
+		XMVECTOR ey = XMLoadFloat4((const XMFLOAT4*)&extentY[i]);
+		XMVECTOR ez = XMLoadFloat4((const XMFLOAT4*)&extentZ[i]);
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(nx[p], cx, XMVectorMultiplyAdd(ny[p], cy, XMVectorMultiplyAdd(nz[p], cz, d[p])));
+			XMVECTOR radius = XMVectorMultiplyAdd(ax[p], ex, XMVectorMultiplyAdd(ay[p], ey, XMVectorMultiply(az[p], ez)));
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+		}
+
+		if (contribution)
+		{
+			XMVECTOR dx = XMVectorSubtract(cx, eyeX);
+			XMVECTOR dy = XMVectorSubtract(cy, eyeY);
+			XMVECTOR dz = XMVectorSubtract(cz, eyeZ);
+			XMVECTOR distanceSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+			XMVECTOR radiusSq = XMVectorMultiplyAdd(ex, ex, XMVectorMultiplyAdd(ey, ey, XMVectorMultiply(ez, ez)));
+
+			XMVECTOR tooSmall = XMVectorLess(XMVectorMultiply(radiusSq, scaleSq), XMVectorMultiply(minRadiusSq, distanceSq));
+			outside = XMVectorOrInt(outside, tooSmall);
+		}
+
+		uint32_t mask[4];
+		XMStoreInt4(mask, outside);
+		results[i + 0] = mask[0] == 0;
+		results[i + 1] = mask[1] == 0;
+		results[i + 2] = mask[2] == 0;
+		results[i + 3] = mask[3] == 0;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Flat SIMD frustum culling of world space boxes
+//
+// Boxes are stored as structure of arrays (centers and extents
+// split by axis) so each plane test covers four boxes at once.
+// Add everything that might be drawn, Cull(), then read back
+// the indices (in the order they were added) that survived.
+//
+// It can also drop boxes too small on screen to matter -
+// contribution culling - using each box's bounding sphere.
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	void Clear();
+
+	// Adds a box and returns its index
+	unsigned int Add(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax);
+
+	// Tests every box against the planes (inside is positive),
+	// splitting the work across jobs when there's enough of it,
+	// and fills visible with the indices that weren't culled
+	void Cull(const XMFLOAT4 planes[6], JobSystem& jobSystem, std::vector<unsigned int>& visible);
+
+	// Makes Cull() also drop boxes whose bounding sphere projects to
+	// a radius under minPixelRadius.  pixelScale converts a radius over
+	// distance into pixels - the projection's _22 times half the
+	// viewport height.  A minPixelRadius of 0 turns this off.
+	void SetContributionCull(const XMFLOAT3& eyePosition, float pixelScale, float minPixelRadius);
+
+	unsigned int GetCount() { return count; }
+
+private:
+	// Padded to a multiple of 4 so groups never run off the end
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<unsigned char> results;
+	unsigned int count;
+
+	XMFLOAT3 eyePosition;
+	float pixelScale;
+	float minPixelRadius;
+
+	void CullGroups(const XMVECTOR* planes, unsigned int firstGroup, unsigned int lastGroup);
+};
@@ -0,0 +1,22 @@
+#include "FrustumPlanes.h"
+
+using namespace DirectX;
+
+// Gribb/Hartmann plane extraction - each plane is a sum or
+// difference of the matrix's columns
+void ExtractFrustumPlanes(FXMMATRIX viewProjection, XMFLOAT4 planes[6])
+{
+	// Rows of the transpose are the columns we need
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR p[6];
+	p[0] = XMVectorAdd(columns.r[3], columns.r[0]);			// Left
+	p[1] = XMVectorSubtract(columns.r[3], columns.r[0]);	// Right
+	p[2] = XMVectorAdd(columns.r[3], columns.r[1]);			// Bottom
+	p[3] = XMVectorSubtract(columns.r[3], columns.r[1]);	// Top
+	p[4] = columns.r[2];									// Near (D3D depth starts at 0)
+	p[5] = XMVectorSubtract(columns.r[3], columns.r[2]);	// Far
+
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(p[i]));
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Pulls the six planes (left, right, bottom, top, near, far)
+// out of any regular (non-transposed) view-projection matrix.
+// Normals point inward, and each plane is normalized so it
+// gives a real distance.
+//
+// Only DirectXMath, so the camera, shadow cascades and their
+// tests all share it without needing a window.
+// --------------------------------------------------------
+void ExtractFrustumPlanes(DirectX::FXMMATRIX viewProjection, DirectX::XMFLOAT4 planes[6]);
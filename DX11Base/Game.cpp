@@ -2,37 +2,101 @@
 
 #include "WICTextureLoader.h"
 #include "DDSTextureLoader.h"
+#include "HeapCounter.h"
+#include "SphereProjection.h"
+
+#include <algorithm>
+#include <cassert>
 
 #define max(a,b) (((a) > (b)) ? (a):(b))
 #define min(a,b) (((a) < (b)) ? (a):(b))
 
+//How far LightingPassPixelShader lets a point light reach
+static const float PointLightRange = 2.0f;
+
+//Entities seen last frame skip the occlusion test except
+//once every this many frames
+static const unsigned int OcclusionRevalidateFrames = 16;
+
+//Direction the sun shines in, for both lighting and shadows
+static const XMFLOAT3 SunDirection(10.0f, -10.0f, 0.0f);
+
 Game::Game(HINSTANCE hInstance)
 	: DXCore(
 		hInstance,		   // The application's handle
 		"DirectX Game",	   // Text for the window's title bar
 		1280,			   // Width of the window's client area
 		720,			   // Height of the window's client area
-		true)			   // Show extra stats (fps) in title bar?
+		true),			   // Show extra stats (fps) in title bar?
+	meshPool(64),
+	materialPool(64),
+	texturePool(64),
+	entityPool(1024),
+	drawPackets(256, meshPool, materialPool, texturePool),
+	stateCache(&contextStateTarget),
+	commandBuffer(&frameArena),
+	commandBackend(0, &stateCache)
 {
 	// Initialize fields
 	vertexBuffer = 0;
 	indexBuffer = 0;
+	instanceBuffer = 0;
+	instanceCapacity = 0;
+	lightInstanceBuffer = 0;
+	lightInstanceCapacity = 0;
+	drawBatchCount = 0;
+	deferredInstancedVertexShader = 0;
 	baseVertexShader = 0;
 	basePixelShader = 0;
 	camera = 0;
+	debugKeyDown = false;
+	forwardEnabled = false;
+	graphReportRequested = false;
+	occludedDraws = 0;
+	lastVisibleFrame.resize(entityPool.GetCapacity(), 0);
+	cullFrame = 1;
+	occlusionRasterized = false;
+	occlusionTests = 0;
+	minScreenRadius = 1.5f;
+	lightsSubmitted = 0;
+	lightsCulled = 0;
+	lightsShaded = 0;
+
+	//Simulate at a steady 60Hz no matter the frame rate,
+	//and draw on a separate thread while the next frame updates
+	SetFixedTimeStep(true, 60.0f, 5);
+	useRenderThread = true;
 	
 
-	int i;
-
-	for (i = 0; i<3; i++)
+	heapCountAtPublish = 0;
+	heapAllocationsLastFrame = 0;
+	gBufferPosition = RenderGraph::InvalidHandle;
+	drawFrame = 0;
+	depthDownsamplePixelShader = 0;
+	readbackWidth = 0;
+	readbackHeight = 0;
+
+	shadowVertexShader = 0;
+	shadowMapTexture = 0;
+	for (int i = 0; i < (int)ShadowCascades::MaxCascades; i++)
 	{
-		//renderTargetTextureArray[i] = 0;
-		renderTargetViewArray[i] = 0;
-		shaderResourceViewArray[i] = 0;
+		shadowDSV[i] = 0;
+		staticShadowDSV[i] = 0;
+		cachedShadowVersion[i] = 0;
+		shadowCacheValid[i] = false;
 	}
-
-	depthStencilBufferDR = 0;
-	depthStencilViewDR = 0;
+	staticShadowTexture = 0;
+	shadowCacheEnabled = true;
+	staticShadowVersion = 0;
+	shadowDraws = 0;
+	shadowDrawsSaved = 0;
+	stateCallsIssued = 0;
+	stateCallsFiltered = 0;
+	constantBytesUploaded = 0;
+	deferredConstantBytes = 0;
+	shadowSRV = 0;
+	shadowSampler = 0;
+	shadowRasterizer = 0;
 
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -54,68 +118,44 @@ Game::~Game()
 	delete displayVertexShader;
 	delete displayPixelShader;
 
-	delete sphereMesh;
-	delete cubeMesh;
+	// Meshes, materials and entities are destroyed with their
+	// pools, but the pooled SRVs are COM references we own
+	texturePool.ForEach([](ID3D11ShaderResourceView*& srv) { if (srv) srv->Release(); });
 
-	delete materialEarth;
-	delete materialCobbleStone;
-	delete materialRed;
-	delete materialYellow;
-	delete materialSkyBox;
-	delete materialSnowTracks;
-	delete materialEmpty;
-
-	delete skyBoxEntity;
-	for(auto& se: sphereEntities) delete se;
-	for (auto& fe : flatEntities) delete fe;
-	
 	skyDepthState->Release();
 	skyRasterizerState->Release();
 
 	sampler->Release();
 	
-	earthDayMapSRV->Release();
-	earthNormalMapSRV->Release();
-	cobbleStoneSRV->Release();
-	cobbleStoneNormalSRV->Release();
-	plainRedSRV->Release();
-	plainYellowSRV->Release();
-	plainNormalMapSRV->Release();
-	snowTracksSRV->Release();
-	snowTracksNormalSRV->Release();
-
-	skySRV->Release();
-	
 	//Deferred Stuff release
-	depthStencilBufferDR->Release();
-	depthStencilViewDR->Release();
 	rasterizerDR->Release();
 	blendDR->Release();
 	depthStateDR->Release();
 	//depthSRV->Release();
 
-	delete pointLightEntity1;
-	delete pointLightEntity2;
-	delete pointLightEntity3;
-	delete pointLightEntity4;
-	delete pointLightEntity5;
-	delete pointLightEntity6;
-	delete pointLightEntity7;
-	delete pointLightEntity8;
-
-	for (int i = 0; i < 3; i++)
-	{
-		shaderResourceViewArray[i]->Release();
-		renderTargetViewArray[i]->Release();
-		
-	}
-
 	delete deferredVertexShader;
+	delete deferredInstancedVertexShader;
+	if (instanceBuffer) instanceBuffer->Release();
+	if (lightInstanceBuffer) lightInstanceBuffer->Release();
 	delete deferredPixelShader;
 	delete lightingPassVertexShader;
 	delete lightingPassPixelShader;
 	delete dirLightVertexShader;
 	delete dirLightPixelShader;
+	delete depthDownsamplePixelShader;
+
+	//Shadow Stuff release
+	for (unsigned int i = 0; i < shadowCascades.GetCascadeCount(); i++)
+	{
+		shadowDSV[i]->Release();
+		staticShadowDSV[i]->Release();
+	}
+	shadowMapTexture->Release();
+	staticShadowTexture->Release();
+	shadowSRV->Release();
+	shadowSampler->Release();
+	shadowRasterizer->Release();
+	delete shadowVertexShader;
 }
 
 
@@ -123,6 +163,7 @@ void Game::Init()
 {
 	//Initialize helper methods
 	DeferredSetupInitialize();
+	ShadowsInitialize();
 	CameraInitialize();
 	ShadersInitialize();
 	ModelsInitialize();
@@ -131,6 +172,21 @@ void Game::Init()
 	SkyBoxInitialize();
 	GameEntityInitialize();
 	LightsInitialize();
+	SpatialIndexInitialize();
+
+	//Everything on the render thread binds through the state cache
+	contextStateTarget.SetContext(context);
+	commandBackend.SetContext(context);
+	deferredRecorder.Initialize(device, jobSystem.GetThreadCount());
+	render.SetStateCache(&stateCache);
+	ISimpleShader* cachedShaders[] = { deferredVertexShader, deferredInstancedVertexShader, deferredPixelShader, lightingPassVertexShader, lightingPassPixelShader,
+		dirLightVertexShader, dirLightPixelShader, depthDownsamplePixelShader, shadowVertexShader,
+		baseVertexShader, basePixelShader, skyVertexShader, skyPixelShader, displayVertexShader, displayPixelShader };
+	for (ISimpleShader* shader : cachedShaders)
+		shader->SetStateCache(&stateCache);
+
+	graphBackend.SetDevice(device, context, &stateCache);
+	RenderGraphInitialize();
 
 	switcher = 1;
 	// Tell the input assembler stage of the pipeline what kind of
@@ -141,122 +197,10 @@ void Game::Init()
 
 void Game::DeferredSetupInitialize()
 {
-	int i;
-	// Texture Discriptions
-	D3D11_TEXTURE2D_DESC textureDescPosNorm;
-	D3D11_TEXTURE2D_DESC textureDescDiffuse;
-
-	// Texture for Position and Normal are 32 bit 
-	textureDescPosNorm.Width = width;
-	textureDescPosNorm.Height = height;
-	textureDescPosNorm.MipLevels = 1;
-	textureDescPosNorm.ArraySize = 1;
-	textureDescPosNorm.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	textureDescPosNorm.SampleDesc.Count = 1;
-	textureDescPosNorm.SampleDesc.Quality = 0;
-	textureDescPosNorm.Usage = D3D11_USAGE_DEFAULT;
-	textureDescPosNorm.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDescPosNorm.CPUAccessFlags = 0;
-	textureDescPosNorm.MiscFlags = 0;
-
-	//Texture for diffuse is 8 bit 
-	textureDescDiffuse.Width = width;
-	textureDescDiffuse.Height = height;
-	textureDescDiffuse.MipLevels = 1;
-	textureDescDiffuse.ArraySize = 1;
-	textureDescDiffuse.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDescDiffuse.SampleDesc.Count = 1;
-	textureDescDiffuse.SampleDesc.Quality = 0;
-	textureDescDiffuse.Usage = D3D11_USAGE_DEFAULT;
-	textureDescDiffuse.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDescDiffuse.CPUAccessFlags = 0;
-	textureDescDiffuse.MiscFlags = 0;
-
-	//Create render target array
-	ID3D11Texture2D* renderTargetTextureArray[3];
-
-	device->CreateTexture2D(&textureDescPosNorm, 0, &renderTargetTextureArray[0]);
-	device->CreateTexture2D(&textureDescPosNorm, 0, &renderTargetTextureArray[1]);
-	device->CreateTexture2D(&textureDescPosNorm, 0, &renderTargetTextureArray[2]);
-
-	// Render target desc for 32bit
-	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc32;
-	ZeroMemory(&renderTargetViewDesc32, sizeof(renderTargetViewDesc32));
-	renderTargetViewDesc32.Format = textureDescPosNorm.Format;
-	renderTargetViewDesc32.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	renderTargetViewDesc32.Texture2D.MipSlice = 0;
-
-	// Render target desc for 8bit
-	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc8;
-	ZeroMemory(&renderTargetViewDesc8, sizeof(renderTargetViewDesc8));
-	renderTargetViewDesc8.Format = textureDescPosNorm.Format;
-	renderTargetViewDesc8.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	renderTargetViewDesc8.Texture2D.MipSlice = 0;
-
-	//Create the render target arrays
-	device->CreateRenderTargetView(renderTargetTextureArray[0], &renderTargetViewDesc32, &renderTargetViewArray[0]);
-	device->CreateRenderTargetView(renderTargetTextureArray[1], &renderTargetViewDesc32, &renderTargetViewArray[1]);
-	device->CreateRenderTargetView(renderTargetTextureArray[2], &renderTargetViewDesc8, &renderTargetViewArray[2]);
-
-	//Creste SRV desc
-	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescDR;
-	ZeroMemory(&shaderResourceViewDescDR, sizeof(shaderResourceViewDescDR));
-	shaderResourceViewDescDR.Format = textureDescPosNorm.Format;
-	shaderResourceViewDescDR.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	shaderResourceViewDescDR.Texture2D.MostDetailedMip = 0;
-	shaderResourceViewDescDR.Texture2D.MipLevels = 1;
-
-	//Create SRV's
-	for (i = 0; i < 3; i++)
-	{
-		device->CreateShaderResourceView(renderTargetTextureArray[i], &shaderResourceViewDescDR, &shaderResourceViewArray[i]);
-		
-	}
-
-	//Release render target texture array
-	for (i = 0; i < 3; i++)
-	{
-		renderTargetTextureArray[i]->Release();
-	}
-
-	//Create depth buffer desc
-	D3D11_TEXTURE2D_DESC depthBufferDescDR;
-	ZeroMemory(&depthBufferDescDR, sizeof(depthBufferDescDR));
-	depthBufferDescDR.Width = width;
-	depthBufferDescDR.Height = height;
-	depthBufferDescDR.MipLevels = 1;
-	depthBufferDescDR.ArraySize = 1;
-	//depthBufferDescDR.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthBufferDescDR.Format = DXGI_FORMAT_R24G8_TYPELESS;
-	depthBufferDescDR.SampleDesc.Count = 1;
-	depthBufferDescDR.SampleDesc.Quality = 0;
-	depthBufferDescDR.Usage = D3D11_USAGE_DEFAULT;
-	depthBufferDescDR.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-	depthBufferDescDR.CPUAccessFlags = 0;
-	depthBufferDescDR.MiscFlags = 0;
-
-	device->CreateTexture2D(&depthBufferDescDR, 0, &depthStencilBufferDR);
-	
-	//Create depth stencil desc
-	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDescDR;
-	ZeroMemory(&depthStencilViewDescDR, sizeof(depthStencilViewDescDR));
-	depthStencilViewDescDR.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthStencilViewDescDR.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	depthStencilViewDescDR.Texture2D.MipSlice = 0;
-	
-	//Create depth stencil view
-	device->CreateDepthStencilView(depthStencilBufferDR, &depthStencilViewDescDR, &depthStencilViewDR);
-
-
-	//Setup the viewport for rendering.
-	viewportDR.Width = width;
-	viewportDR.Height = height;
-	viewportDR.MinDepth = 0.0f;
-	viewportDR.MaxDepth = 1.0f;
-	viewportDR.TopLeftX = 0.0f;
-	viewportDR.TopLeftY = 0.0f;
-
-	//context->OMSetRenderTargets(3, renderTargetViewArray, depthStencilViewDR);
+	//The g-buffer textures themselves belong to the render graph
+	depthReadback.Init(device, width, height);
+	pointLightBuffer.Init(device, sizeof(PointLight));
+	spotLightBuffer.Init(device, sizeof(SpotLight));
 
 	//Setup rasterizer state 
 	D3D11_RASTERIZER_DESC rasterizerDescDR;
@@ -296,6 +240,153 @@ void Game::DeferredSetupInitialize()
 
 }
 
+void Game::ShadowsInitialize()
+{
+	unsigned int resolution = shadowCascades.GetResolution();
+	unsigned int cascadeCount = shadowCascades.GetCascadeCount();
+
+	//One depth slice per cascade, readable by the lighting pass
+	D3D11_TEXTURE2D_DESC shadowDesc;
+	ZeroMemory(&shadowDesc, sizeof(shadowDesc));
+	shadowDesc.Width = resolution;
+	shadowDesc.Height = resolution;
+	shadowDesc.MipLevels = 1;
+	shadowDesc.ArraySize = cascadeCount;
+	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	shadowDesc.SampleDesc.Count = 1;
+	shadowDesc.SampleDesc.Quality = 0;
+	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	device->CreateTexture2D(&shadowDesc, 0, &shadowMapTexture);
+
+	//Static casters are cached in a copy that's never sampled
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	device->CreateTexture2D(&shadowDesc, 0, &staticShadowTexture);
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSVDesc;
+	ZeroMemory(&shadowDSVDesc, sizeof(shadowDSVDesc));
+	shadowDSVDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	shadowDSVDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	shadowDSVDesc.Texture2DArray.MipSlice = 0;
+	shadowDSVDesc.Texture2DArray.ArraySize = 1;
+	for (unsigned int i = 0; i < cascadeCount; i++)
+	{
+		shadowDSVDesc.Texture2DArray.FirstArraySlice = i;
+		device->CreateDepthStencilView(shadowMapTexture, &shadowDSVDesc, &shadowDSV[i]);
+		device->CreateDepthStencilView(staticShadowTexture, &shadowDSVDesc, &staticShadowDSV[i]);
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC shadowSRVDesc;
+	ZeroMemory(&shadowSRVDesc, sizeof(shadowSRVDesc));
+	shadowSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	shadowSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	shadowSRVDesc.Texture2DArray.MostDetailedMip = 0;
+	shadowSRVDesc.Texture2DArray.MipLevels = 1;
+	shadowSRVDesc.Texture2DArray.FirstArraySlice = 0;
+	shadowSRVDesc.Texture2DArray.ArraySize = cascadeCount;
+	device->CreateShaderResourceView(shadowMapTexture, &shadowSRVDesc, &shadowSRV);
+
+	//Outside the map counts as lit
+	D3D11_SAMPLER_DESC shadowSamplerDesc = {};
+	shadowSamplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	shadowSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSamplerDesc.BorderColor[0] = 1.0f;
+	shadowSamplerDesc.BorderColor[1] = 1.0f;
+	shadowSamplerDesc.BorderColor[2] = 1.0f;
+	shadowSamplerDesc.BorderColor[3] = 1.0f;
+	shadowSamplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+	shadowSamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&shadowSamplerDesc, &shadowSampler);
+
+	//Depth clip is off so casters between the light and a
+	//cascade flatten onto its near plane instead of vanishing
+	D3D11_RASTERIZER_DESC shadowRasterizerDesc = {};
+	shadowRasterizerDesc.FillMode = D3D11_FILL_SOLID;
+	shadowRasterizerDesc.CullMode = D3D11_CULL_BACK;
+	shadowRasterizerDesc.DepthClipEnable = false;
+	shadowRasterizerDesc.DepthBias = 1000;
+	shadowRasterizerDesc.SlopeScaledDepthBias = 1.0f;
+	device->CreateRasterizerState(&shadowRasterizerDesc, &shadowRasterizer);
+
+	shadowViewport.Width = (float)resolution;
+	shadowViewport.Height = (float)resolution;
+	shadowViewport.MinDepth = 0.0f;
+	shadowViewport.MaxDepth = 1.0f;
+	shadowViewport.TopLeftX = 0.0f;
+	shadowViewport.TopLeftY = 0.0f;
+}
+
+// --------------------------------------------------------
+// Declares every pass of the frame and what it reads and
+// writes, then lets the graph make the transient textures
+// --------------------------------------------------------
+void Game::RenderGraphInitialize()
+{
+	const float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	RenderGraph::TextureDesc gBufferDesc = { (unsigned int)width, (unsigned int)height, DXGI_FORMAT_R32G32B32A32_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+	RenderGraph::TextureDesc depthDesc = { (unsigned int)width, (unsigned int)height, DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+	RenderGraph::TextureDesc backBufferDesc = { (unsigned int)width, (unsigned int)height, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET };
+	RenderGraph::TextureDesc shadowDesc = { shadowCascades.GetResolution(), shadowCascades.GetResolution(), DXGI_FORMAT_R32_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+
+	gBufferPosition = renderGraph.CreateTexture("Position", gBufferDesc);
+	gBufferNormal = renderGraph.CreateTexture("Normal", gBufferDesc);
+	gBufferDiffuse = renderGraph.CreateTexture("Diffuse", gBufferDesc);
+	gBufferDepth = renderGraph.CreateTexture("Depth", depthDesc);
+
+	RenderGraph::Texture backBuffer = { 0, backBufferRTV, 0, 0 };
+	RenderGraph::Texture shadowMap = { shadowMapTexture, 0, shadowSRV, 0 };
+	backBufferResource = renderGraph.ImportTexture("Back buffer", backBufferDesc, backBuffer);
+	shadowMapResource = renderGraph.ImportTexture("Shadow map", shadowDesc, shadowMap);
+
+	unsigned int gBufferPass = renderGraph.AddPass("G-buffer", [this]() { DrawGBufferPass(*drawFrame); });
+	renderGraph.WriteColor(gBufferPass, gBufferPosition, true, black);
+	renderGraph.WriteColor(gBufferPass, gBufferNormal, true, black);
+	renderGraph.WriteColor(gBufferPass, gBufferDiffuse, true, black);
+	renderGraph.WriteDepth(gBufferPass, gBufferDepth, true);
+
+	//Nothing in the graph reads the result - it goes back to the game thread
+	unsigned int readbackPass = renderGraph.AddPass("Depth readback", [this]() { DrawDepthReadbackPass(*drawFrame); });
+	renderGraph.Read(readbackPass, gBufferDepth);
+	renderGraph.SetSideEffects(readbackPass);
+
+	//The cascades bind their own slices, so the graph leaves the map alone
+	unsigned int shadowPass = renderGraph.AddPass("Shadows", [this]() { DrawShadowPass(*drawFrame); });
+	renderGraph.Write(shadowPass, shadowMapResource);
+
+	unsigned int lightingPass = renderGraph.AddPass("Lighting", [this]() { DrawLightingPass(*drawFrame); });
+	renderGraph.Read(lightingPass, gBufferPosition);
+	renderGraph.Read(lightingPass, gBufferNormal);
+	renderGraph.Read(lightingPass, gBufferDiffuse);
+	renderGraph.Read(lightingPass, shadowMapResource);
+	renderGraph.WriteColor(lightingPass, backBufferResource, true, black);
+	renderGraph.WriteDepth(lightingPass, gBufferDepth, true);
+
+	renderGraph.Compile(&graphBackend);
+}
+
+// --------------------------------------------------------
+// New sizes for everything that follows the window, and a
+// fresh set of transient textures to match
+// --------------------------------------------------------
+void Game::RenderGraphResize()
+{
+	unsigned int resources[] = { gBufferPosition, gBufferNormal, gBufferDiffuse, gBufferDepth, backBufferResource };
+	for (unsigned int resource : resources)
+	{
+		RenderGraph::TextureDesc desc = renderGraph.GetTextureDesc(resource);
+		desc.width = width;
+		desc.height = height;
+		renderGraph.SetTextureDesc(resource, desc);
+	}
+
+	RenderGraph::Texture backBuffer = { 0, backBufferRTV, 0, 0 };
+	renderGraph.SetImportedTexture(backBufferResource, backBuffer);
+	renderGraph.Compile(&graphBackend);
+}
+
 void Game::CameraInitialize()
 {
 	camera = new Camera(0, 1, -6);
@@ -312,6 +403,12 @@ void Game::ShadersInitialize()
 	if (!basePixelShader->LoadShaderFile(L"Debug/BasePixelShader.cso"))
 		basePixelShader->LoadShaderFile(L"BasePixelShader.cso");
 
+	//The forward constants are written by name and size, so a
+	//struct out of step with the HLSL would otherwise go unnoticed
+	bool forwardLayoutMatches = render.CheckForwardLayout(basePixelShader);
+	assert(forwardLayoutMatches && "BasePixelShader's constants don't match the C++ lights");
+	(void)forwardLayoutMatches;
+
 	skyVertexShader = new SimpleVertexShader(device, context);
 	if (!skyVertexShader->LoadShaderFile(L"Debug/SkyBoxVertexShader.cso"))
 		skyVertexShader->LoadShaderFile(L"SkyBoxVertexShader.cso");
@@ -324,6 +421,10 @@ void Game::ShadersInitialize()
 	if (!deferredVertexShader->LoadShaderFile(L"Debug/DeferredVertexShader.cso"))
 		deferredVertexShader->LoadShaderFile(L"DeferredVertexShader.cso");
 
+	deferredInstancedVertexShader = new SimpleVertexShader(device, context);
+	if (!deferredInstancedVertexShader->LoadShaderFile(L"Debug/DeferredInstancedVertexShader.cso"))
+		deferredInstancedVertexShader->LoadShaderFile(L"DeferredInstancedVertexShader.cso");
+
 	deferredPixelShader = new SimplePixelShader(device, context);
 	if (!deferredPixelShader->LoadShaderFile(L"Debug/DeferredPixelShader.cso"))
 		deferredPixelShader->LoadShaderFile(L"DeferredPixelShader.cso");
@@ -352,25 +453,56 @@ void Game::ShadersInitialize()
 	if (!dirLightPixelShader->LoadShaderFile(L"Debug/DirLightPixelShader.cso"))
 		dirLightPixelShader->LoadShaderFile(L"DirLightPixelShader.cso");
 
+	depthDownsamplePixelShader = new SimplePixelShader(device, context);
+	if (!depthDownsamplePixelShader->LoadShaderFile(L"Debug/DepthDownsamplePixelShader.cso"))
+		depthDownsamplePixelShader->LoadShaderFile(L"DepthDownsamplePixelShader.cso");
+
+	shadowVertexShader = new SimpleVertexShader(device, context);
+	if (!shadowVertexShader->LoadShaderFile(L"Debug/ShadowVertexShader.cso"))
+		shadowVertexShader->LoadShaderFile(L"ShadowVertexShader.cso");
+
 }
 
 void Game::ModelsInitialize()
 {
-	sphereMesh = new Mesh("Models/sphere.obj", device);
-	cubeMesh = new Mesh("Models/cube.obj", device);
+	//Parse the OBJ files in parallel - only the buffer
+	//creation below has to happen one at a time
+	const char* files[2] = { "Models/sphere.obj", "Models/cube.obj" };
+	std::vector<Vertex> verts[2];
+	std::vector<unsigned int> indices[2];
+	bool loaded[2] = { false, false };
+
+	auto loadModels = [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			loaded[i] = Mesh::LoadOBJ(files[i], verts[i], indices[i]);
+	};
+	jobSystem.ParallelFor(2, 1, loadModels);
+
+	if (loaded[0])
+		sphereMesh = meshPool.Create(&verts[0][0], (int)verts[0].size(), &indices[0][0], (int)indices[0].size(), device);
+	if (loaded[1])
+		cubeMesh = meshPool.Create(&verts[1][0], (int)verts[1].size(), &indices[1][0], (int)indices[1].size(), device);
 }
 
 void Game::LoadTextures()
 {
-	CreateWICTextureFromFile(device, context, L"Textures/earth_daymap.jpg", 0, &earthDayMapSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/earth_normal_map.tif", 0, &earthNormalMapSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/rock.jpg", 0, &cobbleStoneSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/rockNormals.jpg", 0, &cobbleStoneNormalSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/red.jpg", 0, &plainRedSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/yellow.jpg", 0, &plainYellowSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/plainNormal.png", 0, &plainNormalMapSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/snowTracks.tif", 0, &snowTracksSRV);
-	CreateWICTextureFromFile(device, context, L"Textures/snowTracksNormal.tif", 0, &snowTracksNormalSRV);
+	earthDayMapSRV = LoadTexture(L"Textures/earth_daymap.jpg");
+	earthNormalMapSRV = LoadTexture(L"Textures/earth_normal_map.tif");
+	cobbleStoneSRV = LoadTexture(L"Textures/rock.jpg");
+	cobbleStoneNormalSRV = LoadTexture(L"Textures/rockNormals.jpg");
+	plainRedSRV = LoadTexture(L"Textures/red.jpg");
+	plainYellowSRV = LoadTexture(L"Textures/yellow.jpg");
+	plainNormalMapSRV = LoadTexture(L"Textures/plainNormal.png");
+	snowTracksSRV = LoadTexture(L"Textures/snowTracks.tif");
+	snowTracksNormalSRV = LoadTexture(L"Textures/snowTracksNormal.tif");
+}
+
+TextureHandle Game::LoadTexture(const wchar_t* file)
+{
+	ID3D11ShaderResourceView* srv = 0;
+	CreateWICTextureFromFile(device, context, file, 0, &srv);
+	return texturePool.Create(srv);
 }
 
 void Game::MaterialsInitialize()
@@ -386,20 +518,22 @@ void Game::MaterialsInitialize()
 	device->CreateSamplerState(&samplerDesc, &sampler);
 
 
-	materialEarth = new Material(basePixelShader, baseVertexShader, earthDayMapSRV, earthNormalMapSRV, sampler);
-	materialCobbleStone = new Material(basePixelShader, baseVertexShader, cobbleStoneSRV, cobbleStoneNormalSRV, sampler);
-	materialRed = new Material(basePixelShader, baseVertexShader, plainRedSRV, plainNormalMapSRV, sampler);
-	materialYellow = new Material(basePixelShader, baseVertexShader, plainYellowSRV, plainNormalMapSRV, sampler);
-	materialSnowTracks = new Material(basePixelShader, baseVertexShader, snowTracksSRV, snowTracksNormalSRV, sampler);
-	materialEmpty = new Material(basePixelShader, baseVertexShader, 0, plainNormalMapSRV, sampler);
-
-	materialSkyBox = new Material(skyPixelShader, skyVertexShader, skySRV, plainNormalMapSRV, sampler);
+	materialEarth = materialPool.Create(basePixelShader, baseVertexShader, earthDayMapSRV, earthNormalMapSRV, sampler);
+	materialCobbleStone = materialPool.Create(basePixelShader, baseVertexShader, cobbleStoneSRV, cobbleStoneNormalSRV, sampler);
+	materialRed = materialPool.Create(basePixelShader, baseVertexShader, plainRedSRV, plainNormalMapSRV, sampler);
+	materialYellow = materialPool.Create(basePixelShader, baseVertexShader, plainYellowSRV, plainNormalMapSRV, sampler);
+	materialSnowTracks = materialPool.Create(basePixelShader, baseVertexShader, snowTracksSRV, snowTracksNormalSRV, sampler);
+	materialEmpty = materialPool.Create(basePixelShader, baseVertexShader, TextureHandle(), plainNormalMapSRV, sampler);
 	
 }
 
 void Game::SkyBoxInitialize()
 {
-	CreateDDSTextureFromFile(device, L"Textures/SunnyCubeMap.dds", 0, &skySRV);
+	ID3D11ShaderResourceView* skyCubeMap = 0;
+	CreateDDSTextureFromFile(device, L"Textures/SunnyCubeMap.dds", 0, &skyCubeMap);
+	skySRV = texturePool.Create(skyCubeMap);
+
+	materialSkyBox = materialPool.Create(skyPixelShader, skyVertexShader, skySRV, plainNormalMapSRV, sampler);
 
 	D3D11_RASTERIZER_DESC rasterizerDesc = {};
 	rasterizerDesc.FillMode = D3D11_FILL_SOLID;
@@ -416,100 +550,149 @@ void Game::SkyBoxInitialize()
 
 void Game::GameEntityInitialize()
 {
-	skyBoxEntity = new GameEntity(cubeMesh, materialSkyBox);
-	
-	GameEntity* sphere0 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere1 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere2 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere3 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere4 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere5 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere6 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere7 = new GameEntity(sphereMesh, materialCobbleStone);
-	GameEntity* sphere8 = new GameEntity(sphereMesh, materialCobbleStone);
-
-	sphereEntities.push_back(sphere0);
-	sphereEntities.push_back(sphere1);
-	sphereEntities.push_back(sphere2);
-	sphereEntities.push_back(sphere3);
-	sphereEntities.push_back(sphere4);
-	sphereEntities.push_back(sphere5);
-	sphereEntities.push_back(sphere6);
-	sphereEntities.push_back(sphere7);
-	sphereEntities.push_back(sphere8);
-
-	sphereEntities[0]->SetPosition(0, 0, 2);
-	sphereEntities[1]->SetPosition(2, 0, 2);
-	sphereEntities[2]->SetPosition(-2, 0, 2);
-	sphereEntities[3]->SetPosition(0, 0, 0);
-	sphereEntities[4]->SetPosition(2, 0, 0);
-	sphereEntities[5]->SetPosition(-2, 0, 0);
-	sphereEntities[6]->SetPosition(0, 0, -2);
-	sphereEntities[7]->SetPosition(2, 0, -2);
-	sphereEntities[8]->SetPosition(-2, 0, -2);
-
-
-	GameEntity* flat0 = new GameEntity(cubeMesh, materialRed);
-	GameEntity* flat1 = new GameEntity(cubeMesh, materialRed);
-	GameEntity* flat2 = new GameEntity(cubeMesh, materialRed);
-	GameEntity* flat3 = new GameEntity(cubeMesh, materialRed);
+	skyBoxEntity = entityPool.Create(cubeMesh, materialSkyBox);
 	
-	flatEntities.push_back(flat0);
-	flatEntities.push_back(flat1);
-	flatEntities.push_back(flat2);
-	flatEntities.push_back(flat3);
+	for (int i = 0; i <= 8; i++)
+	{
+		sphereEntities.push_back(CreateDrawnEntity(sphereMesh, materialCobbleStone));
+	}
 
-	flatEntities[0]->SetScale(5.0f, 0.01f, 5.0f);
-	flatEntities[1]->SetScale(5.0f, 0.01f, 5.0f);
-	flatEntities[2]->SetScale(5.0f, 0.01f, 5.0f);
-	flatEntities[3]->SetScale(5.0f, 0.01f, 5.0f);
+	entityPool.Get(sphereEntities[0])->SetPosition(0, 0, 2);
+	entityPool.Get(sphereEntities[1])->SetPosition(2, 0, 2);
+	entityPool.Get(sphereEntities[2])->SetPosition(-2, 0, 2);
+	entityPool.Get(sphereEntities[3])->SetPosition(0, 0, 0);
+	entityPool.Get(sphereEntities[4])->SetPosition(2, 0, 0);
+	entityPool.Get(sphereEntities[5])->SetPosition(-2, 0, 0);
+	entityPool.Get(sphereEntities[6])->SetPosition(0, 0, -2);
+	entityPool.Get(sphereEntities[7])->SetPosition(2, 0, -2);
+	entityPool.Get(sphereEntities[8])->SetPosition(-2, 0, -2);
 
-	flatEntities[0]->SetPosition(0, -1.5f, 0);
-	flatEntities[1]->SetPosition(4.5f, 0, 0);
-	flatEntities[2]->SetPosition(0, 0, 4.5f);
-	flatEntities[3]->SetPosition(-4.5f, 0, 0);
 
-	flatEntities[1]->SetRotation(0, 0, -1.6f);
-	flatEntities[2]->SetRotation(1.6f, 0, 0);
-	flatEntities[3]->SetRotation(0, 0, 1.6f);
-}
+	for (int i = 0; i <= 3; i++)
+	{
+		Handle<GameEntity> flat = CreateDrawnEntity(cubeMesh, materialRed);
+		entityPool.Get(flat)->SetScale(5.0f, 0.01f, 5.0f);
+		entityPool.Get(flat)->SetStatic(true);
+		flatEntities.push_back(flat);
+	}
 
-void Game::LightsInitialize()
-{
-	pointLightEntity1 = new GameEntity(sphereMesh, XMFLOAT3(1.0f, 0.0f, 0.0f));
-	pointLightEntity1->SetPosition(1.0f, 0.0f, 2.5f);
-	pointLightEntity1->SetScale(3.0f, 3.0f, 3.0f);
+	entityPool.Get(flatEntities[0])->SetPosition(0, -1.5f, 0);
+	entityPool.Get(flatEntities[1])->SetPosition(4.5f, 0, 0);
+	entityPool.Get(flatEntities[2])->SetPosition(0, 0, 4.5f);
+	entityPool.Get(flatEntities[3])->SetPosition(-4.5f, 0, 0);
 
-	pointLightEntity2 = new GameEntity(sphereMesh, XMFLOAT3(0.0f, 0.0f, 1.0f));
-	pointLightEntity2->SetPosition(1.0f, 0.0f, 0.5f);
-	pointLightEntity2->SetScale(3.0f, 3.0f, 3.0f);
+	entityPool.Get(flatEntities[1])->SetRotation(0, 0, -1.6f);
+	entityPool.Get(flatEntities[2])->SetRotation(1.6f, 0, 0);
+	entityPool.Get(flatEntities[3])->SetRotation(0, 0, 1.6f);
+}
 
-	pointLightEntity3 = new GameEntity(sphereMesh, XMFLOAT3(0.0f, 1.0f, 0.0f));
-	pointLightEntity3->SetPosition(1.0f, 0.0f, -0.5f);
-	pointLightEntity3->SetScale(3.0f, 3.0f, 3.0f);
+// --------------------------------------------------------
+// Creates an entity that goes into the g-buffer and casts
+// shadows, with its packets for both built straight away
+// --------------------------------------------------------
+Handle<GameEntity> Game::CreateDrawnEntity(MeshHandle mesh, MaterialHandle material)
+{
+	Handle<GameEntity> handle = entityPool.Create(mesh, material);
+	GameEntity* entity = entityPool.Get(handle);
+	if (entity)
+	{
+		entity->SetDrawPackets(
+			drawPackets.Get(mesh, material, deferredInstancedVertexShader, deferredPixelShader),
+			drawPackets.Get(mesh, material, shadowVertexShader, 0));
+	}
+	return handle;
+}
 
-	pointLightEntity4 = new GameEntity(sphereMesh, XMFLOAT3(0.6f, 0.6f, 0.0f));
-	pointLightEntity4->SetPosition(1.0f, 0.0f, -2.5f);
-	pointLightEntity4->SetScale(3.0f, 3.0f, 3.0f);
+ID3D11ShaderResourceView* Game::GetTexture(TextureHandle handle)
+{
+	ID3D11ShaderResourceView** srv = texturePool.Get(handle);
+	return srv ? *srv : 0;
+}
 
-	pointLightEntity5 = new GameEntity(sphereMesh, XMFLOAT3(0.0f, 0.6f, 0.6f));
-	pointLightEntity5->SetPosition(-1.0f, 0.0f, 2.5f);
-	pointLightEntity5->SetScale(3.0f, 3.0f, 3.0f);
+// --------------------------------------------------------
+// Fills in what an entity draws with from its handles.  False
+// if its mesh, material or one of the material's textures has
+// been destroyed - a null texture handle is fine, and just
+// leaves that slot empty.
+// --------------------------------------------------------
+bool Game::ResolveDrawItem(GameEntity* entity, DrawItem& item)
+{
+	item.mesh = meshPool.Get(entity->GetMesh());
+	item.material = materialPool.Get(entity->GetMaterial());
+	if (!item.mesh || !item.material)
+		return false;
+
+	TextureHandle texture = item.material->GetMaterialTexture();
+	TextureHandle normalMap = item.material->GetNormalTexture();
+	if ((!texture.IsNull() && !texturePool.IsValid(texture)) || (!normalMap.IsNull() && !texturePool.IsValid(normalMap)))
+		return false;
+
+	item.texture = GetTexture(texture);
+	item.normalMap = GetTexture(normalMap);
+	item.gBufferPacket = entity->GetGBufferPacket();
+	item.shadowPacket = entity->GetShadowPacket();
+	item.world = *entity->GetWorldMatrix();
+	return true;
+}
 
-	pointLightEntity6 = new GameEntity(sphereMesh, XMFLOAT3(1.0f, 0.0f, 1.0f));
-	pointLightEntity6->SetPosition(-1.0f, 0.0f, 0.5f);
-	pointLightEntity6->SetScale(3.0f, 3.0f, 3.0f);
+void Game::LightsInitialize()
+{
 
-	pointLightEntity7 = new GameEntity(sphereMesh, XMFLOAT3(0.0f, 0.2f, 0.7f));
-	pointLightEntity7->SetPosition(-1.0f, 0.0f, -0.5f);
-	pointLightEntity7->SetScale(3.0f, 3.0f, 3.0f);
+	const XMFLOAT3 lightColors[8] =
+	{
+		XMFLOAT3(1.0f, 0.0f, 0.0f),
+		XMFLOAT3(0.0f, 0.0f, 1.0f),
+		XMFLOAT3(0.0f, 1.0f, 0.0f),
+		XMFLOAT3(0.6f, 0.6f, 0.0f),
+		XMFLOAT3(0.0f, 0.6f, 0.6f),
+		XMFLOAT3(1.0f, 0.0f, 1.0f),
+		XMFLOAT3(0.0f, 0.2f, 0.7f),
+		XMFLOAT3(0.1f, 0.8f, 0.0f)
+	};
+
+	const XMFLOAT3 lightPositions[8] =
+	{
+		XMFLOAT3(1.0f, 0.0f, 2.5f),
+		XMFLOAT3(1.0f, 0.0f, 0.5f),
+		XMFLOAT3(1.0f, 0.0f, -0.5f),
+		XMFLOAT3(1.0f, 0.0f, -2.5f),
+		XMFLOAT3(-1.0f, 0.0f, 2.5f),
+		XMFLOAT3(-1.0f, 0.0f, 0.5f),
+		XMFLOAT3(-1.0f, 0.0f, -0.5f),
+		XMFLOAT3(-1.0f, 0.0f, -2.5f)
+	};
+
+	for (int i = 0; i < 8; i++)
+	{
+		Handle<GameEntity> light = entityPool.Create(sphereMesh, lightColors[i]);
+		entityPool.Get(light)->SetPosition(lightPositions[i].x, lightPositions[i].y, lightPositions[i].z);
+		entityPool.Get(light)->SetScale(3.0f, 3.0f, 3.0f);
+		pointLightEntities.push_back(light);
+	}
+}
 
-	pointLightEntity8 = new GameEntity(sphereMesh, XMFLOAT3(0.1f, 0.8f, 0.0f));
-	pointLightEntity8->SetPosition(-1.0f, 0.0f, -2.5f);
-	pointLightEntity8->SetScale(3.0f, 3.0f, 3.0f);
+void Game::SpatialIndexInitialize()
+{
+	std::vector<Handle<GameEntity>> indexed;
+	indexed.insert(indexed.end(), flatEntities.begin(), flatEntities.end());
+	indexed.insert(indexed.end(), sphereEntities.begin(), sphereEntities.end());
+	indexed.insert(indexed.end(), pointLightEntities.begin(), pointLightEntities.end());
 
-	
+	for (auto& handle : indexed)
+	{
+		GameEntity* entity = entityPool.Get(handle);
+		Mesh* mesh = meshPool.Get(entity->GetMesh());
+		if (!mesh)
+			continue;
+		entity->UpdateWorldMatrix();
+
+		XMFLOAT3 boundsMin, boundsMax;
+		entity->GetWorldBounds(mesh, boundsMin, boundsMax);
+		entity->SetSpatialProxy(spatialTree.Insert(boundsMin, boundsMax, handle.value));
+	}
 
+	//Start from a clean top-down build rather than insertion order
+	spatialTree.Rebuild();
 }
 
 void Game::OnResize()
@@ -521,87 +704,710 @@ void Game::OnResize()
 	// camera exists
 	if (camera)
 		camera->UpdateProjectionMatrix((float)width / height);
+
+	// The g-buffer follows the window size
+	if (gBufferPosition != RenderGraph::InvalidHandle)
+		RenderGraphResize();
 }
 
 void Game::Update(float deltaTime, float totalTime)
 {
-	camera->Update(deltaTime);
-	
-	//Update Spheres
-	for (int i = 0; i <= 8; i++)
+	//Runs once per fixed tick - remember where everything was
+	//so Draw can blend between this tick and the last
+	auto saveTransforms = [this](unsigned int begin, unsigned int end)
 	{
-		sphereEntities[i]->UpdateWorldMatrix();
-	}
-
-	//Update Flats
-	for (int i = 0; i <= 3; i++)
-	{
-		flatEntities[i]->UpdateWorldMatrix();
-	}
-
-	pointLightEntity1->UpdateWorldMatrix();
-	pointLightEntity2->UpdateWorldMatrix();
-	pointLightEntity3->UpdateWorldMatrix();
-	pointLightEntity4->UpdateWorldMatrix();
-	pointLightEntity5->UpdateWorldMatrix();
-	pointLightEntity6->UpdateWorldMatrix();
-	pointLightEntity7->UpdateWorldMatrix();
-	pointLightEntity8->UpdateWorldMatrix();
+		for (unsigned int i = begin; i < end; i++)
+		{
+			GameEntity* entity = entityPool.GetBySlot(i);
+			if (entity)
+				entity->SavePreviousTransform();
+		}
+	};
+	jobSystem.ParallelFor(entityPool.GetSlotRange(), 64, saveTransforms);
 	
-	//for (auto& pLE : pointLightEntities) pLE->UpdateWorldMatrix();
 	//Switch g-buffer
 	/*if (GetAsyncKeyState('1') & 0x8000) switcher = 1;
 	if (GetAsyncKeyState('2') & 0x8000) switcher = 2;
 	if (GetAsyncKeyState('3') & 0x8000) switcher = 3;*/
 	//if (GetAsyncKeyState('4') & 0x8000) switcher = 4;
 
+#if defined(DEBUG) || defined(_DEBUG)
+	//Debug keys, once per key press (the CPU benchmarks are the
+	//separate Benchmarks executable)
+	//O - dump the occlusion depth buffer to an image,
+	//C - toggle the static shadow cache,
+	//G - render graph passes and transient memory,
+	//F - toggle the forward path in place of the graph
+	bool occlusionKey = (GetAsyncKeyState('O') & 0x8000) != 0;
+	bool shadowCacheKey = (GetAsyncKeyState('C') & 0x8000) != 0;
+	bool graphKey = (GetAsyncKeyState('G') & 0x8000) != 0;
+	bool forwardKey = (GetAsyncKeyState('F') & 0x8000) != 0;
+	if (!debugKeyDown)
+	{
+		if (shadowCacheKey)
+		{
+			shadowCacheEnabled = !shadowCacheEnabled;
+			printf("\nStatic shadow cache %s\n", shadowCacheEnabled ? "on" : "off");
+		}
+		if (graphKey) graphReportRequested = true;
+		if (forwardKey)
+		{
+			forwardEnabled = !forwardEnabled;
+			printf("\nForward path %s\n", forwardEnabled ? "on" : "off");
+		}
+		if (occlusionKey && !occlusionRasterized)
+		{
+			occlusionCuller.Rasterize(jobSystem);
+			occlusionRasterized = true;
+		}
+		if (occlusionKey && occlusionCuller.DumpDepth("occlusion_depth.pgm"))
+			printf("\nOcclusion depth written to occlusion_depth.pgm (%u triangles)\n", occlusionCuller.GetTriangleCount());
+	}
+	debugKeyDown = occlusionKey || shadowCacheKey || graphKey || forwardKey;
+#endif
 
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 }
 
-void Game::Draw(float deltaTime, float totalTime)
+// --------------------------------------------------------
+// Runs on the game thread once per frame, after updating.
+// Copies everything Draw needs into the next render snapshot,
+// since Draw may be running on the render thread.
+// --------------------------------------------------------
+void Game::PublishFrame(float deltaTime, float totalTime)
 {
-	// Background color for clearing
-	const float color[4] = {0.0f, 0.0f, 0.0f, 1.0f };
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	//Everything allocated since the last publish, on any thread
+	unsigned long long heapCount = HeapCounter::GetCount();
+	heapAllocationsLastFrame = (unsigned int)(heapCount - heapCountAtPublish);
+	heapCountAtPublish = heapCount;
+
+	//The camera is driven per frame so it stays smooth at any tick rate
+	camera->Update(deltaTime);
+
+	//Build world matrices between the last two ticks
+	float alpha = interpolationAlpha;
+	auto updateEntities = [this, alpha](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			GameEntity* entity = entityPool.GetBySlot(i);
+			if (entity)
+				entity->UpdateWorldMatrix(alpha);
+		}
+	};
+	jobSystem.ParallelFor(entityPool.GetSlotRange(), 64, updateEntities);
+
+	//Keep the spatial index in step - most moves stay inside
+	//their fat boxes and cost nothing
+	for (unsigned int i = 0; i < entityPool.GetSlotRange(); i++)
+	{
+		GameEntity* entity = entityPool.GetBySlot(i);
+		if (!entity || entity->GetSpatialProxy() < 0)
+			continue;
+
+		Mesh* mesh = meshPool.Get(entity->GetMesh());
+		if (!mesh)
+			continue;
 
-	//Render Spheres
-	//for (int i = 0; i <= 8 ; i++) 
-	//{
-	//	render.RenderProcess(sphereEntities[i], vertexBuffer, indexBuffer, baseVertexShader, basePixelShader, camera, context);
-	//}
+		XMFLOAT3 boundsMin, boundsMax;
+		entity->GetWorldBounds(mesh, boundsMin, boundsMax);
+		spatialTree.Move(entity->GetSpatialProxy(), boundsMin, boundsMax);
+	}
+	spatialTree.Optimize();
+
+	RenderSnapshot& frame = snapshots.GetWriteSnapshot();
+	frame.Clear();
+
+	frame.camera.view = camera->GetView();
+	frame.camera.projection = camera->GetProjection();
+	frame.camera.position = camera->GetPosition();
+
+	//Needed before the draws are sorted, which fills forwardItems
+	frame.forwardEnabled = forwardEnabled;
+
+	const XMFLOAT4* planes = camera->GetFrustumPlanes();
+	for (int i = 0; i < 6; i++)
+		frame.camera.frustumPlanes[i] = planes[i];
+
+	//Last frame's lists are all gone, so start them over
+	updateArena.Reset();
+	RestartInArena(drawCandidates, updateArena);
+	RestartInArena(candidateBounds, updateArena);
+	RestartInArena(candidateSlots, updateArena);
+	RestartInArena(lightCandidates, updateArena);
+	RestartInArena(lightBounds, updateArena);
+	RestartInArena(lightSlots, updateArena);
+	RestartInArena(casterCandidates, updateArena);
+	RestartInArena(casterStatic, updateArena);
+
+	//Point lights - the position comes from the (transposed) world
+	//matrix so it matches the interpolated light volume.  A light
+	//only reaches as far as both its volume and the lighting
+	//shader's range, so that's the box we cull.
+	auto addLight = [this](Handle<GameEntity> handle, GameEntity* entity)
+	{
+		Mesh* mesh = meshPool.Get(entity->GetMesh());
+		if (!mesh)
+			return;
+
+		XMFLOAT4X4& world = *entity->GetWorldMatrix();
+		LightItem item = { mesh, world, XMFLOAT3(world._14, world._24, world._34), entity->GetLightColor() };
+		lightCandidates.push_back(item);
+		lightSlots.push_back(handle.GetIndex());
+
+		XMVECTOR boundsMin, boundsMax;
+		XMFLOAT3 volumeMin, volumeMax;
+		entity->GetWorldBounds(mesh, volumeMin, volumeMax);
+		XMVECTOR position = XMLoadFloat3(&item.position);
+		XMVECTOR range = XMVectorReplicate(PointLightRange);
+		boundsMin = XMVectorMax(XMLoadFloat3(&volumeMin), XMVectorSubtract(position, range));
+		boundsMax = XMVectorMin(XMLoadFloat3(&volumeMax), XMVectorAdd(position, range));
+
+		XMFLOAT3 cullMin, cullMax;
+		XMStoreFloat3(&cullMin, boundsMin);
+		XMStoreFloat3(&cullMax, boundsMax);
+		lightCuller.Add(cullMin, cullMax);
+		lightBounds.push_back(cullMin);
+		lightBounds.push_back(cullMax);
+	};
+
+	//Gather everything near the view from the spatial index.  Its
+	//fat boxes only narrow things down - drawn entities go on to
+	//the g-buffer culler and lights to the light culler, which
+	//test their real bounds four at a time...
+	frustumCuller.Clear();
+	lightCuller.Clear();
+	auto gatherVisible = [this, &addLight](unsigned int userData)
+	{
+		Handle<GameEntity> handle;
+		handle.value = userData;
+		GameEntity* entity = entityPool.Get(handle);
+		if (!entity)
+			return;
+
+		if (entity->IsLight())
+		{
+			addLight(handle, entity);
+			return;
+		}
+
+		DrawItem item;
+		if (!ResolveDrawItem(entity, item))
+			return;
+		drawCandidates.push_back(item);
+
+		XMFLOAT3 boundsMin, boundsMax;
+		entity->GetWorldBounds(item.mesh, boundsMin, boundsMax);
+		frustumCuller.Add(boundsMin, boundsMax);
+		candidateBounds.push_back(boundsMin);
+		candidateBounds.push_back(boundsMax);
+		candidateSlots.push_back(handle.GetIndex());
+	};
+	spatialTree.QueryPlanes(planes, 6, gatherVisible);
+
+	//...drop what's off screen or too small to notice...
+	float pixelScale = frame.camera.projection._22 * height * 0.5f;
+	frustumCuller.SetContributionCull(frame.camera.position, pixelScale, minScreenRadius);
+	frustumCuller.Cull(planes, jobSystem, visibleDraws);
+
+	//...then queue the static ones as occluders (the camera's
+	//matrices are stored transposed for the shaders).  They're
+	//only rasterized once something actually needs testing...
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&frame.camera.view));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&frame.camera.projection));
+	XMStoreFloat4x4(&cullViewProjection, XMMatrixMultiply(view, projection));
+	occlusionCuller.Begin(XMLoadFloat4x4(&cullViewProjection));
+	for (unsigned int i = 0; i < drawCandidates.size(); i++)
+	{
+		GameEntity* entity = entityPool.GetBySlot(candidateSlots[i]);
+		if (!entity->IsStatic())
+			continue;
 
-	//Render Flats
-	/*for (int i = 0; i <= 3; i++)
+		Mesh* mesh = drawCandidates[i].mesh;
+		occlusionCuller.AddOccluderBox(mesh->GetBoundsMin(), mesh->GetBoundsMax(), XMMatrixTranspose(XMLoadFloat4x4(entity->GetWorldMatrix())));
+	}
+	cullFrame++;
+	occlusionRasterized = false;
+	occlusionTests = 0;
+
+	//Newest GPU depth, if another has come back
+	depthReadback.TakeLatest(readbackDepth, readbackWidth, readbackHeight, readbackViewProjection);
+
+	//...and only send what can be seen past them, sorted by key
+	float projScaleX = frame.camera.projection._11;
+	float projScaleY = frame.camera.projection._22;
+	float nearZ = -frame.camera.projection._34 / frame.camera.projection._33;
+	float farZ = frame.camera.projection._34 / (1.0f - frame.camera.projection._33);
+
+	occludedDraws = 0;
+	drawKeys.clear();
+	drawOrder.clear();
+	for (unsigned int index : visibleDraws)
 	{
-		render.RenderProcess(flatEntities[i], vertexBuffer, indexBuffer, baseVertexShader, basePixelShader, camera, context);
+		const XMFLOAT3& boundsMin = candidateBounds[index * 2];
+		const XMFLOAT3& boundsMax = candidateBounds[index * 2 + 1];
+		//Occluders would only hide themselves
+		bool occluder = entityPool.GetBySlot(candidateSlots[index])->IsStatic();
+		if (!occluder && !TestOcclusion(candidateSlots[index], boundsMin, boundsMax))
+		{
+			occludedDraws++;
+			continue;
+		}
+
+		const DrawItem& item = drawCandidates[index];
+		SimplePixelShader* shader = item.material->GetPixelShader();
+		unsigned int shaderId = (unsigned int)(std::find(sortShaders.begin(), sortShaders.end(), shader) - sortShaders.begin());
+		if (shaderId == sortShaders.size())
+			sortShaders.push_back(shader);
+
+		XMVECTOR center = XMVectorScale(XMVectorAdd(XMLoadFloat3(&boundsMin), XMLoadFloat3(&boundsMax)), 0.5f);
+		float viewDepth = XMVectorGetZ(XMVector3Transform(center, view));
+
+		drawKeys.push_back(DrawSorter::MakeKey(DrawSorter::PassGBuffer, shaderId,
+			materialPool.GetSlot(item.material), meshPool.GetSlot(item.mesh), viewDepth, nearZ, farZ));
+		drawOrder.push_back(index);
 	}
 
-	render.RenderSkyBox(cubeMesh, vertexBuffer, indexBuffer, skyVertexShader, skyPixelShader, camera, context, skyRasterizerState, skyDepthState, skySRV);*/
+	//Sorting leaves each mesh and material pair in one run, and
+	//each run becomes a single instanced draw
+	drawSorter.Sort(drawKeys, drawOrder, jobSystem);
+	for (unsigned int index : drawOrder)
+	{
+		const DrawItem& item = drawCandidates[index];
+		if (frame.forwardEnabled)
+			frame.forwardItems.push_back(item);
+		if (frame.drawBatches.empty() || frame.drawBatches.back().packet != item.gBufferPacket)
+		{
+			DrawBatch batch = { item.gBufferPacket, (unsigned int)frame.instanceWorlds.size(), 0 };
+			frame.drawBatches.push_back(batch);
+		}
+		frame.instanceWorlds.push_back(item.world);
+		frame.drawBatches.back().instanceCount++;
+	}
+	drawBatchCount = (unsigned int)frame.drawBatches.size();
 
-//-----------------------------
-	context->OMSetRenderTargets(3, renderTargetViewArray, depthStencilViewDR);
-	context->RSSetViewports(1, &viewportDR);
+	//Any static caster moving means every cached cascade is stale
+	staticShadowWorlds.resize(flatEntities.size());
+	for (unsigned int i = 0; i < flatEntities.size(); i++)
+	{
+		const XMFLOAT4X4& world = *entityPool.Get(flatEntities[i])->GetWorldMatrix();
+		if (memcmp(&world, &staticShadowWorlds[i], sizeof(XMFLOAT4X4)) != 0)
+		{
+			staticShadowWorlds[i] = world;
+			staticShadowVersion++;
+		}
+	}
+	frame.staticShadowVersion = staticShadowVersion;
+	frame.shadowCacheEnabled = shadowCacheEnabled;
+	DrawItem sky;
+	GameEntity* skyBox = entityPool.Get(skyBoxEntity);
+	if (forwardEnabled && skyBox && ResolveDrawItem(skyBox, sky))
+	{
+		frame.skyMesh = sky.mesh;
+		frame.skyTexture = sky.texture;
+	}
 
-	context->ClearRenderTargetView(renderTargetViewArray[0], color);
-	context->ClearRenderTargetView(renderTargetViewArray[1], color);
-	context->ClearRenderTargetView(renderTargetViewArray[2], color);
+	//Shadow cascades follow the camera.  Each gets whatever the
+	//spatial index finds inside its caster volume, however small
+	//or hidden from the camera, then the caster culler tests
+	//those exactly.
+	shadowCascades.Fit(view, projection, XMLoadFloat3(&SunDirection));
+	frame.shadowCascadeCount = shadowCascades.GetCascadeCount();
+	auto gatherCaster = [this](unsigned int userData)
+	{
+		Handle<GameEntity> handle;
+		handle.value = userData;
+		GameEntity* entity = entityPool.Get(handle);
+		DrawItem item;
+		if (!entity || entity->IsLight() || !ResolveDrawItem(entity, item))
+			return;
+
+		XMFLOAT3 boundsMin, boundsMax;
+		entity->GetWorldBounds(item.mesh, boundsMin, boundsMax);
+		casterCuller.Add(boundsMin, boundsMax);
+		casterCandidates.push_back(item);
+		casterStatic.push_back(entity->IsStatic() ? 1 : 0);
+	};
+	for (unsigned int c = 0; c < frame.shadowCascadeCount; c++)
+	{
+		const ShadowCascades::Cascade& cascade = shadowCascades.GetCascade(c);
+		ShadowCascadeSnapshot& shadow = frame.shadowCascades[c];
+		XMStoreFloat4x4(&shadow.viewProjection, XMMatrixTranspose(XMLoadFloat4x4(&cascade.viewProjection)));
+		shadow.splitFar = cascade.splitFar;
+
+		casterCuller.Clear();
+		casterCandidates.clear();
+		casterStatic.clear();
+		spatialTree.QueryPlanes(cascade.casterPlanes, 6, gatherCaster);
+		casterCuller.Cull(cascade.casterPlanes, jobSystem, shadowCasters);
+		for (unsigned int index : shadowCasters)
+		{
+			if (casterStatic[index])
+				shadow.staticCasters.push_back(casterCandidates[index]);
+			else
+				shadow.casters.push_back(casterCandidates[index]);
+		}
+	}
 
-	context->ClearDepthStencilView(depthStencilViewDR, D3D11_CLEAR_DEPTH , 1.0f, 0);
+	//Off screen and tiny lights go first, then any buried behind the
+	//occluders - every surface that could be seen there is in
+	//front of the light, so it has nothing left to shade - and any
+	//with nothing drawn in reach at all.  The rest only shade the
+	//screen rectangle of their reach, which the lighting shader
+	//clips to since they share one draw.
+	lightCuller.SetContributionCull(frame.camera.position, pixelScale, minScreenRadius);
+	lightCuller.Cull(planes, jobSystem, visibleLights);
+	lightsSubmitted = (unsigned int)pointLightEntities.size();
+	lightsShaded = 0;
+
+	for (unsigned int index : visibleLights)
+	{
+		const XMFLOAT3& boundsMin = lightBounds[index * 2];
+		const XMFLOAT3& boundsMax = lightBounds[index * 2 + 1];
+		if (!TestOcclusion(lightSlots[index], boundsMin, boundsMax))
+			continue;
+
+		LightItem& item = lightCandidates[index];
+		XMFLOAT3 viewCenter;
+		XMStoreFloat3(&viewCenter, XMVector3Transform(XMLoadFloat3(&item.position), view));
+		float radius = min(PointLightRange, (boundsMax.x - boundsMin.x) * 0.5f);
+
+		bool reachesSurface = false;
+		auto findSurface = [this, &reachesSurface](unsigned int userData)
+		{
+			Handle<GameEntity> handle;
+			handle.value = userData;
+			GameEntity* entity = entityPool.Get(handle);
+			if (entity && !entity->IsLight())
+				reachesSurface = true;
+		};
+		spatialTree.QuerySphere(item.position, radius, findSurface);
+		if (!reachesSurface)
+			continue;
+
+		ScreenRect rect;
+		if (!ProjectSphere(viewCenter.x, viewCenter.y, viewCenter.z, radius, projScaleX, projScaleY, nearZ, (float)width, (float)height, rect))
+			continue;
+
+		LightInstance instance;
+		instance.position = item.position;
+		instance.color = item.color;
+		float left = floorf(rect.left), top = floorf(rect.top), right = ceilf(rect.right), bottom = ceilf(rect.bottom);
+		if (left >= right || top >= bottom)
+			continue;
+
+		//The vertex shader clips against it in NDC, where y points up
+		instance.scissor = XMFLOAT4(left / width * 2.0f - 1.0f, 1.0f - bottom / height * 2.0f,
+			right / width * 2.0f - 1.0f, 1.0f - top / height * 2.0f);
+
+		//The volume is a uniformly scaled sphere, so its box is square
+		XMFLOAT3 volumeMin, volumeMax;
+		entityPool.GetBySlot(lightSlots[index])->GetWorldBounds(item.mesh, volumeMin, volumeMax);
+		instance.radius = (volumeMax.x - volumeMin.x) * 0.5f;
+
+		//Every light shares the one sphere mesh
+		frame.lightVolumeMesh = item.mesh;
+		frame.lightInstances.push_back(instance);
+		lightsShaded++;
+	}
+	lightsCulled = lightsSubmitted - lightsShaded;
 
-	for (int i = 0; i <= 3; i++)
+	snapshots.Publish();
+}
+
+// --------------------------------------------------------
+// Occlusion test with temporal coherence.  The visible set
+// hardly changes from frame to frame, so anything that passed
+// last frame is drawn again untested, apart from a rotating
+// slice re-checked each frame to catch what has since been
+// hidden.  Everything else - hidden last frame, or just come
+// into view - is always tested against this frame's depth, so
+// nothing that should appear is ever held back.
+// --------------------------------------------------------
+bool Game::TestOcclusion(unsigned int entitySlot, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	bool wasVisible = lastVisibleFrame[entitySlot] == cullFrame - 1;
+	bool revalidate = (entitySlot + cullFrame) % OcclusionRevalidateFrames == 0;
+
+	bool visible = true;
+	if (!wasVisible || revalidate)
 	{
-		render.RenderGBuffer(flatEntities[i], vertexBuffer, indexBuffer, deferredVertexShader, deferredPixelShader, camera, context);
+		if (!occlusionRasterized)
+		{
+			occlusionCuller.Rasterize(jobSystem);
+			if (!readbackDepth.empty())
+			{
+				depthPyramid.Reproject(&readbackDepth[0], readbackWidth, readbackHeight,
+					XMLoadFloat4x4(&readbackViewProjection), XMLoadFloat4x4(&cullViewProjection));
+			}
+			occlusionRasterized = true;
+		}
+
+		//Hidden if either the occluders or the old GPU depth says so
+		visible = occlusionCuller.IsVisible(boundsMin, boundsMax) && depthPyramid.IsVisible(boundsMin, boundsMax);
+		occlusionTests++;
 	}
 
-	for (int i = 0; i <= 8; i++)
+	if (visible)
+		lastVisibleFrame[entitySlot] = cullFrame;
+	return visible;
+}
+
+// --------------------------------------------------------
+// Copies a frame's per instance data to the GPU in one map,
+// growing the buffer first if it doesn't fit
+// --------------------------------------------------------
+void Game::UploadInstances(ID3D11Buffer*& buffer, unsigned int& capacity, const void* data, unsigned int count, unsigned int stride)
+{
+	if (count == 0)
+		return;
+
+	if (count > capacity)
 	{
-		render.RenderGBuffer(sphereEntities[i], vertexBuffer, indexBuffer, deferredVertexShader, deferredPixelShader, camera, context);
+		if (buffer) buffer->Release();
+		buffer = 0;
+
+		capacity = max(capacity * 2, count);
+		capacity = max(capacity, 256u);
+
+		D3D11_BUFFER_DESC instanceDesc = {};
+		instanceDesc.ByteWidth = stride * capacity;
+		instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		device->CreateBuffer(&instanceDesc, 0, &buffer);
 	}
 
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+	{
+		memcpy(mapped.pData, data, stride * count);
+		context->Unmap(buffer, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Replays everything recorded so far onto the context, in
+// between whatever the pass does directly around it
+// --------------------------------------------------------
+void Game::SubmitCommands()
+{
+	commandBackend.Execute(commandBuffer);
+	commandBuffer.Clear();
+}
+
+// --------------------------------------------------------
+// Culling results and heap traffic for the title bar
+// --------------------------------------------------------
+std::string Game::GetDebugStats()
+{
+	char heapStats[64] = "";
+	if (HeapCounter::IsEnabled())
+		sprintf_s(heapStats, "    Heap allocs: %u", heapAllocationsLastFrame);
+
+	char stats[384];
+	sprintf_s(stats, "    Visible: %u/%u in %u draws  Occluded: %u (%u tests)    Lights: %u shaded, %u culled of %u    Shadow draws: %u (%u cached)    State calls: %u (%u filtered)    Constants: %u bytes%s",
+		(unsigned int)visibleDraws.size() - occludedDraws, frustumCuller.GetCount(), drawBatchCount, occludedDraws, occlusionTests,
+		lightsShaded, lightsCulled, lightsSubmitted, shadowDraws.load(), shadowDrawsSaved.load(),
+		stateCallsIssued.load(), stateCallsFiltered.load(), constantBytesUploaded.load(), heapStats);
+	return stats;
+}
+
+void Game::Draw(float deltaTime, float totalTime)
+{
+	//Only ever draw from the newest published snapshot - the
+	//game thread may be busy changing the entities themselves
+	snapshots.Acquire();
+	const RenderSnapshot& frame = snapshots.GetReadSnapshot();
+
+	//Collect any depth readbacks the GPU has finished
+	depthReadback.Poll(context);
+
+	//Nothing bound is known at the start of a frame
+	stateCache.Invalidate();
+	stateCache.ResetStats();
+
+	//Last frame's commands are all gone, so their memory can be reused
+	commandBuffer.Clear();
+	frameArena.Reset();
+
 //-----------------------------
+	//Every pass, with its targets bound and cleared by the graph
+	drawFrame = &frame;
+	deferredConstantBytes = 0;
+	if (frame.forwardEnabled)
+		DrawForwardFrame(frame);
+	else
+		renderGraph.Execute();
+	drawFrame = 0;
+
+	//The graph belongs to the render thread, so it reports here
+	//between frames rather than when the key was pressed
+	if (graphReportRequested.exchange(false))
+		renderGraph.PrintReport();
+
+	stateCallsIssued = stateCache.GetIssuedCount();
+	stateCallsFiltered = stateCache.GetFilteredCount();
+	constantBytesUploaded = stateCache.GetConstantBytes() + deferredConstantBytes;
+//--------------------------	
+	swapChain->Present(0, 0);
+}
+
+// --------------------------------------------------------
+// G-buffer pass - every visible batch, recorded in parallel
+// when there are enough of them
+// --------------------------------------------------------
+void Game::DrawGBufferPass(const RenderSnapshot& frame)
+{
+	UploadInstances(instanceBuffer, instanceCapacity, frame.instanceWorlds.data(), (unsigned int)frame.instanceWorlds.size(), sizeof(XMFLOAT4X4));
+	unsigned int batchCount = (unsigned int)frame.drawBatches.size();
+	if (deferredRecorder.ShouldSplit(batchCount))
+	{
+		//Each range goes to its own deferred context, and the
+		//command lists play back in sorted order
+		auto recordBatches = [&](unsigned int begin, unsigned int end, CommandBuffer& commands)
+		{
+			//Every deferred context starts with nothing bound
+			render.RecordGBufferFrame(deferredInstancedVertexShader, frame.camera, commands);
+			for (unsigned int i = begin; i < end; i++)
+				render.RenderGBufferInstanced(frame.drawBatches[i], instanceBuffer, commands);
+		};
+		ID3D11RenderTargetView* targets[3] = { renderGraph.GetTexture(gBufferPosition).rtv, renderGraph.GetTexture(gBufferNormal).rtv, renderGraph.GetTexture(gBufferDiffuse).rtv };
+		D3D11_VIEWPORT viewportDR = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+		DeferredRecorder::Pass gBufferPass = { 3, targets, renderGraph.GetTexture(gBufferDepth).dsv, viewportDR, 0 };
+		deferredRecorder.Record(batchCount, gBufferPass, jobSystem, recordBatches);
+		deferredConstantBytes = deferredRecorder.GetConstantBytes();
+		deferredRecorder.Execute(context);
+		stateCache.Invalidate();
+	}
+	else
+	{
+		render.RecordGBufferFrame(deferredInstancedVertexShader, frame.camera, commandBuffer);
+		for (auto& batch : frame.drawBatches)
+			render.RenderGBufferInstanced(batch, instanceBuffer, commandBuffer);
+		SubmitCommands();
+	}
+}
+
+// --------------------------------------------------------
+// Sends a small copy of the g-buffer depth back for occlusion
+// culling, before the lighting pass clears it
+// --------------------------------------------------------
+void Game::DrawDepthReadbackPass(const RenderSnapshot& frame)
+{
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(
+		XMMatrixTranspose(XMLoadFloat4x4(&frame.camera.view)),
+		XMMatrixTranspose(XMLoadFloat4x4(&frame.camera.projection))));
+	stateCache.SetRenderTargets(0, 0, 0);
+	depthReadback.Capture(context, renderGraph.GetTexture(gBufferDepth).srv, dirLightVertexShader, depthDownsamplePixelShader, viewProjection);
+	stateCache.Invalidate();
+}
+
+// --------------------------------------------------------
+// Shadow cascades, into the shadow map array
+// --------------------------------------------------------
+void Game::DrawShadowPass(const RenderSnapshot& frame)
+{
+	//Depth only, each cascade with its own casters
+	stateCache.SetRasterizerState(shadowRasterizer);
+	context->RSSetViewports(1, &shadowViewport);
+	unsigned int castersDrawn = 0;
+	unsigned int castersSaved = 0;
+	for (unsigned int c = 0; c < frame.shadowCascadeCount; c++)
+	{
+		const ShadowCascadeSnapshot& shadow = frame.shadowCascades[c];
+		render.RecordShadowCascade(shadowVertexShader, shadow.viewProjection, commandBuffer);
+		if (frame.shadowCacheEnabled)
+		{
+			//Static casters only when the cached map is out of date...
+			bool cacheHit = shadowCacheValid[c] && cachedShadowVersion[c] == frame.staticShadowVersion &&
+				memcmp(&cachedShadowViewProjection[c], &shadow.viewProjection, sizeof(XMFLOAT4X4)) == 0;
+			if (cacheHit)
+			{
+				castersSaved += (unsigned int)shadow.staticCasters.size();
+			}
+			else
+			{
+				stateCache.SetRenderTargets(0, 0, staticShadowDSV[c]);
+				context->ClearDepthStencilView(staticShadowDSV[c], D3D11_CLEAR_DEPTH, 1.0f, 0);
+				for (auto& caster : shadow.staticCasters)
+					render.RenderShadowCaster(caster, commandBuffer);
+				SubmitCommands();
+				castersDrawn += (unsigned int)shadow.staticCasters.size();
+
+				cachedShadowViewProjection[c] = shadow.viewProjection;
+				cachedShadowVersion[c] = frame.staticShadowVersion;
+				shadowCacheValid[c] = true;
+			}
+
+			//...then the dynamic ones over a copy of it
+			stateCache.SetRenderTargets(0, 0, 0);
+			UINT subresource = D3D11CalcSubresource(0, c, 1);
+			context->CopySubresourceRegion(shadowMapTexture, subresource, 0, 0, 0, staticShadowTexture, subresource, 0);
+			stateCache.SetRenderTargets(0, 0, shadowDSV[c]);
+		}
+		else
+		{
+			shadowCacheValid[c] = false;
+			stateCache.SetRenderTargets(0, 0, shadowDSV[c]);
+			context->ClearDepthStencilView(shadowDSV[c], D3D11_CLEAR_DEPTH, 1.0f, 0);
+			for (auto& caster : shadow.staticCasters)
+				render.RenderShadowCaster(caster, commandBuffer);
+			castersDrawn += (unsigned int)shadow.staticCasters.size();
+		}
+
+		for (auto& caster : shadow.casters)
+			render.RenderShadowCaster(caster, commandBuffer);
+		SubmitCommands();
+		castersDrawn += (unsigned int)shadow.casters.size();
+	}
+	shadowDraws = castersDrawn;
+	shadowDrawsSaved = castersSaved;
+}
+
+// --------------------------------------------------------
+// Every visible entity lit in one pass with the forward
+// shaders, then the sky - straight into the back buffer
+// --------------------------------------------------------
+void Game::DrawForwardFrame(const RenderSnapshot& frame)
+{
+	const float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	D3D11_VIEWPORT forwardViewport = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+	stateCache.SetRenderTargets(1, &backBufferRTV, depthStencilView);
+	context->RSSetViewports(1, &forwardViewport);
+	context->ClearRenderTargetView(backBufferRTV, color);
+	context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	//The graph's passes leave their own states behind
+	stateCache.SetRasterizerState(0);
+	stateCache.SetDepthStencilState(0, 0);
+	stateCache.SetBlendState(0, 0, 0xffffffff);
+
+	//Forward lights and camera, once for every draw below
+	render.SetForwardFrame(baseVertexShader, basePixelShader, frame.camera, pointLightBuffer, spotLightBuffer, context);
+	for (const DrawItem& item : frame.forwardItems)
+		render.RenderProcess(item, vertexBuffer, indexBuffer, baseVertexShader, basePixelShader, context);
+
+	if (frame.skyMesh)
+	{
+		Mesh* skyMesh = frame.skyMesh;
+		ID3D11ShaderResourceView* skyTexture = frame.skyTexture;
+		render.RenderSkyBox(skyMesh, vertexBuffer, indexBuffer, skyVertexShader, skyPixelShader, frame.camera, context, skyRasterizerState, skyDepthState, skyTexture);
+	}
+}
+
+// --------------------------------------------------------
+// Directional light, then every point light volume, added
+// into the back buffer
+// --------------------------------------------------------
+void Game::DrawLightingPass(const RenderSnapshot& frame)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	ID3D11ShaderResourceView* gBuffer[3] = { renderGraph.GetTexture(gBufferPosition).srv, renderGraph.GetTexture(gBufferNormal).srv, renderGraph.GetTexture(gBufferDiffuse).srv };
+
 /*
 	context->OMSetRenderTargets(1, &backBufferRTV, 0);
 	context->RSSetViewports(1, &viewport);
@@ -614,13 +1420,13 @@ void Game::Draw(float deltaTime, float totalTime)
 	switch (switcher)
 	{
 	case 1:
-		displayPixelShader->SetShaderResourceView("Texture", shaderResourceViewArray[0]);
+		displayPixelShader->SetShaderResourceView("Texture", renderGraph.GetTexture(gBufferPosition).srv);
 		break;
 	case 2:
-		displayPixelShader->SetShaderResourceView("Texture", shaderResourceViewArray[1]);
+		displayPixelShader->SetShaderResourceView("Texture", renderGraph.GetTexture(gBufferNormal).srv);
 		break;
 	case 3:
-		displayPixelShader->SetShaderResourceView("Texture", shaderResourceViewArray[2]);
+		displayPixelShader->SetShaderResourceView("Texture", renderGraph.GetTexture(gBufferDiffuse).srv);
 		break;
 	//case 4:
 		//displayPixelShader->SetShaderResourceView("Texture", depthSRV);
@@ -640,18 +1446,11 @@ void Game::Draw(float deltaTime, float totalTime)
 	context->Draw(3, 0);
 	displayPixelShader->SetShaderResourceView("Texture", 0);
 	/**/
-//-------------------	
-	
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilViewDR);
-	context->RSSetViewports(1, &viewport);
-
-	context->ClearRenderTargetView(backBufferRTV, color);
-	context->ClearDepthStencilView(depthStencilViewDR, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
-	context->RSSetState(rasterizerDR);
+	stateCache.SetRasterizerState(rasterizerDR);
 	float blend[4] = { 1,1,1,1 };
-	context->OMSetBlendState(blendDR, blend, 0xFFFFFFFF);
-	context->OMSetDepthStencilState(depthStateDR, 0);
+	stateCache.SetBlendState(blendDR, blend, 0xFFFFFFFF);
+	stateCache.SetDepthStencilState(depthStateDR, 0);
 
 	//----------------DirLightPassTry
 
@@ -659,48 +1458,55 @@ void Game::Draw(float deltaTime, float totalTime)
 
 	dirLightVertexShader->SetShader();
 
-	dirLightPixelShader->SetShaderResourceView("positionGB", shaderResourceViewArray[0]);
-	dirLightPixelShader->SetShaderResourceView("normalGB", shaderResourceViewArray[1]);
-	dirLightPixelShader->SetShaderResourceView("diffuseGB", shaderResourceViewArray[2]);
+	dirLightPixelShader->SetShaderResourceView("positionGB", gBuffer[0]);
+	dirLightPixelShader->SetShaderResourceView("normalGB", gBuffer[1]);
+	dirLightPixelShader->SetShaderResourceView("diffuseGB", gBuffer[2]);
 	displayPixelShader->SetSamplerState("Sampler", sampler);
 
 	dirLightPixelShader->SetFloat3("lightColor", XMFLOAT3(0.5f, 0.5f, 0.5f));
-	dirLightPixelShader->SetFloat3("lightDir", XMFLOAT3(10.0f, -10.0f, 0.0f));
+	dirLightPixelShader->SetFloat3("lightDir", SunDirection);
+
+	XMFLOAT4X4 shadowMatrices[ShadowCascades::MaxCascades];
+	float cascadeSplits[ShadowCascades::MaxCascades] = {};
+	for (unsigned int c = 0; c < frame.shadowCascadeCount; c++)
+	{
+		shadowMatrices[c] = frame.shadowCascades[c].viewProjection;
+		cascadeSplits[c] = frame.shadowCascades[c].splitFar;
+	}
+	dirLightPixelShader->SetMatrix4x4("view", frame.camera.view);
+	dirLightPixelShader->SetData("shadowViewProjection", shadowMatrices, sizeof(shadowMatrices));
+	dirLightPixelShader->SetData("cascadeSplits", cascadeSplits, sizeof(cascadeSplits));
+	dirLightPixelShader->SetInt("cascadeCount", (int)frame.shadowCascadeCount);
+	dirLightPixelShader->SetShaderResourceView("shadowMap", renderGraph.GetTexture(shadowMapResource).srv);
+	dirLightPixelShader->SetSamplerState("shadowSampler", shadowSampler);
 
 	dirLightPixelShader->CopyAllBufferData();
 	dirLightPixelShader->SetShader();
 
 	ID3D11Buffer* nothing = 0;
-	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
-	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+	stateCache.SetVertexBuffer(0, nothing, stride, offset);
+	stateCache.SetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
 
 	context->Draw(3, 0);
-	//-----------------
-
-
-	render.RenderLights(pointLightEntity1, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
-
-	render.RenderLights(pointLightEntity2, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
-
-	render.RenderLights(pointLightEntity3, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
 
-	render.RenderLights(pointLightEntity4, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
-
-	render.RenderLights(pointLightEntity5, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
-
-	render.RenderLights(pointLightEntity6, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
+	//Unbound so the next frame can draw into it again
+	dirLightPixelShader->SetShaderResourceView("shadowMap", 0);
+	//-----------------
 
-	render.RenderLights(pointLightEntity7, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
 
-	render.RenderLights(pointLightEntity8, vertexBuffer, indexBuffer, lightingPassVertexShader, lightingPassPixelShader, camera, context, sampler, shaderResourceViewArray[0], shaderResourceViewArray[1], shaderResourceViewArray[2]);
+	//Every point light volume in one draw
+	if (!frame.lightInstances.empty())
+	{
+		UploadInstances(lightInstanceBuffer, lightInstanceCapacity, frame.lightInstances.data(), (unsigned int)frame.lightInstances.size(), sizeof(LightInstance));
+		render.RenderLightVolumes(frame.lightVolumeMesh, (unsigned int)frame.lightInstances.size(), lightInstanceBuffer, vertexBuffer, indexBuffer,
+			lightingPassVertexShader, lightingPassPixelShader, frame.camera, context, sampler, gBuffer[0], gBuffer[1], gBuffer[2]);
+	}
 
 
 //---------------
-	context->RSSetState(NULL);
-	context->OMSetBlendState(NULL, blend, 0xFFFFFFFF);
-	context->OMSetDepthStencilState(NULL, 0);
-//--------------------------	
-	swapChain->Present(0, 0);
+	stateCache.SetRasterizerState(NULL);
+	stateCache.SetBlendState(NULL, blend, 0xFFFFFFFF);
+	stateCache.SetDepthStencilState(NULL, 0);
 }
 
 #pragma region Mouse Input
@@ -8,6 +8,20 @@
 #include "Material.h"
 #include "GameEntity.h"
 #include "Render.h"
+#include "HandlePool.h"
+#include "RenderSnapshot.h"
+#include "DynamicBVH.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "DepthReadback.h"
+#include "StructuredBuffer.h"
+#include "DepthPyramid.h"
+#include "ShadowCascades.h"
+#include "DrawSorter.h"
+#include "D3D11CommandBackend.h"
+#include "LinearArena.h"
+#include "DeferredRecorder.h"
+#include "RenderGraph.h"
 
 using namespace DirectX;
 
@@ -23,6 +37,8 @@ public:
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
+	void PublishFrame(float deltaTime, float totalTime);
+	std::string GetDebugStats();
 
 	// Overridden mouse input helper methods
 	void OnMouseDown(WPARAM buttonState, int x, int y);
@@ -38,20 +54,32 @@ private:
 	void ShadersInitialize();
 	void ModelsInitialize();
 	void LoadTextures();
+	TextureHandle LoadTexture(const wchar_t* file);
 	void MaterialsInitialize();
 	void SkyBoxInitialize();
 	void GameEntityInitialize();
 	void LightsInitialize();
+	void SpatialIndexInitialize();
+	void ShadowsInitialize();
+	bool TestOcclusion(unsigned int entitySlot, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax);
+	void UploadInstances(ID3D11Buffer*& buffer, unsigned int& capacity, const void* data, unsigned int count, unsigned int stride);
+	void SubmitCommands();
+
+	//The frame as a render graph, one method per pass
+	void RenderGraphInitialize();
+	void RenderGraphResize();
+	void DrawGBufferPass(const RenderSnapshot& frame);
+	void DrawDepthReadbackPass(const RenderSnapshot& frame);
+	void DrawShadowPass(const RenderSnapshot& frame);
+	void DrawLightingPass(const RenderSnapshot& frame);
+
+	//The original forward path, drawn instead of the graph when toggled
+	void DrawForwardFrame(const RenderSnapshot& frame);
 
 
 	//Deferred Rendering Requirements
 	
-	ID3D11RenderTargetView* renderTargetViewArray[3];
-	ID3D11ShaderResourceView* shaderResourceViewArray[3];
-	ID3D11Texture2D* depthStencilBufferDR;
-	ID3D11DepthStencilView* depthStencilViewDR;
 	ID3D11DepthStencilState* depthStateDR;
-	D3D11_VIEWPORT viewportDR;
 
 	ID3D11RasterizerState* rasterizerDR;
 	ID3D11BlendState* blendDR;
@@ -59,8 +87,15 @@ private:
 	//ID3D11ShaderResourceView* depthSRV;
 
 	int switcher;
+	bool debugKeyDown;
+	bool forwardEnabled;		// Game thread's copy, published with each snapshot
+
+	//Set by the game thread, printed by the render thread once
+	//the graph has finished executing
+	std::atomic<bool> graphReportRequested;
 
 	SimpleVertexShader* deferredVertexShader;
+	SimpleVertexShader* deferredInstancedVertexShader;
 	SimplePixelShader* deferredPixelShader;
 	SimpleVertexShader* lightingPassVertexShader;
 	SimplePixelShader* lightingPassPixelShader;
@@ -68,20 +103,28 @@ private:
 	SimpleVertexShader* dirLightVertexShader;
 	SimplePixelShader* dirLightPixelShader;
 
-	GameEntity* pointLightEntity1;
-	GameEntity* pointLightEntity2;
-	GameEntity* pointLightEntity3;
-	GameEntity* pointLightEntity4;
-	GameEntity* pointLightEntity5;
-	GameEntity* pointLightEntity6;
-	GameEntity* pointLightEntity7;
-	GameEntity* pointLightEntity8;
+	SimplePixelShader* depthDownsamplePixelShader;
+	SimpleVertexShader* shadowVertexShader;
 
-	std::vector<GameEntity*> pointLightEntities;
+	std::vector<Handle<GameEntity>> pointLightEntities;
 	// Buffers to hold actual geometry data
 	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
 
+	//World matrices for instanced g-buffer draws, rewritten
+	//every frame and grown when a frame needs more
+	ID3D11Buffer* instanceBuffer;
+	unsigned int instanceCapacity;
+
+	//Forward path point and spot lights, uploaded again only
+	//when Render's lists change
+	StructuredBuffer pointLightBuffer;
+	StructuredBuffer spotLightBuffer;
+
+	//Point light volumes, all drawn in one instanced call
+	ID3D11Buffer* lightInstanceBuffer;
+	unsigned int lightInstanceCapacity;
+
 
 	//Declare shader variables
 	SimpleVertexShader* baseVertexShader;
@@ -94,45 +137,189 @@ private:
 	// Sampler for wrapping textures
 	ID3D11SamplerState* sampler;
 
+	//Resource pools - all meshes, materials, textures and
+	//entities live here and are referred to by handle
+	HandlePool<Mesh> meshPool;
+	HandlePool<Material> materialPool;
+	HandlePool<ID3D11ShaderResourceView*> texturePool;
+	HandlePool<GameEntity> entityPool;
+
+	//Every mesh and material pair's g-buffer and shadow draws,
+	//resolved as the entities using them are created
+	DrawPacketCache drawPackets;
+	Handle<GameEntity> CreateDrawnEntity(MeshHandle mesh, MaterialHandle material);
+
+	//Entities only hold handles, looked up again every frame so
+	//nothing is drawn with a mesh, material or texture that's gone
+	ID3D11ShaderResourceView* GetTexture(TextureHandle handle);
+	bool ResolveDrawItem(GameEntity* entity, DrawItem& item);
+
 	//Texture Shader Resource Views(SRVs)
-	ID3D11ShaderResourceView* earthDayMapSRV;
-	ID3D11ShaderResourceView* cobbleStoneSRV;
-	ID3D11ShaderResourceView* snowTracksSRV;
-	ID3D11ShaderResourceView* plainRedSRV;
-	ID3D11ShaderResourceView* plainYellowSRV;
+	TextureHandle earthDayMapSRV;
+	TextureHandle cobbleStoneSRV;
+	TextureHandle snowTracksSRV;
+	TextureHandle plainRedSRV;
+	TextureHandle plainYellowSRV;
 
 	//Normal Shader Resource Views(SRVs)
-	ID3D11ShaderResourceView* plainNormalMapSRV;
-	ID3D11ShaderResourceView* earthNormalMapSRV;
-	ID3D11ShaderResourceView* cobbleStoneNormalSRV;
-	ID3D11ShaderResourceView* snowTracksNormalSRV;
+	TextureHandle plainNormalMapSRV;
+	TextureHandle earthNormalMapSRV;
+	TextureHandle cobbleStoneNormalSRV;
+	TextureHandle snowTracksNormalSRV;
 
 	//Sky Box Stuff
-	ID3D11ShaderResourceView* skySRV;
+	TextureHandle skySRV;
 	ID3D11RasterizerState* skyRasterizerState;
 	ID3D11DepthStencilState* skyDepthState;
 
 	//Mesh Class
-	Mesh* sphereMesh;
-	Mesh* cubeMesh;
+	MeshHandle sphereMesh;
+	MeshHandle cubeMesh;
 
 	//Material Class
-	Material* materialEarth;
-	Material* materialCobbleStone;
-	Material* materialRed;
-	Material* materialYellow;
-	Material* materialSkyBox;
-	Material* materialSnowTracks;
-	Material* materialEmpty;
+	MaterialHandle materialEarth;
+	MaterialHandle materialCobbleStone;
+	MaterialHandle materialRed;
+	MaterialHandle materialYellow;
+	MaterialHandle materialSkyBox;
+	MaterialHandle materialSnowTracks;
+	MaterialHandle materialEmpty;
 
 	//Game Entity Class
-	GameEntity* skyBoxEntity;
-	std::vector<GameEntity*> sphereEntities;
-	std::vector<GameEntity*> flatEntities;
+	Handle<GameEntity> skyBoxEntity;
+	std::vector<Handle<GameEntity>> sphereEntities;
+	std::vector<Handle<GameEntity>> flatEntities;
+
+	//Spatial index over everything but the sky - leaves
+	//carry the entity's handle value as their user data
+	DynamicBVH spatialTree;
+
+	//Frustum culling of g-buffer draws, with this frame's results
+	FrustumCuller frustumCuller;
+	float minScreenRadius;		// Pixels - smaller draws and lights are skipped
+	ArenaVector<DrawItem> drawCandidates;
+	std::vector<unsigned int> visibleDraws;
+	ArenaVector<XMFLOAT3> candidateBounds;
+	ArenaVector<unsigned int> candidateSlots;
+
+	//Software occlusion - static entities are the occluders, and
+	//anything left hidden behind them is dropped as well
+	OcclusionCuller occlusionCuller;
+	unsigned int occludedDraws;
+
+	//Temporal coherence for occlusion - the last frame each
+	//entity slot passed, and how many real tests ran this frame
+	std::vector<unsigned int> lastVisibleFrame;
+	unsigned int cullFrame;
+	bool occlusionRasterized;
+	unsigned int occlusionTests;
+
+	//Depth from an earlier GPU frame, read back without stalling
+	//and reprojected into a Hi-Z pyramid for a second opinion
+	DepthReadback depthReadback;
+	DepthPyramid depthPyramid;
+	std::vector<float> readbackDepth;
+	unsigned int readbackWidth;
+	unsigned int readbackHeight;
+	XMFLOAT4X4 readbackViewProjection;
+	XMFLOAT4X4 cullViewProjection;
+
+	//Surviving draws are submitted in sort key order - grouped
+	//by state, then front to back
+	DrawSorter drawSorter;
+	std::vector<unsigned long long> drawKeys;
+	std::vector<unsigned int> drawOrder;
+	std::vector<SimplePixelShader*> sortShaders;	// Index is the shader's key id
+	unsigned int drawBatchCount;					// Instanced draws this frame
+
+	//Point light volumes get the same frustum and occlusion
+	//tests, so only lights that can reach a visible surface
+	//are drawn.  Counts are for this frame.
+	FrustumCuller lightCuller;
+	ArenaVector<LightItem> lightCandidates;
+	ArenaVector<XMFLOAT3> lightBounds;
+	ArenaVector<unsigned int> lightSlots;
+	std::vector<unsigned int> visibleLights;
+	unsigned int lightsSubmitted;
+	unsigned int lightsCulled;
+	unsigned int lightsShaded;
+
+	//Cascaded shadow maps for the directional light - fitted on
+	//the game thread, with one caster list per cascade gathered
+	//from the spatial index and culled like the camera's
+	ShadowCascades shadowCascades;
+	FrustumCuller casterCuller;
+	ArenaVector<DrawItem> casterCandidates;
+	ArenaVector<unsigned char> casterStatic;
+	std::vector<unsigned int> shadowCasters;
+	ID3D11Texture2D* shadowMapTexture;
+	ID3D11DepthStencilView* shadowDSV[ShadowCascades::MaxCascades];
+	ID3D11ShaderResourceView* shadowSRV;
+	ID3D11SamplerState* shadowSampler;
+	ID3D11RasterizerState* shadowRasterizer;
+	D3D11_VIEWPORT shadowViewport;
+
+	//Static shadow cache - the flats are drawn once into their
+	//own maps, which are copied under the dynamic casters each
+	//frame.  A cascade is only redrawn once it moves (the light
+	//turning moves them all) or the static version changes.
+	bool shadowCacheEnabled;
+	unsigned int staticShadowVersion;
+	std::vector<XMFLOAT4X4> staticShadowWorlds;
+	ID3D11Texture2D* staticShadowTexture;
+	ID3D11DepthStencilView* staticShadowDSV[ShadowCascades::MaxCascades];
+	XMFLOAT4X4 cachedShadowViewProjection[ShadowCascades::MaxCascades];
+	unsigned int cachedShadowVersion[ShadowCascades::MaxCascades];
+	bool shadowCacheValid[ShadowCascades::MaxCascades];
+	std::atomic<unsigned int> shadowDraws;		// Written by the render thread
+	std::atomic<unsigned int> shadowDrawsSaved;
+
+	//Redundant binds are dropped before they reach the context,
+	//with this frame's counts kept for the title bar
+	ContextStateTarget contextStateTarget;
+	StateCache stateCache;
+	std::atomic<unsigned int> stateCallsIssued;
+	std::atomic<unsigned int> stateCallsFiltered;
+	std::atomic<unsigned int> constantBytesUploaded;	// Every context, this frame
+	unsigned int deferredConstantBytes;					// Render thread only
+
+	//The game thread's throwaway lists for one frame (the
+	//candidates and their bounds) live here, handed back when
+	//the next frame starts.  Debug builds count every heap
+	//allocation so steady state can be checked to make none.
+	LinearArena updateArena;
+	unsigned long long heapCountAtPublish;
+	unsigned int heapAllocationsLastFrame;
+
+	//Render records the g-buffer and shadow draws here, out of
+	//memory that's all handed back at the start of each frame
+	LinearArena frameArena;
+	CommandBuffer commandBuffer;
+	D3D11CommandBackend commandBackend;
+
+	//Long g-buffer passes are split up and recorded on the job
+	//system, one deferred context per range
+	DeferredRecorder deferredRecorder;
+
+	//The g-buffer is transient, owned by the graph; the back
+	//buffer and shadow map are imported.  The backend has to
+	//outlive the graph, which hands its textures back to it.
+	D3D11GraphBackend graphBackend;
+	RenderGraph renderGraph;
+	unsigned int gBufferPosition;
+	unsigned int gBufferNormal;
+	unsigned int gBufferDiffuse;
+	unsigned int gBufferDepth;
+	unsigned int backBufferResource;
+	unsigned int shadowMapResource;
+	const RenderSnapshot* drawFrame;	// Only set while the graph runs
 
 	//Render Class
 	Render render;
 
+	//Frames handed from the game thread to the render thread
+	SnapshotBuffer snapshots;
+
 	//Camera class
 	Camera* camera;
 
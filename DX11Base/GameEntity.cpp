@@ -2,25 +2,38 @@
 
 
 
-GameEntity::GameEntity(Mesh *entityMesh, Material *entityMaterial)
+GameEntity::GameEntity(MeshHandle entityMesh, MaterialHandle entityMaterial)
 {
 	this->mesh = entityMesh;
 	this->material = entityMaterial;
+	gBufferPacket = 0;
+	shadowPacket = 0;
 
 	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
 	position = XMFLOAT3(0, 0, 0);
 	rotation = XMFLOAT3(0, 0, 0);
 	scale = XMFLOAT3(1, 1, 1);
+	spatialProxy = -1;
+	light = false;
+	isStatic = false;
+	SavePreviousTransform();
 }
-GameEntity::GameEntity(Mesh *entityMesh, XMFLOAT3 lightEntityColor)
+GameEntity::GameEntity(MeshHandle entityMesh, XMFLOAT3 lightEntityColor)
 {
 	this->mesh = entityMesh;
+	this->material = MaterialHandle();
+	gBufferPacket = 0;
+	shadowPacket = 0;
 
 	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
 	position = XMFLOAT3(0, 0, 0);
 	rotation = XMFLOAT3(0, 0, 0);
 	scale = XMFLOAT3(1, 1, 1);
 	lightColor = lightEntityColor;
+	spatialProxy = -1;
+	light = true;
+	isStatic = false;
+	SavePreviousTransform();
 }
 
 
@@ -28,18 +41,53 @@ GameEntity::~GameEntity()
 {
 }
 
-void GameEntity::UpdateWorldMatrix()
+void GameEntity::UpdateWorldMatrix(float alpha)
 {
-	XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
-	XMMATRIX rotX = XMMatrixRotationX(rotation.x);
-	XMMATRIX rotY = XMMatrixRotationY(rotation.y);
-	XMMATRIX rotZ = XMMatrixRotationZ(rotation.z);
-	XMMATRIX sc = XMMatrixScaling(scale.x, scale.y, scale.z);
+	XMFLOAT3 pos, rot, scl;
+	XMStoreFloat3(&pos, XMVectorLerp(XMLoadFloat3(&prevPosition), XMLoadFloat3(&position), alpha));
+	XMStoreFloat3(&rot, XMVectorLerp(XMLoadFloat3(&prevRotation), XMLoadFloat3(&rotation), alpha));
+	XMStoreFloat3(&scl, XMVectorLerp(XMLoadFloat3(&prevScale), XMLoadFloat3(&scale), alpha));
+
+	XMMATRIX trans = XMMatrixTranslation(pos.x, pos.y, pos.z);
+	XMMATRIX rotX = XMMatrixRotationX(rot.x);
+	XMMATRIX rotY = XMMatrixRotationY(rot.y);
+	XMMATRIX rotZ = XMMatrixRotationZ(rot.z);
+	XMMATRIX sc = XMMatrixScaling(scl.x, scl.y, scl.z);
 
 	XMMATRIX total = sc * rotZ * rotY * rotX * trans;
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(total));
 }
 
+void GameEntity::SavePreviousTransform()
+{
+	prevPosition = position;
+	prevRotation = rotation;
+	prevScale = scale;
+}
+
+// --------------------------------------------------------
+// Transforms the mesh's box by the world matrix, growing it
+// to stay axis-aligned (the center moves with the matrix, and
+// the extents are spread by the absolute values of its axes)
+// --------------------------------------------------------
+void GameEntity::GetWorldBounds(Mesh* mesh, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+{
+	XMFLOAT3 meshMin = mesh->GetBoundsMin();
+	XMFLOAT3 meshMax = mesh->GetBoundsMax();
+	XMVECTOR center = XMVectorScale(XMVectorAdd(XMLoadFloat3(&meshMin), XMLoadFloat3(&meshMax)), 0.5f);
+	XMVECTOR extent = XMVectorScale(XMVectorSubtract(XMLoadFloat3(&meshMax), XMLoadFloat3(&meshMin)), 0.5f);
+
+	// The stored matrix is transposed for the shaders
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&worldMatrix));
+	XMVECTOR worldCenter = XMVector3Transform(center, world);
+	XMVECTOR worldExtent = XMVectorMultiply(XMVectorSplatX(extent), XMVectorAbs(world.r[0]));
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatY(extent), XMVectorAbs(world.r[1]), worldExtent);
+	worldExtent = XMVectorMultiplyAdd(XMVectorSplatZ(extent), XMVectorAbs(world.r[2]), worldExtent);
+
+	XMStoreFloat3(&boundsMin, XMVectorSubtract(worldCenter, worldExtent));
+	XMStoreFloat3(&boundsMax, XMVectorAdd(worldCenter, worldExtent));
+}
+
 XMFLOAT3 GameEntity::GetPosition()
 {
 	return position;
@@ -6,17 +6,23 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "SimpleShader.h"
+#include "DrawPacket.h"
 
 using namespace DirectX;
 
 class GameEntity
 {
 public:
-	GameEntity(Mesh *entityMesh, Material *entityMaterial);
-	GameEntity(Mesh *entityMesh, XMFLOAT3 lightEntityColor);
+	GameEntity(MeshHandle entityMesh, MaterialHandle entityMaterial);
+	GameEntity(MeshHandle entityMesh, XMFLOAT3 lightEntityColor);
 	~GameEntity();
 
-	void UpdateWorldMatrix();
+	// Builds the world matrix, blending from the previous transform
+	// to the current one by alpha (1 = current transform only)
+	void UpdateWorldMatrix(float alpha = 1.0f);
+
+	// Call at the start of each simulation tick, before moving
+	void SavePreviousTransform();
 
 	void Move(float x, float y, float z) { position.x += x;	position.y += y;	position.z += z; }
 	void Rotate(float x, float y, float z) { rotation.x += x;	rotation.y += y;	rotation.z += z; }
@@ -28,19 +34,53 @@ public:
 	XMFLOAT3 GetPosition();
 	XMFLOAT3 GetLightColor();
 
-	Mesh* GetMesh() { return mesh; }
-	Material* GetMaterial() { return material; }
+	// Handles into the game's pools - resolve them each time they're
+	// used, since the mesh or material may have been destroyed since
+	MeshHandle GetMesh() { return mesh; }
+	MaterialHandle GetMaterial() { return material; }
 	XMFLOAT4X4* GetWorldMatrix() { return &worldMatrix; }
 
+	// Built once the entity exists - null until then, and for
+	// anything that isn't drawn through packets
+	void SetDrawPackets(const DrawPacket* gBuffer, const DrawPacket* shadow) { gBufferPacket = gBuffer; shadowPacket = shadow; }
+	const DrawPacket* GetGBufferPacket() { return gBufferPacket; }
+	const DrawPacket* GetShadowPacket() { return shadowPacket; }
+
+	// World space box around the mesh (this entity's, resolved from
+	// its handle), from the current world matrix
+	void GetWorldBounds(Mesh* mesh, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax);
+
+	// This entity's proxy in the spatial index, or -1 if it has none
+	int GetSpatialProxy() { return spatialProxy; }
+	void SetSpatialProxy(int proxy) { spatialProxy = proxy; }
+
+	// Lights are indexed alongside drawn entities but never drawn
+	// into the g-buffer or shadow maps
+	bool IsLight() { return light; }
+
+	// Static entities are the occluders, and their shadows can be cached
+	bool IsStatic() { return isStatic; }
+	void SetStatic(bool value) { isStatic = value; }
+
 private:
 
-	Mesh* mesh;
-	Material* material;
+	MeshHandle mesh;
+	MaterialHandle material;
+	const DrawPacket* gBufferPacket;
+	const DrawPacket* shadowPacket;
 
 	XMFLOAT4X4 worldMatrix;
 	XMFLOAT3 position;
 	XMFLOAT3 rotation;
 	XMFLOAT3 scale;
 	XMFLOAT3 lightColor;
+
+	XMFLOAT3 prevPosition;
+	XMFLOAT3 prevRotation;
+	XMFLOAT3 prevScale;
+
+	int spatialProxy;
+	bool light;
+	bool isStatic;
 };
 
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// --------------------------------------------------------
+// A 32-bit reference to an object living in a HandlePool.
+//
+// The low bits are the slot index and the high bits are the
+// generation of that slot when the object was created.  Slots
+// bump their generation every time they are freed, so a handle
+// to a destroyed object no longer matches and is rejected
+// instead of silently pointing at whatever reused the slot.
+//
+// Generation 0 is never handed out, so a zeroed handle is "null".
+// --------------------------------------------------------
+template <typename T>
+struct Handle
+{
+	static const unsigned int IndexBits = 20;
+	static const unsigned int GenerationBits = 32 - IndexBits;
+	static const unsigned int IndexMask = (1u << IndexBits) - 1;
+	static const unsigned int GenerationMask = (1u << GenerationBits) - 1;
+
+	unsigned int value;
+
+	Handle() : value(0) { }
+	Handle(unsigned int index, unsigned int generation)
+		: value(((generation & GenerationMask) << IndexBits) | (index & IndexMask)) { }
+
+	unsigned int GetIndex() const { return value & IndexMask; }
+	unsigned int GetGeneration() const { return value >> IndexBits; }
+	bool IsNull() const { return value == 0; }
+
+	bool operator==(const Handle& other) const { return value == other.value; }
+	bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+// --------------------------------------------------------
+// Fixed-capacity object pool addressed by generational handles
+//
+// All storage is allocated once in the constructor as one
+// contiguous array of slots.  Free slots are chained through
+// an intrusive free list, so Create() and Destroy() never touch
+// the system allocator, and looking up a handle is a bounds
+// check, a generation compare and an array index.
+//
+// Objects never move once created, so a raw pointer obtained
+// from Get() stays valid until that object is destroyed.
+// --------------------------------------------------------
+template <typename T>
+class HandlePool
+{
+public:
+	HandlePool(unsigned int capacity);
+	~HandlePool();
+
+	// Constructs a new object in place, or returns a null
+	// handle if the pool is full
+	template <typename... Args>
+	Handle<T> Create(Args&&... args);
+
+	// Destroys the object and frees its slot.  Returns
+	// false if the handle was null or already stale.
+	bool Destroy(Handle<T> handle);
+	void Clear();
+
+	// Lookups return null for stale or null handles
+	T* Get(Handle<T> handle);
+	bool IsValid(Handle<T> handle) const;
+
+	// Visits every live object in storage order
+	template <typename Func>
+	void ForEach(Func func);
+
+	// Index-based access for splitting work across threads.
+	// Slots below GetSlotRange() may be empty, in which
+	// case GetBySlot() returns null.
+	unsigned int GetSlotRange() const { return slotRange; }
+	T* GetBySlot(unsigned int index) { return slots[index].alive ? slots[index].Object() : 0; }
+
+	// Slot index of an object living in this pool - a small,
+	// stable id for sort keys.  Storage is a slot's first member.
+	unsigned int GetSlot(const T* object) const { return (unsigned int)(reinterpret_cast<const Slot*>(object) - &slots[0]); }
+
+	unsigned int GetCount() const { return count; }
+	unsigned int GetCapacity() const { return (unsigned int)slots.size(); }
+
+private:
+	static const unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		unsigned int generation;
+		unsigned int nextFree;
+		bool alive;
+
+		T* Object() { return reinterpret_cast<T*>(&storage); }
+	};
+
+	std::vector<Slot> slots;
+	unsigned int freeHead;
+	unsigned int slotRange;
+	unsigned int count;
+
+	// Non-copyable, since slots own their objects
+	HandlePool(const HandlePool&);
+	HandlePool& operator=(const HandlePool&);
+};
+
+template <typename T>
+HandlePool<T>::HandlePool(unsigned int capacity)
+{
+	// Clamp to what the handle can actually address
+	if (capacity > Handle<T>::IndexMask + 1)
+		capacity = Handle<T>::IndexMask + 1;
+
+	// One allocation up front - nothing after this point
+	slots.resize(capacity);
+	for (unsigned int i = 0; i < capacity; i++)
+	{
+		slots[i].generation = 1;
+		slots[i].nextFree = (i + 1 < capacity) ? i + 1 : InvalidIndex;
+		slots[i].alive = false;
+	}
+
+	freeHead = capacity > 0 ? 0 : InvalidIndex;
+	slotRange = 0;
+	count = 0;
+}
+
+template <typename T>
+HandlePool<T>::~HandlePool()
+{
+	Clear();
+}
+
+template <typename T>
+template <typename... Args>
+Handle<T> HandlePool<T>::Create(Args&&... args)
+{
+	// Out of room?
+	if (freeHead == InvalidIndex)
+		return Handle<T>();
+
+	// Pop the free list and build the object in place
+	unsigned int index = freeHead;
+	Slot& slot = slots[index];
+	freeHead = slot.nextFree;
+
+	new (&slot.storage) T(std::forward<Args>(args)...);
+	slot.alive = true;
+	slot.nextFree = InvalidIndex;
+	count++;
+
+	if (index >= slotRange)
+		slotRange = index + 1;
+
+	return Handle<T>(index, slot.generation);
+}
+
+template <typename T>
+bool HandlePool<T>::Destroy(Handle<T> handle)
+{
+	if (!IsValid(handle))
+		return false;
+
+	unsigned int index = handle.GetIndex();
+	Slot& slot = slots[index];
+	slot.Object()->~T();
+	slot.alive = false;
+
+	// Bump the generation so outstanding handles go stale,
+	// skipping zero since that marks a null handle
+	slot.generation = (slot.generation + 1) & Handle<T>::GenerationMask;
+	if (slot.generation == 0)
+		slot.generation = 1;
+
+	// Push onto the free list
+	slot.nextFree = freeHead;
+	freeHead = index;
+	count--;
+
+	return true;
+}
+
+template <typename T>
+void HandlePool<T>::Clear()
+{
+	for (unsigned int i = 0; i < slotRange; i++)
+	{
+		if (slots[i].alive)
+			Destroy(Handle<T>(i, slots[i].generation));
+	}
+}
+
+template <typename T>
+T* HandlePool<T>::Get(Handle<T> handle)
+{
+	if (!IsValid(handle))
+		return 0;
+
+	return slots[handle.GetIndex()].Object();
+}
+
+template <typename T>
+bool HandlePool<T>::IsValid(Handle<T> handle) const
+{
+	unsigned int index = handle.GetIndex();
+	if (handle.IsNull() || index >= slots.size())
+		return false;
+
+	const Slot& slot = slots[index];
+	return slot.alive && slot.generation == handle.GetGeneration();
+}
+
+template <typename T>
+template <typename Func>
+void HandlePool<T>::ForEach(Func func)
+{
+	for (unsigned int i = 0; i < slotRange; i++)
+	{
+		if (slots[i].alive)
+			func(*slots[i].Object());
+	}
+}
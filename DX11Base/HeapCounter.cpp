@@ -0,0 +1,51 @@
+#include "HeapCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(DEBUG) || defined(_DEBUG)
+
+static std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	// new has to hand back something unique, even for nothing
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		abort();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t size) noexcept { free(memory); }
+void operator delete[](void* memory, size_t size) noexcept { free(memory); }
+
+bool HeapCounter::IsEnabled() { return true; }
+unsigned long long HeapCounter::GetCount() { return allocationCount.load(std::memory_order_relaxed); }
+
+#else
+
+bool HeapCounter::IsEnabled() { return false; }
+unsigned long long HeapCounter::GetCount() { return 0; }
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+// --------------------------------------------------------
+// Counts every global operator new, on any thread
+//
+// Debug builds replace the global new and delete so that a
+// frame's heap traffic can be measured - at steady state it
+// should be zero, with per frame data in LinearArenas and
+// everything else in lists that keep their memory.  Release
+// builds leave the allocator alone and always report 0.
+// --------------------------------------------------------
+class HeapCounter
+{
+public:
+	static bool IsEnabled();
+
+	// Allocations since the program started
+	static unsigned long long GetCount();
+};
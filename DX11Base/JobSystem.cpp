@@ -0,0 +1,405 @@
+#include "JobSystem.h"
+
+#include <cassert>
+#include <chrono>
+
+// Which worker the current thread is.  The thread that created
+// the job system is worker 0 and registered threads have their
+// external slot - anyone else is unregistered, and shares a queue.
+static const unsigned int UnregisteredIndex = 0xFFFFFFFF;
+static thread_local unsigned int tlsWorkerIndex = UnregisteredIndex;
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ WORK STEALING QUEUE -------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+WorkStealingQueue::WorkStealingQueue()
+{
+	top = 0;
+	bottom = 0;
+	for (unsigned int i = 0; i < Capacity; i++)
+		jobs[i].store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Owner only - adds a job to the bottom of the deque
+// --------------------------------------------------------
+void WorkStealingQueue::Push(Job* job)
+{
+	long long b = bottom.load(std::memory_order_relaxed);
+	assert(b - top.load(std::memory_order_relaxed) < Capacity && "Work stealing queue overflow");
+	jobs[b & (Capacity - 1)].store(job, std::memory_order_release);
+
+	// The job must be visible before the new bottom is
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Owner only - takes the most recently pushed job, racing
+// thieves only when a single job is left
+// --------------------------------------------------------
+Job* WorkStealingQueue::Pop()
+{
+	long long b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = top.load(std::memory_order_relaxed);
+
+	// Empty - restore the bottom
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	Job* job = jobs[b & (Capacity - 1)].load(std::memory_order_acquire);
+	if (t == b)
+	{
+		// Last job, so a thief may be after it too
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = 0;
+
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+// --------------------------------------------------------
+// Any thread - takes the oldest job from the top
+// --------------------------------------------------------
+Job* WorkStealingQueue::Steal()
+{
+	long long t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+		return 0;
+
+	Job* job = jobs[t & (Capacity - 1)].load(std::memory_order_acquire);
+
+	// Lost the race to another thief or the owner
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+
+	return job;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ JOB SYSTEM ----------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Creates the workers and starts their threads
+//
+// threadCount - Total threads including the caller, or 0
+//               to use one per hardware thread
+// --------------------------------------------------------
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	this->threadCount = threadCount;
+	workerCount = threadCount + MaxExternalThreads;
+	workers = new Worker[workerCount];
+	shared = new SharedQueue();
+	shared->head = 0;
+	shared->tail = 0;
+	shared->nextJob = 0;
+	shared->count = 0;
+	externalSlots = 0;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers[i].nextJob = 0;
+		workers[i].stealSeed = 2166136261u ^ (i * 16777619u);
+		for (unsigned int j = 0; j < WorkStealingQueue::Capacity; j++)
+			workers[i].jobInUse[j].store(false, std::memory_order_relaxed);
+	}
+	for (unsigned int j = 0; j < WorkStealingQueue::Capacity; j++)
+		shared->jobInUse[j].store(false, std::memory_order_relaxed);
+
+	running = true;
+	pendingJobs = 0;
+	sleepingWorkers = 0;
+
+	// Worker 0 is the thread that owns the job system
+	tlsWorkerIndex = 0;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+}
+
+// --------------------------------------------------------
+// Stops and joins all worker threads
+// --------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wakeCondition.notify_all();
+
+	for (auto& t : threads)
+		t.join();
+
+	delete[] workers;
+	delete shared;
+}
+
+unsigned int JobSystem::GetWorkerIndex()
+{
+	return tlsWorkerIndex < workerCount ? tlsWorkerIndex : SharedIndex;
+}
+
+// --------------------------------------------------------
+// Claims one of the spare worker slots for the calling thread
+// --------------------------------------------------------
+bool JobSystem::RegisterExternalThread()
+{
+	unsigned int slots = externalSlots.load();
+	for (;;)
+	{
+		// Find a free bit
+		unsigned int slot = 0;
+		while (slot < MaxExternalThreads && (slots & (1u << slot)))
+			slot++;
+		if (slot == MaxExternalThreads)
+			return false;
+
+		if (externalSlots.compare_exchange_weak(slots, slots | (1u << slot)))
+		{
+			tlsWorkerIndex = threadCount + slot;
+			return true;
+		}
+	}
+}
+
+void JobSystem::UnregisterExternalThread()
+{
+	if (tlsWorkerIndex < threadCount || tlsWorkerIndex >= workerCount)
+		return;
+
+	externalSlots.fetch_and(~(1u << (tlsWorkerIndex - threadCount)));
+	tlsWorkerIndex = UnregisteredIndex;
+}
+
+// --------------------------------------------------------
+// Grabs the next job from this worker's ring, or returns null
+// if that slot's job hasn't been taken out to run yet - the
+// ring is full, and the caller should run its work inline.
+// --------------------------------------------------------
+Job* JobSystem::AllocateJob(unsigned int workerIndex)
+{
+	if (workerIndex == SharedIndex)
+	{
+		std::lock_guard<std::mutex> lock(shared->mutex);
+		unsigned int slot = shared->nextJob & (WorkStealingQueue::Capacity - 1);
+		if (shared->jobInUse[slot].load(std::memory_order_acquire))
+			return 0;
+
+		shared->jobInUse[slot].store(true, std::memory_order_relaxed);
+		shared->nextJob++;
+		return &shared->jobRing[slot];
+	}
+
+	Worker& worker = workers[workerIndex];
+	unsigned int slot = worker.nextJob & (WorkStealingQueue::Capacity - 1);
+	if (worker.jobInUse[slot].load(std::memory_order_acquire))
+		return 0;
+
+	worker.jobInUse[slot].store(true, std::memory_order_relaxed);
+	worker.nextJob++;
+	return &worker.jobRing[slot];
+}
+
+// --------------------------------------------------------
+// Any thread - frees a job's slot once it has been copied
+// out, whichever ring it came from
+// --------------------------------------------------------
+void JobSystem::ReleaseJob(const Job* job)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		const Job* ring = workers[i].jobRing;
+		if (job >= ring && job < ring + WorkStealingQueue::Capacity)
+		{
+			workers[i].jobInUse[job - ring].store(false, std::memory_order_release);
+			return;
+		}
+	}
+	shared->jobInUse[job - shared->jobRing].store(false, std::memory_order_release);
+}
+
+void JobSystem::Submit(unsigned int workerIndex, Job* job)
+{
+	if (workerIndex == SharedIndex)
+	{
+		std::lock_guard<std::mutex> lock(shared->mutex);
+		assert(shared->tail - shared->head < WorkStealingQueue::Capacity && "Shared job queue overflow");
+		shared->jobs[shared->tail++ & (WorkStealingQueue::Capacity - 1)] = job;
+		shared->count.fetch_add(1);
+	}
+	else
+	{
+		workers[workerIndex].queue.Push(job);
+	}
+	pendingJobs.fetch_add(1);
+
+	// Only pay for the lock when somebody is actually asleep
+	if (sleepingWorkers.load() > 0)
+	{
+		{ std::lock_guard<std::mutex> lock(sleepMutex); }
+		wakeCondition.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// Pops from our own deque first, then the shared queue, then
+// tries to steal from the others, starting at a pseudo-random
+// victim.  Unregistered threads have no deque of their own.
+// --------------------------------------------------------
+Job* JobSystem::FindJob(unsigned int workerIndex)
+{
+	Job* job = 0;
+	unsigned int start = 0;
+	if (workerIndex != SharedIndex)
+	{
+		Worker& worker = workers[workerIndex];
+		job = worker.queue.Pop();
+
+		worker.stealSeed ^= worker.stealSeed << 13;
+		worker.stealSeed ^= worker.stealSeed >> 17;
+		worker.stealSeed ^= worker.stealSeed << 5;
+		start = worker.stealSeed % workerCount;
+	}
+
+	if (!job)
+		job = PopShared();
+
+	for (unsigned int i = 0; i < workerCount && !job; i++)
+	{
+		unsigned int victim = (start + i) % workerCount;
+		if (victim != workerIndex)
+			job = workers[victim].queue.Steal();
+	}
+
+	if (job)
+		pendingJobs.fetch_sub(1);
+
+	return job;
+}
+
+Job* JobSystem::PopShared()
+{
+	if (shared->count.load() == 0)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(shared->mutex);
+	if (shared->head == shared->tail)
+		return 0;
+
+	shared->count.fetch_sub(1);
+	return shared->jobs[shared->head++ & (WorkStealingQueue::Capacity - 1)];
+}
+
+// --------------------------------------------------------
+// Runs a job.  Splittable ranges push their upper half back
+// onto our deque until they are down to the grain size, or
+// our ring is full, when the rest just runs here.
+// --------------------------------------------------------
+void JobSystem::Execute(unsigned int workerIndex, Job* queuedJob)
+{
+	// Work from a copy, so the slot can be reused straight away
+	Job job = *queuedJob;
+	ReleaseJob(queuedJob);
+
+	unsigned int begin = job.Begin;
+	unsigned int end = job.End;
+
+	while (job.Grain && end - begin > job.Grain)
+	{
+		Job* half = AllocateJob(workerIndex);
+		if (!half)
+			break;
+
+		unsigned int mid = begin + (end - begin) / 2;
+		*half = job;
+		half->Begin = mid;
+		half->End = end;
+
+		job.Counter->fetch_add(1);
+		Submit(workerIndex, half);
+		end = mid;
+	}
+
+	job.Function(job.Data, begin, end);
+
+	if (job.Counter)
+		job.Counter->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Run(JobFunction function, void* data, JobCounter* counter)
+{
+	// No free job slot - run it here and now
+	unsigned int workerIndex = GetWorkerIndex();
+	Job* job = AllocateJob(workerIndex);
+	if (!job)
+	{
+		function(data, 0, 1);
+		return;
+	}
+
+	job->Function = function;
+	job->Data = data;
+	job->Begin = 0;
+	job->End = 1;
+	job->Grain = 0;
+	job->Counter = counter;
+
+	if (counter)
+		counter->fetch_add(1);
+
+	Submit(workerIndex, job);
+}
+
+// --------------------------------------------------------
+// Helps run jobs (ours or anybody's) until the counter hits zero
+// --------------------------------------------------------
+void JobSystem::Wait(JobCounter* counter)
+{
+	unsigned int workerIndex = GetWorkerIndex();
+	while (counter->load(std::memory_order_acquire) > 0)
+	{
+		Job* job = FindJob(workerIndex);
+		if (job)
+			Execute(workerIndex, job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	tlsWorkerIndex = index;
+
+	while (running)
+	{
+		Job* job = FindJob(index);
+		if (job)
+		{
+			Execute(index, job);
+			continue;
+		}
+
+		// Nothing to do anywhere - sleep until something is submitted
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1);
+		wakeCondition.wait_for(lock, std::chrono::milliseconds(1), [this]() { return pendingJobs.load() > 0 || !running; });
+		sleepingWorkers.fetch_sub(1);
+	}
+}
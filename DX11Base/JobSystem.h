@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+// --------------------------------------------------------
+// Counter used to wait on a group of jobs.  Every job that is
+// submitted against a counter increments it, and decrements it
+// once the job has finished running.
+// --------------------------------------------------------
+typedef std::atomic<int> JobCounter;
+
+typedef void(*JobFunction)(void* data, unsigned int begin, unsigned int end);
+
+// --------------------------------------------------------
+// A single unit of work.  Jobs are plain data living in each
+// worker's ring buffer, so submitting one never allocates.
+// A slot is only reused once its job has been taken out to
+// run - when the ring is full, new work runs inline instead.
+// --------------------------------------------------------
+struct Job
+{
+	JobFunction Function;
+	void* Data;
+	unsigned int Begin;
+	unsigned int End;
+	unsigned int Grain;		// Non-zero for parallel-for ranges that may split
+	JobCounter* Counter;
+};
+
+// --------------------------------------------------------
+// Chase-Lev work-stealing deque
+//
+// The owning worker pushes and pops at the bottom (LIFO, good
+// for cache locality), while other workers steal from the top.
+// Capacity is fixed - the owner must not have more than
+// Capacity jobs outstanding at once.  The job system never
+// does, as every queued job holds one of Capacity ring slots.
+// --------------------------------------------------------
+class WorkStealingQueue
+{
+public:
+	static const unsigned int Capacity = 4096;
+
+	WorkStealingQueue();
+
+	void Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+
+private:
+	std::atomic<long long> top;
+	std::atomic<long long> bottom;
+	std::atomic<Job*> jobs[Capacity];
+};
+
+// --------------------------------------------------------
+// Work-stealing job scheduler
+//
+// Owns one worker thread per core (minus the calling thread,
+// which counts as worker 0 and helps out while it waits).
+//
+// Any other thread that submits or waits without registering
+// goes through one shared queue behind a lock - slower, but a
+// deque only ever has one thread at its bottom.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	JobSystem(unsigned int threadCount = 0);
+	~JobSystem();
+
+	// Queues a single job on the calling thread's deque, or runs
+	// it straight away if every job slot is still waiting to run
+	void Run(JobFunction function, void* data, JobCounter* counter);
+
+	// Runs jobs from any queue until the counter reaches zero
+	void Wait(JobCounter* counter);
+
+	// Splits [0, count) into ranges and calls func(begin, end) for
+	// each, blocking (and helping) until all of them are done.
+	// Ranges are split lazily, in half, whenever they are larger
+	// than the grain size, so idle workers can steal the other half.
+	// A grain of 0 picks one based on count and thread count.
+	template <typename Func>
+	void ParallelFor(unsigned int count, unsigned int grain, Func& func);
+
+	unsigned int GetThreadCount() { return threadCount; }
+
+	// Gives a thread the job system didn't create (a render thread,
+	// say) a deque of its own so it can submit and wait alongside
+	// the main thread.  Returns false if every slot is taken, in
+	// which case the thread keeps using the shared queue.
+	static const unsigned int MaxExternalThreads = 2;
+	bool RegisterExternalThread();
+	void UnregisterExternalThread();
+
+private:
+	struct Worker
+	{
+		WorkStealingQueue queue;
+		Job jobRing[WorkStealingQueue::Capacity];
+		std::atomic<bool> jobInUse[WorkStealingQueue::Capacity];	// Until the job is copied out to run
+		unsigned int nextJob;
+		unsigned int stealSeed;
+	};
+
+	// Jobs from threads without a deque, first in first out
+	struct SharedQueue
+	{
+		std::mutex mutex;
+		Job* jobs[WorkStealingQueue::Capacity];
+		Job jobRing[WorkStealingQueue::Capacity];
+		std::atomic<bool> jobInUse[WorkStealingQueue::Capacity];
+		unsigned int head;
+		unsigned int tail;
+		unsigned int nextJob;
+		std::atomic<int> count;		// Read without the lock to skip it when empty
+	};
+
+	// Worker index of threads using the shared queue
+	static const unsigned int SharedIndex = 0xFFFFFFFF;
+
+	unsigned int threadCount;
+	unsigned int workerCount;	// threadCount plus external slots
+	Worker* workers;
+	SharedQueue* shared;
+	std::atomic<unsigned int> externalSlots;
+	std::vector<std::thread> threads;
+	std::atomic<bool> running;
+
+	// Sleeping support for workers with nothing to do
+	std::atomic<int> pendingJobs;
+	std::atomic<int> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+
+	void WorkerLoop(unsigned int index);
+	unsigned int GetWorkerIndex();
+
+	Job* AllocateJob(unsigned int workerIndex);
+	void ReleaseJob(const Job* job);
+	void Submit(unsigned int workerIndex, Job* job);
+	Job* FindJob(unsigned int workerIndex);
+	Job* PopShared();
+	void Execute(unsigned int workerIndex, Job* job);
+
+	template <typename Func>
+	static void RangeTrampoline(void* data, unsigned int begin, unsigned int end) { (*(Func*)data)(begin, end); }
+};
+
+template <typename Func>
+void JobSystem::ParallelFor(unsigned int count, unsigned int grain, Func& func)
+{
+	if (count == 0)
+		return;
+
+	// Aim for a handful of ranges per thread so stealing can balance uneven work
+	if (grain == 0)
+		grain = count / (threadCount * 8) + 1;
+
+	// Not worth splitting at all?
+	if (count <= grain || threadCount == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	// No free job slot - run it all here
+	unsigned int workerIndex = GetWorkerIndex();
+	Job* job = AllocateJob(workerIndex);
+	if (!job)
+	{
+		func(0, count);
+		return;
+	}
+
+	JobCounter counter(0);
+	job->Function = &RangeTrampoline<Func>;
+	job->Data = &func;
+	job->Begin = 0;
+	job->End = count;
+	job->Grain = grain;
+	job->Counter = &counter;
+
+	counter.fetch_add(1);
+	Submit(workerIndex, job);
+	Wait(&counter);
+}
@@ -7,17 +7,21 @@ SamplerState basicSampler : register(s0);
 cbuffer ExternalData : register(b0)
 {
 	float3 cameraPosition;
-	float3 lightColor;
-	float3 lightPos;
 }
 
+// Each light's data comes along from its instance
 struct VertexToPixel
 {
-	float4 position		: SV_POSITION;
+	float4 position						: SV_POSITION;
+	nointerpolation float3 lightPos		: LIGHTPOS;
+	nointerpolation float3 lightColor	: LIGHTCOLOR;
 };
 
 float4 main( in VertexToPixel input) : SV_TARGET
 {
+	float3 lightPos = input.lightPos;
+	float3 lightColor = input.lightColor;
+
 	int3 sampleIndices = int3(input.position.xy, 0);
 
 	float3 normal = normalGB.Load(sampleIndices).xyz;
@@ -1,27 +1,44 @@
 cbuffer externalData : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
+	float meshRadius;		// Radius of the light volume mesh as loaded
 };
 
+// The volume mesh from slot 0, one light per instance from slot 1
 struct VertexShaderInput
 {
 	float3 position		: POSITION;
+	float3 lightPos		: LIGHTPOS_PER_INSTANCE;
+	float lightRadius	: LIGHTRADIUS_PER_INSTANCE;
+	float3 lightColor	: LIGHTCOLOR_PER_INSTANCE;
+	float4 scissor		: SCISSOR_PER_INSTANCE;	// NDC min x, min y, max x, max y
 };
 
 struct VertexToPixel
 {
-	float4 position		: SV_POSITION;
+	float4 position						: SV_POSITION;
+	nointerpolation float3 lightPos		: LIGHTPOS;
+	nointerpolation float3 lightColor	: LIGHTCOLOR;
+	float4 clip							: SV_ClipDistance0;	// Last, so the pixel shader can leave it out
 };
 
 VertexToPixel main(in VertexShaderInput input)
 {
 	VertexToPixel output;
 
-	matrix worldViewProj = mul(mul(world, view), projection);
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
-	//output.position = float4(input.position, 1.0f);
+	// Scale the volume out to the light's radius around it
+	float3 worldPos = input.lightPos + input.position * (input.lightRadius / meshRadius);
+	output.position = mul(mul(float4(worldPos, 1.0f), view), projection);
+
+	output.lightPos = input.lightPos;
+	output.lightColor = input.lightColor;
+
+	// Clipped against the light's screen rect before rasterizing,
+	// so pixels outside it never reach the pixel shader
+	float4 ndcClip = input.scissor * output.position.w;
+	output.clip = float4(output.position.x - ndcClip.x, output.position.y - ndcClip.y,
+		ndcClip.z - output.position.x, ndcClip.w - output.position.y);
 
 	return output;
-}
\ No newline at end of file
+}
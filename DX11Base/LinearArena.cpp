@@ -0,0 +1,69 @@
+#include "LinearArena.h"
+
+#include <cstdint>
+#include <new>
+
+LinearArena::LinearArena(size_t capacity)
+{
+	// Blocks come from operator new rather than malloc so
+	// HeapCounter sees them.  Without one the arena is empty,
+	// so every allocation takes the spill path, which returns
+	// null if the heap really is out of memory.
+	block = (unsigned char*)operator new(capacity, std::nothrow);
+	this->capacity = block ? capacity : 0;
+	cursor = block;
+	end = block + this->capacity;
+	used = 0;
+}
+
+LinearArena::~LinearArena()
+{
+	for (unsigned char* spill : overflow)
+		operator delete(spill);
+	operator delete(block);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	uintptr_t address = ((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (address + size > (uintptr_t)end)
+	{
+		// Out of room - carry on in a new block, at least as big
+		// as the main one so a run of small allocations doesn't
+		// turn into a run of heap calls
+		size_t spillSize = size + alignment > capacity ? size + alignment : capacity;
+		unsigned char* spill = (unsigned char*)operator new(spillSize, std::nothrow);
+		if (!spill)
+			return 0;
+
+		overflow.push_back(spill);
+		cursor = spill;
+		end = spill + spillSize;
+		address = ((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+
+	used += (address + size) - (uintptr_t)cursor;
+	cursor = (unsigned char*)(address + size);
+	return (void*)address;
+}
+
+void LinearArena::Reset()
+{
+	// Last frame didn't fit, so make room for all of it next time
+	if (!overflow.empty())
+	{
+		for (unsigned char* spill : overflow)
+			operator delete(spill);
+		overflow.clear();
+
+		operator delete(block);
+		capacity = used + used / 4;
+		block = (unsigned char*)operator new(capacity, std::nothrow);
+		if (!block)
+			capacity = 0;
+	}
+
+	cursor = block;
+	end = block + capacity;
+	used = 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------
+// Per frame bump allocator
+//
+// Hands out memory from one big block by moving a cursor,
+// and gets all of it back at once with Reset() - there's no
+// freeing single allocations.  Nothing allocated here ever
+// has its destructor run, so it's meant for plain data.
+//
+// If a frame asks for more than the block holds, the extra
+// comes from overflow blocks on the heap, and the next Reset()
+// replaces everything with one block big enough for the whole
+// of that frame.  After a frame or two at steady state no
+// allocation touches the heap at all.
+// --------------------------------------------------------
+class LinearArena
+{
+public:
+	LinearArena(size_t capacity = 64 * 1024);
+	~LinearArena();
+
+	// Null only if the heap itself is out of memory
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	template <typename T>
+	T* Allocate() { return (T*)Allocate(sizeof(T), alignof(T)); }
+
+	// Everything handed out since the last Reset() becomes invalid
+	void Reset();
+
+	size_t GetUsed() const { return used; }
+	size_t GetCapacity() const { return capacity; }
+
+	// Heap allocations made since the last Reset()
+	unsigned int GetOverflowCount() const { return (unsigned int)overflow.size(); }
+
+private:
+	unsigned char* block;
+	size_t capacity;
+
+	// Where the next allocation goes, in whichever block is current
+	unsigned char* cursor;
+	unsigned char* end;
+
+	size_t used;
+	std::vector<unsigned char*> overflow;
+
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+};
+
+// --------------------------------------------------------
+// STL allocator that takes its memory from a LinearArena
+//
+// Freeing is a no-op, so a list that grows leaves its old
+// storage behind until the Reset().  Reserve up front where
+// the size is roughly known.
+//
+// Anything holding arena memory is invalid after a Reset(),
+// even if it's empty - start it over with RestartInArena()
+// rather than clear() before touching it again.  An arena
+// list that was never given an arena can't grow.
+// --------------------------------------------------------
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	// Moving or swapping a list takes its arena along
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ArenaAllocator(LinearArena* arena = 0) : arena(arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return (T*)arena->Allocate(count * sizeof(T), alignof(T)); }
+	void deallocate(T* pointer, size_t count) {}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	LinearArena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Empties a list into new memory from the arena, with room
+// for as much as it held before so it doesn't grow in steps
+template <typename T>
+void RestartInArena(ArenaVector<T>& list, LinearArena& arena)
+{
+	static_assert(std::is_trivially_destructible<T>::value, "Arena lists are for plain data");
+
+	size_t previousSize = list.size();
+	list = ArenaVector<T>(ArenaAllocator<T>(&arena));
+	list.reserve(previousSize);
+}
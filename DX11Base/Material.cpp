@@ -1,12 +1,12 @@
 #include "Material.h"
 
 
-Material::Material(SimplePixelShader* _pixelShader, SimpleVertexShader* _vertexShader, ID3D11ShaderResourceView* _materialSRV, ID3D11ShaderResourceView* _normalSRV, ID3D11SamplerState* _materialSampler)
+Material::Material(SimplePixelShader* _pixelShader, SimpleVertexShader* _vertexShader, TextureHandle _materialTexture, TextureHandle _normalTexture, ID3D11SamplerState* _materialSampler)
 {
 	pixelShader = _pixelShader;
 	vertexShader = _vertexShader;
-	materialSRV = _materialSRV;
-	normalSRV = _normalSRV;
+	materialTexture = _materialTexture;
+	normalTexture = _normalTexture;
 	materialSampler = _materialSampler;
 }
 
@@ -24,14 +24,14 @@ SimpleVertexShader* Material::GetVertexShader()
 	return vertexShader;
 }
 
-ID3D11ShaderResourceView * Material::GetMaterialSRV()
+TextureHandle Material::GetMaterialTexture()
 {
-	return materialSRV;
+	return materialTexture;
 }
 
-ID3D11ShaderResourceView * Material::GetNormalSRV()
+TextureHandle Material::GetNormalTexture()
 {
-	return normalSRV;
+	return normalTexture;
 }
 
 ID3D11SamplerState * Material::GetMaterialSampler()
@@ -1,24 +1,33 @@
 #pragma once
 
 #include "SimpleShader.h"
+#include "HandlePool.h"
+
+// Textures are pooled as their SRVs
+typedef Handle<ID3D11ShaderResourceView*> TextureHandle;
 
 class Material
 {
 public:
-	Material(SimplePixelShader* pixelShader, SimpleVertexShader* vertexShader, ID3D11ShaderResourceView* materialSRV, ID3D11ShaderResourceView* normalSRV, ID3D11SamplerState* materialSampler);
+	Material(SimplePixelShader* pixelShader, SimpleVertexShader* vertexShader, TextureHandle materialTexture, TextureHandle normalTexture, ID3D11SamplerState* materialSampler);
 	~Material();
 	SimplePixelShader* GetPixelShader();
 	SimpleVertexShader* GetVertexShader();
-	ID3D11ShaderResourceView* GetMaterialSRV();
-	ID3D11ShaderResourceView* GetNormalSRV();
+
+	// Resolved through the texture pool by whoever draws with them.
+	// A null handle leaves the slot unbound.
+	TextureHandle GetMaterialTexture();
+	TextureHandle GetNormalTexture();
 	ID3D11SamplerState* GetMaterialSampler();
 
 private:
 	SimplePixelShader* pixelShader;
 	SimpleVertexShader* vertexShader;
-	ID3D11ShaderResourceView* materialSRV;
-	ID3D11ShaderResourceView* normalSRV;
+	TextureHandle materialTexture;
+	TextureHandle normalTexture;
 	ID3D11SamplerState* materialSampler;
 };
 
+typedef Handle<Material> MaterialHandle;
+
 
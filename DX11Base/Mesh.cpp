@@ -2,6 +2,7 @@
 #include <DirectXMath.h>
 #include <vector>
 #include <fstream>
+#include <cfloat>
 
 using namespace DirectX;
 
@@ -11,6 +12,19 @@ Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numInd
 }
 
 Mesh::Mesh(const char* objFile, ID3D11Device* device)
+{
+	std::vector<Vertex> verts;           // Verts we're assembling
+	std::vector<UINT> indices;           // Indices of these verts
+
+	// If not found, give up
+	if (!LoadOBJ(objFile, verts, indices))
+		return;
+
+	// Create the actual buffers
+	CreateBuffers(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), device);
+}
+
+bool Mesh::LoadOBJ(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
 {
 	// File input object
 	std::ifstream obj(objFile);
@@ -28,15 +42,13 @@ Mesh::Mesh(const char* objFile, ID3D11Device* device)
 
 		// If not found, give up
 		if (!obj.is_open())
-			return;
+			return false;
 	}
 
 	// Variables used while reading the file
 	std::vector<XMFLOAT3> positions;     // Positions from the file
 	std::vector<XMFLOAT3> normals;       // Normals from the file
 	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
 	unsigned int vertCounter = 0;        // Count of vertices/indices
 	char chars[100];                     // String for line reading
 
@@ -177,9 +189,9 @@ Mesh::Mesh(const char* objFile, ID3D11Device* device)
 		}
 	}
 
-	// Close the file and create the actual buffers
+	// Close the file
 	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+	return vertCounter > 0;
 }
 
 
@@ -196,6 +208,18 @@ void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArr
 	// Calculate the tangents before copying to buffer
 	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
 
+	// Find the bounds while we're looking at every vertex
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertArray[i].Position);
+		vMin = XMVectorMin(vMin, position);
+		vMax = XMVectorMax(vMax, position);
+	}
+	XMStoreFloat3(&boundsMin, vMin);
+	XMStoreFloat3(&boundsMax, vMax);
+
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <d3d11.h>
+#include <vector>
 
 #include "Vertex.h"
+#include "HandlePool.h"
 
 
 class Mesh
@@ -16,12 +18,25 @@ public:
 	ID3D11Buffer* GetIndexBuffer() { return ib; }
 	int GetIndexCount() { return numIndices; }
 
+	// Object space bounding box of the vertices
+	DirectX::XMFLOAT3 GetBoundsMin() { return boundsMin; }
+	DirectX::XMFLOAT3 GetBoundsMax() { return boundsMax; }
+
+	// Parses an OBJ file into vertex and index lists without
+	// touching the device, so it's safe to call from any thread
+	static bool LoadOBJ(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
 private:
 	ID3D11Buffer* vb;
 	ID3D11Buffer* ib;
 	int numIndices;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
 
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
 };
 
+// Meshes live in a HandlePool and are referred to by handle
+typedef Handle<Mesh> MeshHandle;
+
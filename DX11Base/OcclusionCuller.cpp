@@ -0,0 +1,452 @@
+// DumpDepth uses plain fopen, which MSVC would rather it didn't
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "OcclusionCuller.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+
+// The AVX2 rasterizer is built on every x86 target, whatever
+// the compiler's instruction set setting, and only picked at
+// run time when the CPU and OS both support it
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+// Anything this close to (or behind) the camera plane is
+// skipped as an occluder and always visible as an occludee
+static const float NearW = 1e-4f;
+
+static bool CpuHasAVX2()
+{
+#if !defined(OCCLUSION_AVX2)
+	return false;
+#elif defined(_MSC_VER)
+	// AVX2 itself, plus the OS saving the YMM registers
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5));
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+{
+	tilesX = (width + TileWidth - 1) / TileWidth;
+	tilesY = (height + TileHeight - 1) / TileHeight;
+	this->width = tilesX * TileWidth;
+	this->height = tilesY * TileHeight;
+
+	depth.resize(this->width * this->height, 1.0f);
+	tileMaxDepth.resize(tilesX * tilesY, 1.0f);
+	tileBins.resize(tilesX * tilesY);
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	useAVX2 = CpuHasAVX2();
+}
+
+void OcclusionCuller::EnableAVX2(bool enable)
+{
+	useAVX2 = enable && CpuHasAVX2();
+}
+
+void OcclusionCuller::Begin(FXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	triangles.clear();
+
+	for (size_t i = 0; i < depth.size(); i++)
+		depth[i] = 1.0f;
+	for (size_t i = 0; i < tileBins.size(); i++)
+	{
+		tileBins[i].clear();
+		tileMaxDepth[i] = 1.0f;
+	}
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, CXMMATRIX world)
+{
+	// Straight to clip space
+	XMMATRIX worldViewProj = XMMatrixMultiply(world, XMLoadFloat4x4(&viewProjection));
+	clipVertices.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+		XMStoreFloat4(&clipVertices[i], XMVector3Transform(XMLoadFloat3(&positions[i]), worldViewProj));
+
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		SetupTriangle(
+			XMLoadFloat4(&clipVertices[indices[i]]),
+			XMLoadFloat4(&clipVertices[indices[i + 1]]),
+			XMLoadFloat4(&clipVertices[indices[i + 2]]));
+	}
+}
+
+void OcclusionCuller::AddOccluderBox(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, CXMMATRIX world)
+{
+	// Corner i uses max on x, y and z when bits 0, 1 and 2 are set
+	XMFLOAT3 corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		corners[i] = XMFLOAT3(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z);
+	}
+
+	static const unsigned int indices[36] =
+	{
+		0, 2, 3,  0, 3, 1,		// -z
+		4, 5, 7,  4, 7, 6,		// +z
+		0, 4, 6,  0, 6, 2,		// -x
+		1, 3, 7,  1, 7, 5,		// +x
+		0, 1, 5,  0, 5, 4,		// -y
+		2, 6, 7,  2, 7, 3		// +y
+	};
+
+	AddOccluder(corners, 8, indices, 36, world);
+}
+
+// --------------------------------------------------------
+// Projects a clip space triangle to pixels and sets up its
+// edge functions and depth plane.  Occluders are drawn double
+// sided, and any triangle reaching past the near plane is
+// dropped - missing occluders only ever makes culling weaker,
+// never wrong.
+// --------------------------------------------------------
+void OcclusionCuller::SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2)
+{
+	XMFLOAT4 c[3];
+	XMStoreFloat4(&c[0], clip0);
+	XMStoreFloat4(&c[1], clip1);
+	XMStoreFloat4(&c[2], clip2);
+
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		if (c[i].w < NearW || c[i].z < 0.0f)
+			return;
+
+		float invW = 1.0f / c[i].w;
+		x[i] = (c[i].x * invW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - c[i].y * invW * 0.5f) * height;
+		z[i] = c[i].z * invW;
+	}
+
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (fabsf(area) < 1e-6f)
+		return;
+
+	// Flip back-facing triangles around
+	if (area < 0.0f)
+	{
+		float t;
+		t = x[1]; x[1] = x[2]; x[2] = t;
+		t = y[1]; y[1] = y[2]; y[2] = t;
+		t = z[1]; z[1] = z[2]; z[2] = t;
+		area = -area;
+	}
+
+	Triangle tri;
+	tri.minX = (int)floorf(fminf(x[0], fminf(x[1], x[2])));
+	tri.minY = (int)floorf(fminf(y[0], fminf(y[1], y[2])));
+	tri.maxX = (int)ceilf(fmaxf(x[0], fmaxf(x[1], x[2])));
+	tri.maxY = (int)ceilf(fmaxf(y[0], fmaxf(y[1], y[2])));
+	if (tri.minX < 0) tri.minX = 0;
+	if (tri.minY < 0) tri.minY = 0;
+	if (tri.maxX > (int)width - 1) tri.maxX = width - 1;
+	if (tri.maxY > (int)height - 1) tri.maxY = height - 1;
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	// Edge i runs from vertex i to vertex i + 1, and is
+	// positive on the inside
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		tri.edgeA[i] = y[i] - y[j];
+		tri.edgeB[i] = x[j] - x[i];
+		tri.edgeC[i] = -(tri.edgeA[i] * x[i] + tri.edgeB[i] * y[i]);
+	}
+
+	// Each vertex's barycentric weight is the edge opposite
+	// it divided by the area, so depth is a blend of the edges
+	float invArea = 1.0f / area;
+	float w0 = z[0] * invArea, w1 = z[1] * invArea, w2 = z[2] * invArea;
+	tri.depthA = w0 * tri.edgeA[1] + w1 * tri.edgeA[2] + w2 * tri.edgeA[0];
+	tri.depthB = w0 * tri.edgeB[1] + w1 * tri.edgeB[2] + w2 * tri.edgeB[0];
+	tri.depthC = w0 * tri.edgeC[1] + w1 * tri.edgeC[2] + w2 * tri.edgeC[0];
+
+	triangles.push_back(tri);
+}
+
+void OcclusionCuller::Rasterize(JobSystem& jobSystem)
+{
+	// Bin every triangle into each tile its bounds touch
+	for (unsigned int i = 0; i < triangles.size(); i++)
+	{
+		const Triangle& tri = triangles[i];
+		for (int ty = tri.minY / TileHeight; ty <= tri.maxY / (int)TileHeight; ty++)
+		{
+			for (int tx = tri.minX / TileWidth; tx <= tri.maxX / (int)TileWidth; tx++)
+				tileBins[ty * tilesX + tx].push_back(i);
+		}
+	}
+
+	auto rasterizeTiles = [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int tile = begin; tile < end; tile++)
+			RasterizeTile(tile);
+	};
+	jobSystem.ParallelFor(tilesX * tilesY, 1, rasterizeTiles);
+}
+
+// --------------------------------------------------------
+// Rasterizes one tile's bin, keeping the nearest depth, then
+// records the tile's farthest depth for the coarse test.
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	int tileX0 = (tile % tilesX) * TileWidth;
+	int tileY0 = (tile / tilesX) * TileHeight;
+	int tileX1 = tileX0 + TileWidth - 1;
+	int tileY1 = tileY0 + TileHeight - 1;
+
+#if defined(OCCLUSION_AVX2)
+	if (useAVX2)
+		RasterizeBinAVX2(tileBins[tile], tileX0, tileY0, tileX1, tileY1);
+	else
+#endif
+		RasterizeBin(tileBins[tile], tileX0, tileY0, tileX1, tileY1);
+
+	// Farthest depth left anywhere in the tile
+	float maxDepth = 0.0f;
+	for (int y = tileY0; y <= tileY1; y++)
+	{
+		const float* row = &depth[y * width];
+		for (int x = tileX0; x <= tileX1; x++)
+			maxDepth = row[x] > maxDepth ? row[x] : maxDepth;
+	}
+	tileMaxDepth[tile] = maxDepth;
+}
+
+// --------------------------------------------------------
+// Walks each row of the tile 4 pixels at a time with
+// DirectXMath.  Runs anywhere.
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeBin(const std::vector<unsigned int>& bin, int tileX0, int tileY0, int tileX1, int tileY1)
+{
+	const int Lanes = 4;
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR zero = XMVectorZero();
+
+	for (size_t b = 0; b < bin.size(); b++)
+	{
+		const Triangle& tri = triangles[bin[b]];
+
+		// Start on a lane boundary - tiles are a whole number
+		// of lanes wide, so we never step outside the tile
+		int startX = (tri.minX > tileX0 ? tri.minX : tileX0) & ~(Lanes - 1);
+		int endX = tri.maxX < tileX1 ? tri.maxX : tileX1;
+		int startY = tri.minY > tileY0 ? tri.minY : tileY0;
+		int endY = tri.maxY < tileY1 ? tri.maxY : tileY1;
+
+		XMVECTOR a0 = XMVectorReplicate(tri.edgeA[0]), a1 = XMVectorReplicate(tri.edgeA[1]), a2 = XMVectorReplicate(tri.edgeA[2]);
+		XMVECTOR za = XMVectorReplicate(tri.depthA);
+
+		for (int y = startY; y <= endY; y++)
+		{
+			// Everything that's constant along the row
+			float py = y + 0.5f;
+			float row0 = tri.edgeB[0] * py + tri.edgeC[0];
+			float row1 = tri.edgeB[1] * py + tri.edgeC[1];
+			float row2 = tri.edgeB[2] * py + tri.edgeC[2];
+			float rowZ = tri.depthB * py + tri.depthC;
+			float* row = &depth[y * width];
+
+			for (int x = startX; x <= endX; x += Lanes)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+				XMVECTOR e0 = XMVectorMultiplyAdd(a0, px, XMVectorReplicate(row0));
+				XMVECTOR e1 = XMVectorMultiplyAdd(a1, px, XMVectorReplicate(row1));
+				XMVECTOR e2 = XMVectorMultiplyAdd(a2, px, XMVectorReplicate(row2));
+				XMVECTOR inside = XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero),
+					XMVectorAndInt(XMVectorGreaterOrEqual(e1, zero), XMVectorGreaterOrEqual(e2, zero)));
+
+				XMVECTOR z = XMVectorMultiplyAdd(za, px, XMVectorReplicate(rowZ));
+				XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)(row + x));
+				XMStoreFloat4((XMFLOAT4*)(row + x), XMVectorSelect(current, XMVectorMin(current, z), inside));
+			}
+		}
+	}
+}
+
+#if defined(OCCLUSION_AVX2)
+// --------------------------------------------------------
+// The same walk 8 pixels at a time.  Only ever called once
+// the CPU has been checked for AVX2.
+// --------------------------------------------------------
+AVX2_FUNCTION void OcclusionCuller::RasterizeBinAVX2(const std::vector<unsigned int>& bin, int tileX0, int tileY0, int tileX1, int tileY1)
+{
+	const int Lanes = 8;
+	const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (size_t b = 0; b < bin.size(); b++)
+	{
+		const Triangle& tri = triangles[bin[b]];
+
+		int startX = (tri.minX > tileX0 ? tri.minX : tileX0) & ~(Lanes - 1);
+		int endX = tri.maxX < tileX1 ? tri.maxX : tileX1;
+		int startY = tri.minY > tileY0 ? tri.minY : tileY0;
+		int endY = tri.maxY < tileY1 ? tri.maxY : tileY1;
+
+		__m256 a0 = _mm256_set1_ps(tri.edgeA[0]), a1 = _mm256_set1_ps(tri.edgeA[1]), a2 = _mm256_set1_ps(tri.edgeA[2]);
+		__m256 za = _mm256_set1_ps(tri.depthA);
+
+		for (int y = startY; y <= endY; y++)
+		{
+			float py = y + 0.5f;
+			float row0 = tri.edgeB[0] * py + tri.edgeC[0];
+			float row1 = tri.edgeB[1] * py + tri.edgeC[1];
+			float row2 = tri.edgeB[2] * py + tri.edgeC[2];
+			float rowZ = tri.depthB * py + tri.depthC;
+			float* row = &depth[y * width];
+
+			for (int x = startX; x <= endX; x += Lanes)
+			{
+				__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+				__m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), _mm256_set1_ps(row0));
+				__m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), _mm256_set1_ps(row1));
+				__m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), _mm256_set1_ps(row2));
+				__m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+					_mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)));
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+
+				__m256 z = _mm256_add_ps(_mm256_mul_ps(za, px), _mm256_set1_ps(rowZ));
+				__m256 current = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+			}
+		}
+	}
+}
+#endif
+
+// --------------------------------------------------------
+// Projects the box's corners to a screen rectangle and its
+// nearest depth, then looks for any pixel under the rectangle
+// with an occluder farther away than that.  Whole tiles whose
+// farthest depth is already nearer are skipped outright.
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax) const
+{
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z,
+			1.0f);
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, vp));
+
+		// Reaches behind the camera - can't say, so draw it
+		if (clip.w < NearW)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+		float sy = (0.5f - clip.y * invW * 0.5f) * height;
+		float sz = clip.z * invW;
+
+		minX = fminf(minX, sx); maxX = fmaxf(maxX, sx);
+		minY = fminf(minY, sy); maxY = fmaxf(maxY, sy);
+		minZ = fminf(minZ, sz);
+	}
+
+	int x0 = (int)floorf(minX), x1 = (int)floorf(maxX);
+	int y0 = (int)floorf(minY), y1 = (int)floorf(maxY);
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > (int)width - 1) x1 = width - 1;
+	if (y1 > (int)height - 1) y1 = height - 1;
+
+	// Entirely off screen
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	for (int ty = y0 / (int)TileHeight; ty <= y1 / (int)TileHeight; ty++)
+	{
+		for (int tx = x0 / (int)TileWidth; tx <= x1 / (int)TileWidth; tx++)
+		{
+			// Every occluder in this tile is in front of the box
+			if (minZ >= tileMaxDepth[ty * tilesX + tx])
+				continue;
+
+			int tileX0 = tx * TileWidth, tileX1 = tileX0 + TileWidth - 1;
+			int tileY0 = ty * TileHeight, tileY1 = tileY0 + TileHeight - 1;
+			int px0 = tileX0 > x0 ? tileX0 : x0;
+			int px1 = tileX1 < x1 ? tileX1 : x1;
+			int py0 = tileY0 > y0 ? tileY0 : y0;
+			int py1 = tileY1 < y1 ? tileY1 : y1;
+
+			for (int y = py0; y <= py1; y++)
+			{
+				const float* row = &depth[y * width];
+				for (int x = px0; x <= px1; x++)
+				{
+					if (row[x] > minZ)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// --------------------------------------------------------
+// Dumps depth as an 8-bit PGM, scaled so the nearest occluder
+// is white and empty space is black
+// --------------------------------------------------------
+bool OcclusionCuller::DumpDepth(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+
+	float nearest = 1.0f;
+	for (size_t i = 0; i < depth.size(); i++)
+		nearest = depth[i] < nearest ? depth[i] : nearest;
+	float scale = nearest < 1.0f ? 255.0f / (1.0f - nearest) : 0.0f;
+
+	fprintf(file, "P5\n%u %u\n255\n", width, height);
+	std::vector<unsigned char> pixels(depth.size());
+	for (size_t i = 0; i < depth.size(); i++)
+		pixels[i] = (unsigned char)((1.0f - depth[i]) * scale);
+	fwrite(&pixels[0], 1, pixels.size(), file);
+
+	fclose(file);
+	return true;
+}
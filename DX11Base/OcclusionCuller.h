@@ -0,0 +1,96 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// CPU software occlusion culling
+//
+// A handful of big occluders (walls, simplified meshes) are
+// rasterized into a small depth buffer on the CPU, then the
+// screen rectangle of each remaining object is tested against
+// it.  Anything entirely behind what's already been drawn can
+// skip the g-buffer pass.
+//
+// The buffer is split into tiles.  Triangles are binned into
+// every tile their bounds touch, and each tile is rasterized
+// by its own job, so no two jobs ever write the same pixel.
+// Each tile also keeps the farthest depth in it, which lets
+// most occludee tests finish without reading any pixels.
+//
+// Depth is post-projection z/w (0 near, 1 far), and nothing
+// here touches the GPU, so it all runs headless.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	static const unsigned int TileWidth = 32;
+	static const unsigned int TileHeight = 32;
+
+	// Size is rounded up to whole tiles
+	OcclusionCuller(unsigned int width = 320, unsigned int height = 192);
+
+	// Starts a new frame - clears the occluders and the depth buffer.
+	// The matrix is a regular (non-transposed) view * projection.
+	void Begin(FXMMATRIX viewProjection);
+
+	// Queues occluder triangles, given in object space along with
+	// their (non-transposed) world matrix
+	void AddOccluder(const XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, CXMMATRIX world);
+	void AddOccluderBox(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, CXMMATRIX world);
+
+	// Bins the queued triangles and rasterizes every tile
+	void Rasterize(JobSystem& jobSystem);
+
+	// Could any part of this world space box be seen past the
+	// occluders?  Safe to call from several threads at once.
+	bool IsVisible(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax) const;
+
+	// Writes the depth buffer out as a greyscale PGM image
+	bool DumpDepth(const char* fileName) const;
+
+	// The AVX2 rasterizer is used wherever the CPU has it.  Turning
+	// it off forces the 4-wide path, so the two can be compared.
+	void EnableAVX2(bool enable);
+	bool IsUsingAVX2() const { return useAVX2; }
+
+	unsigned int GetTriangleCount() const { return (unsigned int)triangles.size(); }
+	unsigned int GetWidth() const { return width; }
+	unsigned int GetHeight() const { return height; }
+	float GetDepth(unsigned int x, unsigned int y) const { return depth[y * width + x]; }
+
+private:
+	// A screen space triangle, ready to rasterize: three edge
+	// functions and a depth plane, all as a*x + b*y + c
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY;
+	};
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+
+	XMFLOAT4X4 viewProjection;
+	std::vector<XMFLOAT4> clipVertices;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<unsigned int>> tileBins;
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+
+	// Set once the CPU is known to support AVX2 - rows are then
+	// rasterized 8 pixels at a time rather than 4
+	bool useAVX2;
+
+	void SetupTriangle(FXMVECTOR clip0, FXMVECTOR clip1, FXMVECTOR clip2);
+	void RasterizeTile(unsigned int tile);
+	void RasterizeBin(const std::vector<unsigned int>& bin, int tileX0, int tileY0, int tileX1, int tileY1);
+	void RasterizeBinAVX2(const std::vector<unsigned int>& bin, int tileX0, int tileY0, int tileX1, int tileY1);
+};
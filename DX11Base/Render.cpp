@@ -1,9 +1,13 @@
 #include "Render.h"
 
+#include <cstdio>
+
 
 
 Render::Render()
 {
+	stateCache = 0;
+	SetLights();
 }
 
 
@@ -12,62 +16,100 @@ Render::~Render()
 }
 
 
-void Render::RenderProcess(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context)
+void Render::SetForwardFrame(SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, StructuredBuffer &pointLightBuffer, StructuredBuffer &spotLightBuffer, ID3D11DeviceContext* context)
 {
-	SetLights();
-
-	vertexBuffer = gameEntity->GetMesh()->GetVertexBuffer();
-	indexBuffer = gameEntity->GetMesh()->GetIndexBuffer();
-
-	vertexShader->SetMatrix4x4("world", *gameEntity->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
+	vertexShader->SetMatrix4x4("view", camera.view);
+	vertexShader->SetMatrix4x4("projection", camera.projection);
+	vertexShader->CopyBufferData("perFrame");
+
+	//The buffers keep their contents between frames
+	if (lightsDirty)
+	{
+		pointLightBuffer.Upload(context, pointLights.data(), (unsigned int)pointLights.size());
+		spotLightBuffer.Upload(context, spotLights.data(), (unsigned int)spotLights.size());
+		lightsDirty = false;
+	}
+	pixelShader->SetShaderResourceView("pointLights", pointLightBuffer.GetSRV());
+	pixelShader->SetShaderResourceView("spotLights", spotLightBuffer.GetSRV());
 
 	pixelShader->SetData("dirLight_1", &dirLight_1, sizeof(DirectionalLight));
-
 	pixelShader->SetData("ambientLight", &ambientLight, sizeof(AmbientLight));
+	//The counts are uint in the shader
+	unsigned int pointLightCount = pointLightBuffer.GetCount();
+	unsigned int spotLightCount = spotLightBuffer.GetCount();
+	pixelShader->SetData("pointLightCount", &pointLightCount, sizeof(unsigned int));
+	pixelShader->SetData("spotLightCount", &spotLightCount, sizeof(unsigned int));
+	pixelShader->SetFloat3("cameraPosition", camera.position);
+	pixelShader->CopyBufferData("perFrame");
+}
 
-	pixelShader->SetData("pointLight1", &pointLight1, sizeof(PointLight));
-	pixelShader->SetData("pointLight2", &pointLight2, sizeof(PointLight));
-	pixelShader->SetData("pointLight3", &pointLight3, sizeof(PointLight));
-	pixelShader->SetData("pointLight4", &pointLight4, sizeof(PointLight));
-
-	pixelShader->SetData("outerPointLight1", &outerPointLight1, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight2", &outerPointLight2, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight3", &outerPointLight3, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight4", &outerPointLight4, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight5", &outerPointLight5, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight6", &outerPointLight6, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight7", &outerPointLight7, sizeof(PointLight));
-	pixelShader->SetData("outerPointLight8", &outerPointLight8, sizeof(PointLight));
-
-	pixelShader->SetData("spotLight", &spotLight, sizeof(SpotLight));
+bool Render::CheckForwardLayout(SimplePixelShader* pixelShader)
+{
+	//Every constant, by its name and the size the C++ side writes
+	struct { const char* name; unsigned int size; } constants[] =
+	{
+		{ "dirLight_1", sizeof(DirectionalLight) },
+		{ "ambientLight", sizeof(AmbientLight) },
+		{ "cameraPosition", sizeof(XMFLOAT3) },
+		{ "pointLightCount", sizeof(unsigned int) },
+		{ "spotLightCount", sizeof(unsigned int) },
+	};
+
+	bool matches = true;
+	for (unsigned int i = 0; i < sizeof(constants) / sizeof(constants[0]); i++)
+	{
+		const SimpleShaderVariable* var = pixelShader->GetVariableInfo(constants[i].name);
+		if (var && var->Size == constants[i].size)
+			continue;
+		printf("Forward shader: %s is %u bytes, C++ writes %u\n", constants[i].name, var ? var->Size : 0, constants[i].size);
+		matches = false;
+	}
+
+	//And the structured buffers, by their element stride
+	struct { const char* name; unsigned int stride; } lists[] =
+	{
+		{ "pointLights", sizeof(PointLight) },
+		{ "spotLights", sizeof(SpotLight) },
+	};
+
+	for (unsigned int i = 0; i < sizeof(lists) / sizeof(lists[0]); i++)
+	{
+		const SimpleSRV* srv = pixelShader->GetShaderResourceViewInfo(lists[i].name);
+		if (srv && srv->Stride == lists[i].stride)
+			continue;
+		printf("Forward shader: %s has a %u byte stride, C++ uploads %u\n", lists[i].name, srv ? srv->Stride : 0, lists[i].stride);
+		matches = false;
+	}
+	return matches;
+}
 
-	pixelShader->SetFloat3("cameraPosition", camera->GetPosition());
+void Render::RenderProcess(const DrawItem &item, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, ID3D11DeviceContext* &context)
+{
+	vertexBuffer = item.mesh->GetVertexBuffer();
+	indexBuffer = item.mesh->GetIndexBuffer();
 
-	pixelShader->SetShaderResourceView("textureSRV", gameEntity->GetMaterial()->GetMaterialSRV());
-	pixelShader->SetShaderResourceView("normalMapSRV", gameEntity->GetMaterial()->GetNormalSRV());
-	pixelShader->SetSamplerState("basicSampler", gameEntity->GetMaterial()->GetMaterialSampler());
+	//Everything else was uploaded by SetForwardFrame
+	vertexShader->SetMatrix4x4("world", item.world);
+	vertexShader->CopyBufferData("perObject");
+	vertexShader->SetShader();
 
-	pixelShader->CopyAllBufferData();
+	pixelShader->SetShaderResourceView("textureSRV", item.texture);
+	pixelShader->SetShaderResourceView("normalMapSRV", item.normalMap);
+	pixelShader->SetSamplerState("basicSampler", item.material->GetMaterialSampler());
 	pixelShader->SetShader();
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	SetBuffers(vertexBuffer, indexBuffer, context);
 
-	context->DrawIndexed(gameEntity->GetMesh()->GetIndexCount(), 0, 0);
+	context->DrawIndexed(item.mesh->GetIndexCount(), 0, 0);
 }
 
-void Render::RenderSkyBox(Mesh* &mesh, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context, ID3D11RasterizerState* &rasterizerState, ID3D11DepthStencilState* &depthState, ID3D11ShaderResourceView* &SRV)
+void Render::RenderSkyBox(Mesh* &mesh, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context, ID3D11RasterizerState* &rasterizerState, ID3D11DepthStencilState* &depthState, ID3D11ShaderResourceView* &SRV)
 {
 	vertexBuffer = mesh->GetVertexBuffer();
 	indexBuffer = mesh->GetIndexBuffer();
 	
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	vertexShader->SetMatrix4x4("view", camera.view);
+	vertexShader->SetMatrix4x4("projection", camera.projection);
 
 	vertexShader->CopyAllBufferData();
 	vertexShader->SetShader();
@@ -77,55 +119,86 @@ void Render::RenderSkyBox(Mesh* &mesh, ID3D11Buffer* &vertexBuffer, ID3D11Buffer
 	pixelShader->CopyAllBufferData();
 	pixelShader->SetShader();
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	SetBuffers(vertexBuffer, indexBuffer, context);
 
-	context->RSSetState(rasterizerState);
-	context->OMSetDepthStencilState(depthState, 0);
+	SetStates(rasterizerState, depthState, context);
 
 	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
 
 	// Reset the render states we've changed
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
+	SetStates(0, 0, context);
 }
 
-void Render::RenderGBuffer(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context)
+void Render::RenderGBuffer(const DrawItem &item, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context)
 {
-	vertexBuffer = gameEntity->GetMesh()->GetVertexBuffer();
-	indexBuffer = gameEntity->GetMesh()->GetIndexBuffer();
+	vertexBuffer = item.mesh->GetVertexBuffer();
+	indexBuffer = item.mesh->GetIndexBuffer();
 
-	vertexShader->SetMatrix4x4("world", *gameEntity->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	vertexShader->SetMatrix4x4("world", item.world);
+	vertexShader->SetMatrix4x4("view", camera.view);
+	vertexShader->SetMatrix4x4("projection", camera.projection);
 
 	vertexShader->CopyAllBufferData();
 	vertexShader->SetShader();
 
-	pixelShader->SetShaderResourceView("textureSRV", gameEntity->GetMaterial()->GetMaterialSRV());
-	pixelShader->SetShaderResourceView("normalMapSRV", gameEntity->GetMaterial()->GetNormalSRV());
-	pixelShader->SetSamplerState("basicSampler", gameEntity->GetMaterial()->GetMaterialSampler());
+	pixelShader->SetShaderResourceView("textureSRV", item.texture);
+	pixelShader->SetShaderResourceView("normalMapSRV", item.normalMap);
+	pixelShader->SetSamplerState("basicSampler", item.material->GetMaterialSampler());
 
 	pixelShader->CopyAllBufferData();
 	pixelShader->SetShader();
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	SetBuffers(vertexBuffer, indexBuffer, context);
 
-	context->DrawIndexed(gameEntity->GetMesh()->GetIndexCount(), 0, 0);
+	context->DrawIndexed(item.mesh->GetIndexCount(), 0, 0);
 }
 
-void Render::RenderLights(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context, ID3D11SamplerState* &sampler, ID3D11ShaderResourceView* &positionGBuffer, ID3D11ShaderResourceView* &normalGBuffer, ID3D11ShaderResourceView* &diffuseGBuffer)
+void Render::RecordGBufferFrame(SimpleVertexShader* vertexShader, const CameraSnapshot &camera, CommandBuffer &commands)
 {
-	vertexBuffer = gameEntity->GetMesh()->GetVertexBuffer();
-	indexBuffer = gameEntity->GetMesh()->GetIndexBuffer();
+	vertexShader->SetMatrix4x4("view", camera.view);
+	vertexShader->SetMatrix4x4("projection", camera.projection);
+	vertexShader->RecordBufferData(commands, "perFrame");
+}
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+void Render::RecordShadowCascade(SimpleVertexShader* vertexShader, const XMFLOAT4X4 &viewProjection, CommandBuffer &commands)
+{
+	vertexShader->SetMatrix4x4("viewProjection", viewProjection);
+	vertexShader->RecordBufferData(commands, "perCascade");
+}
+
+void Render::RenderGBufferInstanced(const DrawBatch &batch, ID3D11Buffer* instanceBuffer, CommandBuffer &commands)
+{
+	//No per object constants - the camera was recorded ahead of the batches
+	batch.packet->Record(commands, 0);
+
+	//World matrices come from the second vertex buffer
+	commands.RecordBindVertexBuffer(1, instanceBuffer, sizeof(XMFLOAT4X4), 0);
+	commands.RecordDrawIndexedInstanced(batch.packet->indexCount, batch.instanceCount, 0, 0, batch.firstInstance);
+}
+
+void Render::RenderShadowCaster(const DrawItem &item, CommandBuffer &commands)
+{
+	//Depth only - the packet has no pixel shader
+	item.shadowPacket->Record(commands, &item.world);
+	commands.RecordDrawIndexed(item.shadowPacket->indexCount, 0, 0);
+}
 
-	vertexShader->SetMatrix4x4("world", *gameEntity->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+void Render::RenderLightVolumes(Mesh* mesh, unsigned int lightCount, ID3D11Buffer* instanceBuffer, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context, ID3D11SamplerState* &sampler, ID3D11ShaderResourceView* &positionGBuffer, ID3D11ShaderResourceView* &normalGBuffer, ID3D11ShaderResourceView* &diffuseGBuffer)
+{
+	vertexBuffer = mesh->GetVertexBuffer();
+	indexBuffer = mesh->GetIndexBuffer();
+
+	//Every light's position, radius and color come from the second vertex buffer
+	SetBuffers(vertexBuffer, indexBuffer, context);
+	UINT instanceStride = sizeof(LightInstance);
+	if (stateCache)
+		stateCache->SetVertexBuffer(1, instanceBuffer, instanceStride, 0);
+	else
+		context->IASetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &offset);
+
+	vertexShader->SetMatrix4x4("view", camera.view);
+	vertexShader->SetMatrix4x4("projection", camera.projection);
+	vertexShader->SetFloat("meshRadius", (mesh->GetBoundsMax().x - mesh->GetBoundsMin().x) * 0.5f);
 
 	vertexShader->CopyAllBufferData();
 	vertexShader->SetShader();
@@ -136,33 +209,67 @@ void Render::RenderLights(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer,
 
 	pixelShader->SetSamplerState("basicSampler", sampler);
 
-	pixelShader->SetFloat3("cameraPosition", camera->GetPosition());
-
-	pixelShader->SetFloat3("lightColor", gameEntity->GetLightColor());
-	pixelShader->SetFloat3("lightPos", gameEntity->GetPosition());
+	pixelShader->SetFloat3("cameraPosition", camera.position);
 
 	pixelShader->CopyAllBufferData();
 	pixelShader->SetShader();
 
-	context->DrawIndexed(gameEntity->GetMesh()->GetIndexCount(), 0, 0);
+	context->DrawIndexedInstanced(mesh->GetIndexCount(), lightCount, 0, 0, 0);
+}
+
+void Render::SetBuffers(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, ID3D11DeviceContext* context)
+{
+	if (stateCache)
+	{
+		stateCache->SetVertexBuffer(0, vertexBuffer, stride, offset);
+		stateCache->SetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		return;
+	}
+
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+}
+
+void Render::SetStates(ID3D11RasterizerState* rasterizerState, ID3D11DepthStencilState* depthState, ID3D11DeviceContext* context)
+{
+	if (stateCache)
+	{
+		stateCache->SetRasterizerState(rasterizerState);
+		stateCache->SetDepthStencilState(depthState, 0);
+		return;
+	}
+
+	context->RSSetState(rasterizerState);
+	context->OMSetDepthStencilState(depthState, 0);
 }
 
 void Render::SetLights()
 {
 	dirLight_1.SetLightValues(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(10.0f, 0.0f, 0.0f), 0.0f);
 	ambientLight.SetLightValues(XMFLOAT4(0.2f, 0.0f, 0.0f, 1.0f));
-	pointLight1.SetLightValues(XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), XMFLOAT3(2.0f, 0.0f, 0.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	pointLight2.SetLightValues(XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), XMFLOAT3(-2.0f, 0.0f, 0.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	pointLight3.SetLightValues(XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 2.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	pointLight4.SetLightValues(XMFLOAT4(0.6f, 0.0f, 0.4f, 1.0f), XMFLOAT3(0.0f, 0.0f, -2.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight1.SetLightValues(XMFLOAT4(0.1f, 0.9f, 0.1f, 1.0f), XMFLOAT3(0.0f, 0.0f, -4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight2.SetLightValues(XMFLOAT4(0.8f, 0.2f, 0.0f, 1.0f), XMFLOAT3(4.0f, 0.0f, -4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight3.SetLightValues(XMFLOAT4(0.0f, 0.3f, 0.8f, 1.0f), XMFLOAT3(4.0f, 0.0f, 0.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight4.SetLightValues(XMFLOAT4(0.9f, 0.3f, 0.3f, 1.0f), XMFLOAT3(4.0f, 0.0f, 4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight5.SetLightValues(XMFLOAT4(0.2f, 0.7f, 0.3f, 1.0f), XMFLOAT3(0.0f, 0.0f, 4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight6.SetLightValues(XMFLOAT4(0.1f, 0.0f, 0.8f, 1.0f), XMFLOAT3(-4.0f, 0.0f, 4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight7.SetLightValues(XMFLOAT4(0.9f, 0.0f, 0.3f, 1.0f), XMFLOAT3(-4.0f, 0.0f, 0.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	outerPointLight8.SetLightValues(XMFLOAT4(0.0f, 0.8f, 0.3f, 1.0f), XMFLOAT3(-4.0f, 0.0f,-4.0f), 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	spotLight.SetLightValues(XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 10.0f, XMFLOAT3(0.0f, -1.0f, 0.0f), 5.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
-	
+
+	//Inner ring, then outer ring
+	struct { XMFLOAT4 color; XMFLOAT3 position; } points[] =
+	{
+		{ XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), XMFLOAT3(2.0f, 0.0f, 0.0f) },
+		{ XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), XMFLOAT3(-2.0f, 0.0f, 0.0f) },
+		{ XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 2.0f) },
+		{ XMFLOAT4(0.6f, 0.0f, 0.4f, 1.0f), XMFLOAT3(0.0f, 0.0f, -2.0f) },
+		{ XMFLOAT4(0.1f, 0.9f, 0.1f, 1.0f), XMFLOAT3(0.0f, 0.0f, -4.0f) },
+		{ XMFLOAT4(0.8f, 0.2f, 0.0f, 1.0f), XMFLOAT3(4.0f, 0.0f, -4.0f) },
+		{ XMFLOAT4(0.0f, 0.3f, 0.8f, 1.0f), XMFLOAT3(4.0f, 0.0f, 0.0f) },
+		{ XMFLOAT4(0.9f, 0.3f, 0.3f, 1.0f), XMFLOAT3(4.0f, 0.0f, 4.0f) },
+		{ XMFLOAT4(0.2f, 0.7f, 0.3f, 1.0f), XMFLOAT3(0.0f, 0.0f, 4.0f) },
+		{ XMFLOAT4(0.1f, 0.0f, 0.8f, 1.0f), XMFLOAT3(-4.0f, 0.0f, 4.0f) },
+		{ XMFLOAT4(0.9f, 0.0f, 0.3f, 1.0f), XMFLOAT3(-4.0f, 0.0f, 0.0f) },
+		{ XMFLOAT4(0.0f, 0.8f, 0.3f, 1.0f), XMFLOAT3(-4.0f, 0.0f, -4.0f) },
+	};
+
+	pointLights.resize(sizeof(points) / sizeof(points[0]));
+	for (size_t i = 0; i < pointLights.size(); i++)
+		pointLights[i].SetLightValues(points[i].color, points[i].position, 7.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
+
+	spotLights.resize(1);
+	spotLights[0].SetLightValues(XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), 10.0f, XMFLOAT3(0.0f, -1.0f, 0.0f), 5.0f, XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f);
+	lightsDirty = true;
 }
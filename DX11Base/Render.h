@@ -3,6 +3,12 @@
 #include "GameEntity.h"
 #include "Camera.h"
 #include "Lights.h"
+#include "RenderSnapshot.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
+#include "StructuredBuffer.h"
+
+#include <vector>
 
 class Render
 {
@@ -10,33 +16,56 @@ public:
 	Render();
 	~Render();
 
-	void RenderProcess(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context);
-	void RenderSkyBox(Mesh* &mesh, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context, ID3D11RasterizerState* &rasterizerState, ID3D11DepthStencilState* &depthState, ID3D11ShaderResourceView* &SRV);
-	void RenderGBuffer(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context);
-	void RenderLights(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Camera* &camera, ID3D11DeviceContext* &context, ID3D11SamplerState* &sampler, ID3D11ShaderResourceView* &positionGBuffer, ID3D11ShaderResourceView* &normalGBuffer, ID3D11ShaderResourceView* &diffuseGBuffer);
+	// Binds go through the cache when set, filtering repeats
+	void SetStateCache(StateCache* cache) { stateCache = cache; }
+
+	// Forward lighting - the lights, camera and view/projection go
+	// up once per frame, leaving only the world matrix per draw.
+	// Point and spot lights go in one Map each, however many there
+	// are, and only when the lists have changed since the last call
+	// (so pass the same buffers every frame).
+	void SetForwardFrame(SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, StructuredBuffer &pointLightBuffer, StructuredBuffer &spotLightBuffer, ID3D11DeviceContext* context);
+
+	// Compares the forward pixel shader's reflected constants and
+	// light list strides with the C++ structs SetForwardFrame writes.
+	// Prints each mismatch and returns false if there were any.
+	bool CheckForwardLayout(SimplePixelShader* pixelShader);
+
+	// The forward path's light lists.  Editing them through
+	// the Edit versions uploads them again next frame.
+	const std::vector<PointLight>& GetPointLights() const { return pointLights; }
+	const std::vector<SpotLight>& GetSpotLights() const { return spotLights; }
+	std::vector<PointLight>& EditPointLights() { lightsDirty = true; return pointLights; }
+	std::vector<SpotLight>& EditSpotLights() { lightsDirty = true; return spotLights; }
+	void RenderProcess(const DrawItem &item, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, ID3D11DeviceContext* &context);
+	void RenderSkyBox(Mesh* &mesh, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context, ID3D11RasterizerState* &rasterizerState, ID3D11DepthStencilState* &depthState, ID3D11ShaderResourceView* &SRV);
+	void RenderGBuffer(const DrawItem &item, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context);
+
+	// Recorded from pre-built packets into a command buffer, to be
+	// replayed by a backend later.  Safe on any number of threads.
+	void RenderGBufferInstanced(const DrawBatch &batch, ID3D11Buffer* instanceBuffer, CommandBuffer &commands);
+	void RenderShadowCaster(const DrawItem &item, CommandBuffer &commands);
+
+	// The constants shared by a whole run of packets, recorded once
+	// ahead of them - per frame for the g-buffer, per cascade for shadows
+	void RecordGBufferFrame(SimpleVertexShader* vertexShader, const CameraSnapshot &camera, CommandBuffer &commands);
+	void RecordShadowCascade(SimpleVertexShader* vertexShader, const XMFLOAT4X4 &viewProjection, CommandBuffer &commands);
+
+	void RenderLightVolumes(Mesh* mesh, unsigned int lightCount, ID3D11Buffer* instanceBuffer, ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, const CameraSnapshot &camera, ID3D11DeviceContext* &context, ID3D11SamplerState* &sampler, ID3D11ShaderResourceView* &positionGBuffer, ID3D11ShaderResourceView* &normalGBuffer, ID3D11ShaderResourceView* &diffuseGBuffer);
 private:
 	
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
+	StateCache* stateCache;
 
+	void SetBuffers(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, ID3D11DeviceContext* context);
+	void SetStates(ID3D11RasterizerState* rasterizerState, ID3D11DepthStencilState* depthState, ID3D11DeviceContext* context);
 	void SetLights();
 
 	DirectionalLight dirLight_1;
 	AmbientLight ambientLight;
-	PointLight pointLight1;
-	PointLight pointLight2;
-	PointLight pointLight3;
-	PointLight pointLight4;
-
-	PointLight outerPointLight1;
-	PointLight outerPointLight2;
-	PointLight outerPointLight3;
-	PointLight outerPointLight4;
-	PointLight outerPointLight5;
-	PointLight outerPointLight6;
-	PointLight outerPointLight7;
-	PointLight outerPointLight8;
-
-	SpotLight spotLight;
+	std::vector<PointLight> pointLights;
+	std::vector<SpotLight> spotLights;
+	bool lightsDirty;		// The lists changed since they were last uploaded
 };
 
@@ -0,0 +1,475 @@
+#include "RenderGraph.h"
+
+#include <cstdio>
+#include <cstring>
+
+RenderGraph::RenderGraph()
+{
+	backend = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReleaseTextures();
+}
+
+unsigned int RenderGraph::CreateTexture(const char* name, const TextureDesc& desc)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.desc = desc;
+	resource.imported = false;
+	resource.physical = InvalidHandle;
+	resources.push_back(resource);
+	return (unsigned int)resources.size() - 1;
+}
+
+unsigned int RenderGraph::ImportTexture(const char* name, const TextureDesc& desc, const Texture& texture)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.desc = desc;
+	resource.imported = true;
+	resource.importedTexture = texture;
+	resource.physical = InvalidHandle;
+	resources.push_back(resource);
+	return (unsigned int)resources.size() - 1;
+}
+
+void RenderGraph::SetTextureDesc(unsigned int resource, const TextureDesc& desc)
+{
+	resources[resource].desc = desc;
+}
+
+void RenderGraph::SetImportedTexture(unsigned int resource, const Texture& texture)
+{
+	resources[resource].importedTexture = texture;
+}
+
+unsigned int RenderGraph::AddPass(const char* name, PassFunction execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.sideEffects = false;
+	pass.culled = false;
+	passes.push_back(pass);
+	return (unsigned int)passes.size() - 1;
+}
+
+void RenderGraph::SetSideEffects(unsigned int pass)
+{
+	passes[pass].sideEffects = true;
+}
+
+void RenderGraph::Read(unsigned int pass, unsigned int resource)
+{
+	AddAccess(pass, resource, ReadAccess, false, 0);
+}
+
+void RenderGraph::Write(unsigned int pass, unsigned int resource)
+{
+	AddAccess(pass, resource, WriteAccess, true, 0);
+}
+
+void RenderGraph::WriteColor(unsigned int pass, unsigned int resource, bool clear, const float clearValue[4])
+{
+	AddAccess(pass, resource, ColorAccess, clear, clearValue);
+}
+
+void RenderGraph::WriteDepth(unsigned int pass, unsigned int resource, bool clear)
+{
+	const float farDepth[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	AddAccess(pass, resource, DepthAccess, clear, farDepth);
+}
+
+void RenderGraph::AddAccess(unsigned int pass, unsigned int resource, AccessType type, bool clear, const float clearValue[4])
+{
+	Access access = {};
+	access.resource = resource;
+	access.type = type;
+	access.clear = clear;
+	if (clearValue)
+		memcpy(access.clearValue, clearValue, sizeof(access.clearValue));
+	passes[pass].accesses.push_back(access);
+}
+
+// --------------------------------------------------------
+// Culls passes, works out lifetimes and hands every live
+// transient a pooled physical texture
+// --------------------------------------------------------
+bool RenderGraph::Compile(Backend* backend)
+{
+	ReleaseTextures();
+	this->backend = backend;
+	memset(&stats, 0, sizeof(stats));
+
+	// Reading old contents counts for bound targets that aren't cleared
+	auto readsOld = [](const Access& access) { return access.type == ReadAccess || ((access.type == ColorAccess || access.type == DepthAccess) && !access.clear); };
+
+	// A transient must be written before anything reads it
+	std::vector<bool> written(resources.size(), false);
+	for (auto& pass : passes)
+	{
+		for (auto& access : pass.accesses)
+		{
+			if (readsOld(access) && !resources[access.resource].imported && !written[access.resource])
+			{
+				printf("\nRender graph: pass '%s' reads '%s' before anything writes it\n", pass.name, resources[access.resource].name);
+				return false;
+			}
+		}
+		for (auto& access : pass.accesses)
+			if (access.type != ReadAccess)
+				written[access.resource] = true;
+	}
+
+	// Walk backwards from what has to be produced - imported
+	// textures outlive the frame, so they always count
+	std::vector<bool> needed(resources.size(), false);
+	for (unsigned int r = 0; r < resources.size(); r++)
+		needed[r] = resources[r].imported;
+
+	for (unsigned int p = (unsigned int)passes.size(); p-- > 0;)
+	{
+		Pass& pass = passes[p];
+		bool keep = pass.sideEffects;
+		for (auto& access : pass.accesses)
+			if (access.type != ReadAccess && needed[access.resource])
+				keep = true;
+
+		pass.culled = !keep;
+		if (!keep)
+		{
+			stats.culledPassCount++;
+			continue;
+		}
+
+		// Whatever this pass replaces wholesale, earlier writers
+		// needn't produce - unless it reads the old contents too
+		for (auto& access : pass.accesses)
+			if (access.type != ReadAccess && access.clear && !resources[access.resource].imported)
+				needed[access.resource] = false;
+		for (auto& access : pass.accesses)
+			if (readsOld(access))
+				needed[access.resource] = true;
+	}
+	stats.passCount = (unsigned int)passes.size();
+
+	// Lifetimes, in kept pass indices
+	for (auto& resource : resources)
+	{
+		resource.physical = InvalidHandle;
+		resource.firstPass = InvalidHandle;
+		resource.lastPass = 0;
+	}
+	for (unsigned int p = 0; p < passes.size(); p++)
+	{
+		if (passes[p].culled)
+			continue;
+
+		for (auto& access : passes[p].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (resource.imported)
+				continue;
+			if (resource.firstPass == InvalidHandle)
+				resource.firstPass = p;
+			resource.lastPass = p;
+		}
+	}
+
+	// Hand out pooled textures in order of first use, reusing
+	// any matching one whose last user has already run
+	for (unsigned int p = 0; p < passes.size(); p++)
+	{
+		if (passes[p].culled)
+			continue;
+
+		for (auto& access : passes[p].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (resource.imported || resource.firstPass != p || resource.physical != InvalidHandle)
+				continue;
+
+			for (unsigned int i = 0; i < pool.size(); i++)
+			{
+				if (pool[i].desc == resource.desc && pool[i].lastPass < p)
+				{
+					resource.physical = i;
+					break;
+				}
+			}
+			if (resource.physical == InvalidHandle)
+			{
+				Physical physical = {};
+				physical.desc = resource.desc;
+				pool.push_back(physical);
+				resource.physical = (unsigned int)pool.size() - 1;
+			}
+			pool[resource.physical].lastPass = resource.lastPass;
+		}
+	}
+
+	// Memory, both ways, and the peak a real heap would need
+	for (auto& resource : resources)
+	{
+		if (resource.imported || resource.physical == InvalidHandle)
+			continue;
+		stats.transientCount++;
+		stats.unaliasedBytes += GetTextureBytes(resource.desc);
+	}
+	for (auto& physical : pool)
+		stats.aliasedBytes += GetTextureBytes(physical.desc);
+	stats.physicalCount = (unsigned int)pool.size();
+
+	for (unsigned int p = 0; p < passes.size(); p++)
+	{
+		if (passes[p].culled)
+			continue;
+
+		size_t live = 0;
+		for (auto& resource : resources)
+			if (resource.physical != InvalidHandle && resource.firstPass <= p && p <= resource.lastPass)
+				live += GetTextureBytes(resource.desc);
+		if (live > stats.peakLiveBytes)
+			stats.peakLiveBytes = live;
+	}
+
+	for (auto& physical : pool)
+	{
+		if (!backend->CreateTexture(physical.desc, physical.texture))
+		{
+			printf("\nRender graph: couldn't create a %ux%u texture\n", physical.desc.width, physical.desc.height);
+			return false;
+		}
+	}
+	return true;
+}
+
+void RenderGraph::Execute()
+{
+	for (auto& pass : passes)
+	{
+		if (pass.culled)
+			continue;
+
+		PassTargets targets = {};
+		for (auto& access : pass.accesses)
+		{
+			const Resource& resource = resources[access.resource];
+			if (access.type == ColorAccess && targets.colorCount < MaxColorTargets)
+			{
+				targets.clearColor[targets.colorCount] = access.clear;
+				memcpy(targets.clearValue[targets.colorCount], access.clearValue, sizeof(access.clearValue));
+				targets.color[targets.colorCount++] = &GetTexture(access.resource);
+			}
+			else if (access.type == DepthAccess)
+			{
+				targets.depth = &GetTexture(access.resource);
+				targets.clearDepth = access.clear;
+			}
+			else
+			{
+				continue;
+			}
+
+			targets.width = resource.desc.width;
+			targets.height = resource.desc.height;
+		}
+
+		if (targets.colorCount > 0 || targets.depth)
+			backend->BeginPass(targets);
+		if (pass.execute)
+			pass.execute();
+	}
+}
+
+const RenderGraph::Texture& RenderGraph::GetTexture(unsigned int resource) const
+{
+	const Resource& virtualTexture = resources[resource];
+	if (virtualTexture.imported)
+		return virtualTexture.importedTexture;
+
+	// Culled away entirely, so there's nothing behind it
+	static const Texture none = {};
+	if (virtualTexture.physical == InvalidHandle)
+		return none;
+	return pool[virtualTexture.physical].texture;
+}
+
+void RenderGraph::PrintReport() const
+{
+	printf("\nRender graph (%u passes, %u culled)\n", stats.passCount, stats.culledPassCount);
+	for (unsigned int p = 0; p < passes.size(); p++)
+		printf("  %u %-16s%s\n", p, passes[p].name, passes[p].culled ? "  culled" : "");
+
+	for (auto& resource : resources)
+	{
+		if (resource.imported)
+			printf("  %-16s imported\n", resource.name);
+		else if (resource.physical == InvalidHandle)
+			printf("  %-16s unused\n", resource.name);
+		else
+			printf("  %-16s passes %u-%u  texture %u  %6.2f MB\n", resource.name, resource.firstPass, resource.lastPass,
+				resource.physical, GetTextureBytes(resource.desc) / (1024.0 * 1024.0));
+	}
+
+	printf("  Transients: %u in %u textures\n", stats.transientCount, stats.physicalCount);
+	printf("  Memory: %.2f MB unaliased, %.2f MB pooled, %.2f MB peak live\n",
+		stats.unaliasedBytes / (1024.0 * 1024.0), stats.aliasedBytes / (1024.0 * 1024.0), stats.peakLiveBytes / (1024.0 * 1024.0));
+}
+
+size_t RenderGraph::GetTextureBytes(const TextureDesc& desc)
+{
+	size_t bytesPerPixel;
+	switch (desc.format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+		bytesPerPixel = 16;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		bytesPerPixel = 8;
+		break;
+	case DXGI_FORMAT_R8_UNORM:
+		bytesPerPixel = 1;
+		break;
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_TYPELESS:
+		bytesPerPixel = 2;
+		break;
+	default:
+		// R8G8B8A8, R24G8, R32 and the like
+		bytesPerPixel = 4;
+		break;
+	}
+	return (size_t)desc.width * desc.height * bytesPerPixel;
+}
+
+void RenderGraph::ReleaseTextures()
+{
+	if (backend)
+	{
+		for (auto& physical : pool)
+			if (physical.texture.texture || physical.texture.rtv || physical.texture.srv || physical.texture.dsv)
+				backend->DestroyTexture(physical.texture);
+	}
+	pool.clear();
+}
+
+// --------------------------------------------------------
+// D3D11 backend
+// --------------------------------------------------------
+D3D11GraphBackend::D3D11GraphBackend(ID3D11Device* device, ID3D11DeviceContext* context, StateCache* stateCache)
+{
+	SetDevice(device, context, stateCache);
+}
+
+void D3D11GraphBackend::SetDevice(ID3D11Device* device, ID3D11DeviceContext* context, StateCache* stateCache)
+{
+	this->device = device;
+	this->context = context;
+	this->stateCache = stateCache;
+}
+
+bool D3D11GraphBackend::CreateTexture(const RenderGraph::TextureDesc& desc, RenderGraph::Texture& texture)
+{
+	memset(&texture, 0, sizeof(texture));
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.width;
+	textureDesc.Height = desc.height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = desc.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = desc.bindFlags;
+	if (FAILED(device->CreateTexture2D(&textureDesc, 0, &texture.texture)))
+		return false;
+
+	// Typeless depth needs typed views on both sides
+	DXGI_FORMAT depthFormat = desc.format;
+	DXGI_FORMAT readFormat = desc.format;
+	if (desc.format == DXGI_FORMAT_R24G8_TYPELESS)
+	{
+		depthFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		readFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	}
+	else if (desc.format == DXGI_FORMAT_R32_TYPELESS)
+	{
+		depthFormat = DXGI_FORMAT_D32_FLOAT;
+		readFormat = DXGI_FORMAT_R32_FLOAT;
+	}
+
+	bool created = true;
+	if (desc.bindFlags & D3D11_BIND_RENDER_TARGET)
+		created = created && SUCCEEDED(device->CreateRenderTargetView(texture.texture, 0, &texture.rtv));
+
+	if (desc.bindFlags & D3D11_BIND_DEPTH_STENCIL)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = depthFormat;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		created = created && SUCCEEDED(device->CreateDepthStencilView(texture.texture, &dsvDesc, &texture.dsv));
+	}
+
+	if (desc.bindFlags & D3D11_BIND_SHADER_RESOURCE)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = readFormat;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		created = created && SUCCEEDED(device->CreateShaderResourceView(texture.texture, &srvDesc, &texture.srv));
+	}
+
+	if (!created)
+		DestroyTexture(texture);
+	return created;
+}
+
+void D3D11GraphBackend::DestroyTexture(RenderGraph::Texture& texture)
+{
+	if (texture.rtv) texture.rtv->Release();
+	if (texture.srv) texture.srv->Release();
+	if (texture.dsv) texture.dsv->Release();
+	if (texture.texture) texture.texture->Release();
+	memset(&texture, 0, sizeof(texture));
+}
+
+void D3D11GraphBackend::BeginPass(const RenderGraph::PassTargets& targets)
+{
+	ID3D11RenderTargetView* rtvs[RenderGraph::MaxColorTargets] = {};
+	for (unsigned int i = 0; i < targets.colorCount; i++)
+		rtvs[i] = targets.color[i]->rtv;
+	ID3D11DepthStencilView* dsv = targets.depth ? targets.depth->dsv : 0;
+
+	stateCache->SetRenderTargets(targets.colorCount, rtvs, dsv);
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)targets.width;
+	viewport.Height = (float)targets.height;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+
+	for (unsigned int i = 0; i < targets.colorCount; i++)
+		if (targets.clearColor[i])
+			context->ClearRenderTargetView(rtvs[i], targets.clearValue[i]);
+	if (dsv && targets.clearDepth)
+		context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
+
+// --------------------------------------------------------
+// Null backend
+// --------------------------------------------------------
+bool NullGraphBackend::CreateTexture(const RenderGraph::TextureDesc& desc, RenderGraph::Texture& texture)
+{
+	// Something non-null, so the graph knows to destroy it later
+	memset(&texture, 0, sizeof(texture));
+	texture.texture = (ID3D11Texture2D*)(size_t)(++created);
+	return true;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <d3d11.h>
+#include <functional>
+#include <vector>
+
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Frame graph of render passes and the textures between them
+//
+// Passes are declared once, in order, along with the virtual
+// textures they read and write.  Compile() then:
+//  - culls passes whose output nothing ends up using (a pass
+//    is kept if it has side effects, writes an imported
+//    texture, or writes something a kept pass reads)
+//  - works out the first and last kept pass touching each
+//    transient texture
+//  - gives transients with the same description and no
+//    overlap in lifetime the same physical texture
+//
+// D3D11 has no placed resources to alias inside a heap, so
+// "aliasing" here means sharing a pooled texture.  The report
+// shows both what that costs and the peak of live transients,
+// which is what a heap would get down to.
+//
+// Execute() runs the kept passes, binding and clearing each
+// one's targets and viewport first.  Fixed function states
+// stay with the passes themselves.
+//
+// Nothing here needs a device - with NullGraphBackend the
+// whole of Compile() runs headless.
+// --------------------------------------------------------
+class RenderGraph
+{
+public:
+	static const unsigned int MaxColorTargets = 4;
+	static const unsigned int InvalidHandle = 0xFFFFFFFF;
+
+	struct TextureDesc
+	{
+		unsigned int width;
+		unsigned int height;
+		DXGI_FORMAT format;		// Typeless depth formats get typed views
+		unsigned int bindFlags;
+
+		bool operator==(const TextureDesc& other) const
+		{
+			return width == other.width && height == other.height && format == other.format && bindFlags == other.bindFlags;
+		}
+	};
+
+	// A physical texture and whichever views its bind flags allow
+	struct Texture
+	{
+		ID3D11Texture2D* texture;
+		ID3D11RenderTargetView* rtv;
+		ID3D11ShaderResourceView* srv;
+		ID3D11DepthStencilView* dsv;
+	};
+
+	// What a pass draws into, handed to the backend before it runs
+	struct PassTargets
+	{
+		const Texture* color[MaxColorTargets];
+		unsigned int colorCount;
+		const Texture* depth;
+		bool clearColor[MaxColorTargets];
+		float clearValue[MaxColorTargets][4];
+		bool clearDepth;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() {}
+		virtual bool CreateTexture(const TextureDesc& desc, Texture& texture) = 0;
+		virtual void DestroyTexture(Texture& texture) = 0;
+		virtual void BeginPass(const PassTargets& targets) = 0;
+	};
+
+	struct Stats
+	{
+		unsigned int passCount;
+		unsigned int culledPassCount;
+		unsigned int transientCount;
+		unsigned int physicalCount;
+		size_t unaliasedBytes;	// Every transient with its own texture
+		size_t aliasedBytes;	// The pooled textures actually created
+		size_t peakLiveBytes;	// Most transient bytes alive during one pass
+	};
+
+	typedef std::function<void()> PassFunction;
+
+	RenderGraph();
+	~RenderGraph();
+
+	// Virtual textures - transients belong to the graph, imported
+	// ones (the back buffer, say) are only tracked by it
+	unsigned int CreateTexture(const char* name, const TextureDesc& desc);
+	unsigned int ImportTexture(const char* name, const TextureDesc& desc, const Texture& texture);
+	const TextureDesc& GetTextureDesc(unsigned int resource) const { return resources[resource].desc; }
+	void SetTextureDesc(unsigned int resource, const TextureDesc& desc);
+	void SetImportedTexture(unsigned int resource, const Texture& texture);
+
+	// Passes run in the order they're added
+	unsigned int AddPass(const char* name, PassFunction execute);
+	void SetSideEffects(unsigned int pass);
+
+	// Sampled in a shader
+	void Read(unsigned int pass, unsigned int resource);
+
+	// Written in some way the graph doesn't bind (copies, its own
+	// views), replacing all of the old contents
+	void Write(unsigned int pass, unsigned int resource);
+
+	// Bound as a render target or depth buffer.  Without a clear
+	// the old contents are kept, which counts as reading them.
+	void WriteColor(unsigned int pass, unsigned int resource, bool clear, const float clearValue[4] = 0);
+	void WriteDepth(unsigned int pass, unsigned int resource, bool clear);
+
+	// Culls, assigns physical textures and creates them.  False
+	// if a transient is read before anything writes it.
+	bool Compile(Backend* backend);
+	void Execute();
+
+	const Texture& GetTexture(unsigned int resource) const;
+	bool IsPassCulled(unsigned int pass) const { return passes[pass].culled; }
+	unsigned int GetPhysicalIndex(unsigned int resource) const { return resources[resource].physical; }
+	const Stats& GetStats() const { return stats; }
+
+	// Passes, lifetimes and memory, to stdout
+	void PrintReport() const;
+
+	static size_t GetTextureBytes(const TextureDesc& desc);
+
+private:
+	enum AccessType
+	{
+		ReadAccess,
+		WriteAccess,
+		ColorAccess,
+		DepthAccess
+	};
+
+	struct Access
+	{
+		unsigned int resource;
+		AccessType type;
+		bool clear;
+		float clearValue[4];
+	};
+
+	struct Pass
+	{
+		const char* name;
+		PassFunction execute;
+		std::vector<Access> accesses;
+		bool sideEffects;
+		bool culled;
+	};
+
+	struct Resource
+	{
+		const char* name;
+		TextureDesc desc;
+		bool imported;
+		Texture importedTexture;
+		unsigned int physical;		// Into the pool, for transients
+		unsigned int firstPass;
+		unsigned int lastPass;
+	};
+
+	struct Physical
+	{
+		TextureDesc desc;
+		Texture texture;
+		unsigned int lastPass;		// Free again after this pass
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<Physical> pool;
+	Backend* backend;
+	Stats stats;
+
+	void AddAccess(unsigned int pass, unsigned int resource, AccessType type, bool clear, const float clearValue[4]);
+	void ReleaseTextures();
+};
+
+// --------------------------------------------------------
+// Creates real textures and binds passes through the state cache
+// --------------------------------------------------------
+class D3D11GraphBackend : public RenderGraph::Backend
+{
+public:
+	D3D11GraphBackend(ID3D11Device* device = 0, ID3D11DeviceContext* context = 0, StateCache* stateCache = 0);
+	void SetDevice(ID3D11Device* device, ID3D11DeviceContext* context, StateCache* stateCache);
+
+	bool CreateTexture(const RenderGraph::TextureDesc& desc, RenderGraph::Texture& texture);
+	void DestroyTexture(RenderGraph::Texture& texture);
+	void BeginPass(const RenderGraph::PassTargets& targets);
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	StateCache* stateCache;
+};
+
+// --------------------------------------------------------
+// Creates nothing and binds nothing, only counting, so graphs
+// can be compiled and run without a device
+// --------------------------------------------------------
+class NullGraphBackend : public RenderGraph::Backend
+{
+public:
+	NullGraphBackend() { created = 0; destroyed = 0; passesBegun = 0; }
+
+	bool CreateTexture(const RenderGraph::TextureDesc& desc, RenderGraph::Texture& texture);
+	void DestroyTexture(RenderGraph::Texture& texture) { destroyed++; }
+	void BeginPass(const RenderGraph::PassTargets& targets) { passesBegun++; }
+
+	unsigned int GetLiveTextureCount() const { return created - destroyed; }
+	unsigned int GetPassesBegun() const { return passesBegun; }
+
+private:
+	unsigned int created;
+	unsigned int destroyed;
+	unsigned int passesBegun;
+};
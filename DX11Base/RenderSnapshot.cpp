@@ -0,0 +1,35 @@
+#include "RenderSnapshot.h"
+
+SnapshotBuffer::SnapshotBuffer()
+{
+	writeIndex = 0;
+	sharedIndex = 1;
+	readIndex = 2;
+
+	for (int i = 0; i < 3; i++)
+		snapshots[i].Clear();
+}
+
+// --------------------------------------------------------
+// Hands the finished write snapshot over to the reader and
+// takes back whichever one was sitting in the middle
+// --------------------------------------------------------
+void SnapshotBuffer::Publish()
+{
+	unsigned int previous = sharedIndex.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+	writeIndex = previous & ~FreshBit;
+}
+
+// --------------------------------------------------------
+// Swaps the reader's snapshot for the newest published one
+// --------------------------------------------------------
+bool SnapshotBuffer::Acquire()
+{
+	// Nothing new since last time?
+	if (!(sharedIndex.load(std::memory_order_relaxed) & FreshBit))
+		return false;
+
+	unsigned int previous = sharedIndex.exchange(readIndex, std::memory_order_acq_rel);
+	readIndex = previous & ~FreshBit;
+	return true;
+}
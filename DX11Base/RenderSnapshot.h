@@ -0,0 +1,156 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <vector>
+
+#include "Mesh.h"
+#include "Material.h"
+#include "DrawPacket.h"
+#include "ShadowCascades.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Everything the renderer needs to know about the camera
+// --------------------------------------------------------
+struct CameraSnapshot
+{
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMFLOAT3 position;
+	XMFLOAT4 frustumPlanes[6];
+};
+
+// One opaque mesh to draw into the g-buffer and shadow maps.
+// The mesh, material and textures are looked up from the
+// entity's handles as the frame is published.  Deferred drawing
+// only sorts by them and goes through the entity's pre-built
+// packets, the forward path binds them directly.
+struct DrawItem
+{
+	Mesh* mesh;
+	Material* material;
+	ID3D11ShaderResourceView* texture;
+	ID3D11ShaderResourceView* normalMap;
+	const DrawPacket* gBufferPacket;
+	const DrawPacket* shadowPacket;
+	XMFLOAT4X4 world;
+};
+
+// A run of g-buffer draws sharing a packet (so a mesh and
+// material), drawn as one instanced call.  Its world matrices
+// are instanceCount entries of RenderSnapshot::instanceWorlds
+// from firstInstance.
+struct DrawBatch
+{
+	const DrawPacket* packet;
+	unsigned int firstInstance;
+	unsigned int instanceCount;
+};
+
+// One point light, as the game thread gathers it
+struct LightItem
+{
+	Mesh* mesh;
+	XMFLOAT4X4 world;
+	XMFLOAT3 position;
+	XMFLOAT3 color;
+};
+
+// One point light volume in the instanced lighting pass.  The
+// layout matches LightingPassVertexShader's per instance input.
+struct LightInstance
+{
+	XMFLOAT3 position;
+	float radius;				// World radius of the light volume
+	XMFLOAT3 color;
+	XMFLOAT4 scissor;			// Screen area the light can reach, NDC min x, min y, max x, max y
+};
+
+// One shadow map cascade and the casters that reach it
+struct ShadowCascadeSnapshot
+{
+	XMFLOAT4X4 viewProjection;	// Transposed for the shaders
+	float splitFar;				// View depth where this cascade ends
+	std::vector<DrawItem> staticCasters;	// Can be drawn once and cached
+	std::vector<DrawItem> casters;			// Drawn every frame
+};
+
+// --------------------------------------------------------
+// An immutable copy of one frame's worth of render data.
+//
+// The game thread fills one of these in after updating, and
+// the render thread draws purely from it, so the two never
+// touch the same entity or camera at the same time.
+// --------------------------------------------------------
+struct RenderSnapshot
+{
+	CameraSnapshot camera;
+	std::vector<DrawBatch> drawBatches;
+	std::vector<XMFLOAT4X4> instanceWorlds;		// Transposed, like DrawItem::world
+	Mesh* lightVolumeMesh;
+	std::vector<LightInstance> lightInstances;
+	ShadowCascadeSnapshot shadowCascades[ShadowCascades::MaxCascades];
+	unsigned int shadowCascadeCount;
+	unsigned int staticShadowVersion;	// Changes whenever static casters move
+	bool shadowCacheEnabled;
+	bool forwardEnabled;
+	std::vector<DrawItem> forwardItems;		// Sorted like the batches, only when forwardEnabled
+	Mesh* skyMesh;
+	ID3D11ShaderResourceView* skyTexture;
+
+	// Empties the lists but keeps their memory for next time
+	void Clear()
+	{
+		drawBatches.clear();
+		instanceWorlds.clear();
+		lightVolumeMesh = 0;
+		lightInstances.clear();
+		for (unsigned int i = 0; i < ShadowCascades::MaxCascades; i++)
+		{
+			shadowCascades[i].staticCasters.clear();
+			shadowCascades[i].casters.clear();
+		}
+		shadowCascadeCount = 0;
+		staticShadowVersion = 0;
+		shadowCacheEnabled = false;
+		forwardEnabled = false;
+		forwardItems.clear();
+		skyMesh = 0;
+		skyTexture = 0;
+	}
+};
+
+// --------------------------------------------------------
+// Lock-free triple buffer of render snapshots
+//
+// The writer always has one snapshot to fill and the reader
+// always has one to draw from.  The third is the most recently
+// published one, and each side swaps with it atomically, so
+// neither side ever waits on the other.  If the writer gets
+// ahead, older snapshots are simply overwritten.
+// --------------------------------------------------------
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer();
+
+	// Writer side - fill GetWriteSnapshot(), then Publish()
+	RenderSnapshot& GetWriteSnapshot() { return snapshots[writeIndex]; }
+	void Publish();
+
+	// Reader side - Acquire() swaps in the newest published
+	// snapshot, returning false if nothing new has arrived
+	bool Acquire();
+	const RenderSnapshot& GetReadSnapshot() { return snapshots[readIndex]; }
+
+private:
+	// Set in the shared index when it holds an unread snapshot
+	static const unsigned int FreshBit = 0x4;
+
+	RenderSnapshot snapshots[3];
+	std::atomic<unsigned int> sharedIndex;
+	unsigned int writeIndex;
+	unsigned int readIndex;
+};
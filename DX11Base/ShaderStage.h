@@ -0,0 +1,13 @@
+#pragma once
+
+// --------------------------------------------------------
+// The programmable stages resources are bound to.  Kept out
+// of the D3D headers so recorded commands can name a stage
+// without pulling in the device.
+// --------------------------------------------------------
+enum ShaderStage
+{
+	VertexStage,
+	PixelStage,
+	ShaderStageCount
+};
@@ -0,0 +1,99 @@
+#include "ShadowCascades.h"
+#include "FrustumPlanes.h"
+
+#include <cmath>
+
+ShadowCascades::ShadowCascades(unsigned int cascadeCount, unsigned int resolution, float splitLambda)
+{
+	this->cascadeCount = cascadeCount < MaxCascades ? cascadeCount : MaxCascades;
+	this->resolution = resolution;
+	this->splitLambda = splitLambda;
+
+	for (unsigned int i = 0; i < MaxCascades; i++)
+	{
+		XMStoreFloat4x4(&cascades[i].viewProjection, XMMatrixIdentity());
+		for (int p = 0; p < 6; p++)
+			cascades[i].casterPlanes[p] = XMFLOAT4(0, 0, 0, 1);
+		cascades[i].splitNear = 0.0f;
+		cascades[i].splitFar = 0.0f;
+	}
+}
+
+void ShadowCascades::ComputeSplits(float nearZ, float farZ, unsigned int count, float lambda, float* splits)
+{
+	splits[0] = nearZ;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		float fraction = (float)i / count;
+		float logarithmic = nearZ * powf(farZ / nearZ, fraction);
+		float uniform = nearZ + (farZ - nearZ) * fraction;
+		splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+	splits[count] = farZ;
+}
+
+void ShadowCascades::Fit(FXMMATRIX view, CXMMATRIX projection, FXMVECTOR lightDirection)
+{
+	// Recover the camera's shape from its (left handed) projection
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, projection);
+	float nearZ = -p._43 / p._33;
+	float farZ = p._43 / (1.0f - p._33);
+	float tanX = 1.0f / p._11;
+	float tanY = 1.0f / p._22;
+
+	float splits[MaxCascades + 1];
+	ComputeSplits(nearZ, farZ, cascadeCount, splitLambda, splits);
+
+	// The light's orientation depends only on its direction, so
+	// the texel grid stays put while the camera moves
+	XMVECTOR direction = XMVector3Normalize(lightDirection);
+	XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+	XMMATRIX lightView = XMMatrixLookToLH(XMVectorZero(), direction, up);
+	XMMATRIX cameraToLight = XMMatrixMultiply(XMMatrixInverse(0, view), lightView);
+
+	for (unsigned int c = 0; c < cascadeCount; c++)
+	{
+		Cascade& cascade = cascades[c];
+		cascade.splitNear = splits[c];
+		cascade.splitFar = splits[c + 1];
+
+		// Bounding sphere of the slice.  The frustum is symmetric, so
+		// the corners' average sits on the view axis and the radius
+		// depends only on the slice's shape, never its orientation.
+		XMVECTOR corners[8];
+		XMVECTOR center = XMVectorZero();
+		for (int i = 0; i < 8; i++)
+		{
+			float z = (i & 4) ? cascade.splitFar : cascade.splitNear;
+			corners[i] = XMVectorSet((i & 1) ? tanX * z : -tanX * z, (i & 2) ? tanY * z : -tanY * z, z, 1.0f);
+			center = XMVectorAdd(center, corners[i]);
+		}
+		center = XMVectorScale(center, 1.0f / 8.0f);
+
+		float radius = 0.0f;
+		for (int i = 0; i < 8; i++)
+			radius = fmaxf(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(corners[i], center))));
+
+		// Round the radius up a little so float noise can't change it
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		// Snap the center to whole texels in light space
+		float texelSize = radius * 2.0f / resolution;
+		XMFLOAT3 lightCenter;
+		XMStoreFloat3(&lightCenter, XMVector3Transform(center, cameraToLight));
+		lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+
+		XMMATRIX ortho = XMMatrixOrthographicOffCenterLH(
+			lightCenter.x - radius, lightCenter.x + radius,
+			lightCenter.y - radius, lightCenter.y + radius,
+			lightCenter.z - radius, lightCenter.z + radius);
+		XMMATRIX viewProjection = XMMatrixMultiply(lightView, ortho);
+		XMStoreFloat4x4(&cascade.viewProjection, viewProjection);
+
+		// Same box for culling casters, but open toward the light
+		ExtractFrustumPlanes(viewProjection, cascade.casterPlanes);
+		cascade.casterPlanes[4] = XMFLOAT4(0, 0, 0, 1);
+	}
+}
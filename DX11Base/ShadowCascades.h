@@ -0,0 +1,60 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Cascaded shadow map fitting for a directional light
+//
+// The camera's view range is cut into slices with the
+// practical split scheme (a blend of logarithmic and uniform
+// splits), and each slice gets its own orthographic shadow
+// map.  Cascades are fitted to a bounding sphere of their
+// slice, so their size never changes as the camera turns,
+// and their position is snapped to whole shadow map texels,
+// so moving the camera doesn't make shadow edges crawl.
+//
+// Each cascade also carries planes for culling its casters.
+// They match the cascade's box except toward the light, which
+// is left open - anything between the light and the cascade
+// can still shadow it.  Shadow maps are drawn with depth clip
+// off, so those casters flatten onto the near plane.
+//
+// No GPU code in here, so the fitting is tested headless.
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+	static const unsigned int MaxCascades = 4;
+
+	struct Cascade
+	{
+		XMFLOAT4X4 viewProjection;	// Regular (non-transposed) light view * projection
+		XMFLOAT4 casterPlanes[6];	// Inside is positive, same order as ExtractFrustumPlanes
+		float splitNear;			// View space depth range this cascade covers
+		float splitFar;
+	};
+
+	// lambda blends logarithmic (1) and uniform (0) splits
+	ShadowCascades(unsigned int cascadeCount = 4, unsigned int resolution = 1024, float splitLambda = 0.8f);
+
+	// Practical split scheme.  Fills count + 1 depths, from nearZ
+	// to farZ, marking where each cascade starts and ends.
+	static void ComputeSplits(float nearZ, float farZ, unsigned int count, float lambda, float* splits);
+
+	// Fits every cascade to a camera.  view and projection are its
+	// regular (non-transposed) matrices, and lightDirection points
+	// from the light into the scene.
+	void Fit(FXMMATRIX view, CXMMATRIX projection, FXMVECTOR lightDirection);
+
+	unsigned int GetCascadeCount() const { return cascadeCount; }
+	unsigned int GetResolution() const { return resolution; }
+	const Cascade& GetCascade(unsigned int index) const { return cascades[index]; }
+
+private:
+	unsigned int cascadeCount;
+	unsigned int resolution;
+	float splitLambda;
+	Cascade cascades[MaxCascades];
+};
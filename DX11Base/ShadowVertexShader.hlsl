@@ -0,0 +1,26 @@
+// Changes with every caster
+cbuffer perObject : register(b0)
+{
+	matrix world;
+};
+
+// Uploaded once per cascade
+cbuffer perCascade : register(b1)
+{
+	matrix viewProjection;		// One shadow cascade's light view * projection
+};
+
+// Same layout as every mesh, though only position is used
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD0;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+};
+
+// Depth only - there's no pixel shader for shadow casters
+float4 main(in VertexShaderInput input) : SV_POSITION
+{
+	return mul(mul(float4(input.position, 1.0f), world), viewProjection);
+}
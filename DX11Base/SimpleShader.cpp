@@ -1,9 +1,25 @@
 #include "SimpleShader.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
+// --------------------------------------------------------
+// The tables are keyed by std::string, so lookups by name
+// need one.  Building it in a string kept per thread means
+// it stops touching the heap once it's as long as the
+// longest name, where a temporary would allocate for every
+// name too long for the small string buffer.
+// --------------------------------------------------------
+static const std::string& LookupKey(const char* name)
+{
+	thread_local std::string key;
+	key.assign(name);
+	return key;
+}
+
 // --------------------------------------------------------
 // Constructor accepts DirectX device & context
 // --------------------------------------------------------
@@ -12,6 +28,7 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
+	this->stateCache = 0;
 
 	// Set up fields
 	constantBufferCount = 0;
@@ -116,11 +133,14 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // Structured and raw buffers bind as SRVs too
+		case D3D_SIT_BYTEADDRESS:
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
 			srv->BindIndex = resourceDesc.BindPoint;	// Shader bind point
 			srv->Index = shaderResourceViews.size();	// Raw index
+			srv->Stride = resourceDesc.Type == D3D_SIT_STRUCTURED ? resourceDesc.NumSamples : 0;	// Reflection keeps the stride here
 
 			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
 			shaderResourceViews.push_back(srv);
@@ -174,8 +194,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size * ScratchCount];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size * ScratchCount);
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -215,11 +235,11 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(const char* name, int size)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+		varTable.find(LookupKey(name));
 
 	// Did we find the key?
 	if (result == varTable.end())
@@ -239,11 +259,11 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(const char* name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+		cbTable.find(LookupKey(name));
 
 	// Did we find the key?
 	if (result == cbTable.end())
@@ -282,10 +302,60 @@ void ISimpleShader::CopyAllBufferData()
 		// Copy the entire local data buffer
 		deviceContext->UpdateSubresource(
 			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+			GetLocalData(&constantBuffers[i]), 0, 0);
+		if (stateCache) stateCache->CountConstantUpload(constantBuffers[i].Size);
 	}
 }
 
+// --------------------------------------------------------
+// Picks which copy of the constant buffer data this thread
+// works on.  Each slot must only be used by one thread at once.
+// --------------------------------------------------------
+static thread_local unsigned int threadScratch = 0;
+
+void ISimpleShader::SetThreadScratch(unsigned int index)
+{
+	threadScratch = index < ScratchCount ? index : 0;
+}
+
+unsigned int ISimpleShader::GetThreadScratch()
+{
+	return threadScratch;
+}
+
+unsigned char* ISimpleShader::GetLocalData(const SimpleConstantBuffer* cb)
+{
+	return cb->LocalDataBuffer + cb->Size * threadScratch;
+}
+
+// --------------------------------------------------------
+// Records an update and a bind of every constant buffer,
+// with a copy of its local data as it is right now
+// --------------------------------------------------------
+void ISimpleShader::RecordAllBufferData(CommandBuffer& commands, StateCache::Stage stage)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		commands.RecordUpdateConstantBuffer(constantBuffers[i].ConstantBuffer, GetLocalData(&constantBuffers[i]), constantBuffers[i].Size);
+		commands.RecordBindConstantBuffer(stage, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
+	}
+}
+
+void ISimpleShader::RecordBufferData(CommandBuffer& commands, StateCache::Stage stage, const char* bufferName)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (!cb) return;
+
+	commands.RecordUpdateConstantBuffer(cb->ConstantBuffer, GetLocalData(cb), cb->Size);
+	commands.RecordBindConstantBuffer(stage, cb->BindIndex, cb->ConstantBuffer);
+}
+
 // --------------------------------------------------------
 // Copies local data to the shader's specified constant buffer
 //
@@ -313,7 +383,8 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	// Copy the data and get out
 	deviceContext->UpdateSubresource(
 		cb->ConstantBuffer, 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+		GetLocalData(cb), 0, 0);
+	if (stateCache) stateCache->CountConstantUpload(cb->Size);
 }
 
 // --------------------------------------------------------
@@ -323,7 +394,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(const char* bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -335,7 +406,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	// Copy the data and get out
 	deviceContext->UpdateSubresource(
 		cb->ConstantBuffer, 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+		GetLocalData(cb), 0, 0);
+	if (stateCache) stateCache->CountConstantUpload(cb->Size);
 }
 
 
@@ -349,7 +421,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 // Returns true if data is copied, false if variable doesn't 
 // exist or sizes don't match
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(const char* name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, size);
@@ -358,7 +430,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 
 	// Set the data in the local data buffer
 	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
+		GetLocalData(&constantBuffers[var->ConstantBufferIndex]) + var->ByteOffset,
 		data,
 		size);
 
@@ -369,7 +441,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(const char* name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -377,7 +449,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(const char* name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -385,7 +457,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(const char* name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -393,7 +465,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(const char* name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -401,7 +473,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(const char* name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -409,7 +481,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(const char* name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -417,7 +489,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(const char* name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -425,7 +497,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(const char* name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -433,7 +505,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(const char* name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -441,7 +513,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
@@ -449,7 +521,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(const char* name)
 {
 	return FindVariable(name, -1);
 }
@@ -459,11 +531,11 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(const char* name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+		textureTable.find(LookupKey(name));
 
 	// Did we find the key?
 	if (result == textureTable.end())
@@ -494,11 +566,11 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(const char* name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+		samplerTable.find(LookupKey(name));
 
 	// Did we find the key?
 	if (result == samplerTable.end())
@@ -547,7 +619,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(const char* name)
 {
 	return FindConstantBuffer(name);
 }
@@ -754,6 +826,16 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Let the cache skip whatever is already bound
+	if (stateCache)
+	{
+		stateCache->SetInputLayout(inputLayout);
+		stateCache->SetVertexShader(shader);
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+			stateCache->SetConstantBuffer(VertexStage, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
+		return;
+	}
+
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout);
 	deviceContext->VSSetShader(shader, 0, 0);
@@ -776,7 +858,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleVertexShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -784,7 +866,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 		return false;
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	if (stateCache)
+		stateCache->SetShaderResource(VertexStage, srvInfo->BindIndex, srv);
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
 
 	// Success
 	return true;
@@ -798,7 +883,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleVertexShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -806,12 +891,49 @@ bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* s
 		return false;
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache)
+		stateCache->SetSampler(VertexStage, sampInfo->BindIndex, samplerState);
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Records a shader resource view bind in the vertex shader
+// stage, rather than setting it right away
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::RecordShaderResourceView(CommandBuffer& commands, const char* name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo == 0)
+		return false;
+
+	commands.RecordBindShaderResource(VertexStage, srvInfo->BindIndex, srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Records a sampler state bind in the vertex shader stage,
+// rather than setting it right away
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::RecordSamplerState(CommandBuffer& commands, const char* name, ID3D11SamplerState* samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo == 0)
+		return false;
+
+	commands.RecordBindSampler(VertexStage, sampInfo->BindIndex, samplerState);
+	return true;
+}
+
+
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -876,6 +998,15 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Let the cache skip whatever is already bound
+	if (stateCache)
+	{
+		stateCache->SetPixelShader(shader);
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+			stateCache->SetConstantBuffer(PixelStage, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer);
+		return;
+	}
+
 	// Set the shader
 	deviceContext->PSSetShader(shader, 0, 0);
 
@@ -897,7 +1028,7 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimplePixelShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -905,7 +1036,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 		return false;
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	if (stateCache)
+		stateCache->SetShaderResource(PixelStage, srvInfo->BindIndex, srv);
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
 
 	// Success
 	return true;
@@ -919,7 +1053,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimplePixelShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -927,12 +1061,47 @@ bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* sa
 		return false;
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache)
+		stateCache->SetSampler(PixelStage, sampInfo->BindIndex, samplerState);
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Records a shader resource view bind in the pixel shader
+// stage, rather than setting it right away
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::RecordShaderResourceView(CommandBuffer& commands, const char* name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo == 0)
+		return false;
+
+	commands.RecordBindShaderResource(PixelStage, srvInfo->BindIndex, srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Records a sampler state bind in the pixel shader stage,
+// rather than setting it right away
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::RecordSamplerState(CommandBuffer& commands, const char* name, ID3D11SamplerState* samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo == 0)
+		return false;
+
+	commands.RecordBindSampler(PixelStage, sampInfo->BindIndex, samplerState);
+	return true;
+}
+
 
 
 
@@ -1020,7 +1189,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleDomainShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1042,7 +1211,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleDomainShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1142,7 +1311,7 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleHullShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1164,7 +1333,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResou
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleHullShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1386,7 +1555,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleGeometryShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1408,7 +1577,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleGeometryShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1624,7 +1793,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleComputeShader::SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1646,7 +1815,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderRe
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleComputeShader::SetSamplerState(const char* name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1669,7 +1838,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState*
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(const char* name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1686,11 +1855,11 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(const char* name)
 {
 	// Look for the key
 	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+		uavTable.find(LookupKey(name));
 
 	// Did we find the key?
 	if (result == uavTable.end())
@@ -10,6 +10,10 @@
 #include <vector>
 #include <string>
 
+#include "StateCache.h"
+
+class CommandBuffer;
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -32,7 +36,7 @@ struct SimpleConstantBuffer
 	unsigned int Size;
 	unsigned int BindIndex;
 	ID3D11Buffer* ConstantBuffer;
-	unsigned char* LocalDataBuffer;
+	unsigned char* LocalDataBuffer;		// One copy per scratch slot, Size bytes apart
 	std::vector<SimpleShaderVariable> Variables;
 };
 
@@ -43,6 +47,7 @@ struct SimpleSRV
 {
 	unsigned int Index;		// The raw index of the SRV
 	unsigned int BindIndex; // The register of the SRV
+	unsigned int Stride;	// Element size of a structured buffer, else 0
 };
 
 // --------------------------------------------------------
@@ -70,45 +75,57 @@ public:
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
+	// Routes binds through a state cache instead of straight to
+	// the context, so repeated binds are dropped (null to stop)
+	void SetStateCache(StateCache* cache) { stateCache = cache; }
+
+	// Every constant buffer keeps this many copies of its local
+	// data.  Set*() and Copy/Record*() on a thread only touch the
+	// copy it has selected (0 unless told otherwise), so threads
+	// on different slots can record with the same shader at once.
+	static const unsigned int ScratchCount = 8;
+	static void SetThreadScratch(unsigned int index);
+	static unsigned int GetThreadScratch();
+
 	// Activating the shader and copying data
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(const char* bufferName);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const char* name, const void* data, unsigned int size);
+
+	bool SetInt(const char* name, int data);
+	bool SetFloat(const char* name, float data);
+	bool SetFloat2(const char* name, const float data[2]);
+	bool SetFloat2(const char* name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const char* name, const float data[3]);
+	bool SetFloat3(const char* name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const char* name, const float data[4]);
+	bool SetFloat4(const char* name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const char* name, const float data[16]);
+	bool SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4 data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	virtual bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv) = 0;
+	virtual bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState) = 0;
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const char* name);
 
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(const char* name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
 
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(const char* name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	unsigned int GetSamplerCount() { return samplerTable.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(const char* name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 
 	// Misc getters
@@ -120,6 +137,7 @@ protected:
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
+	StateCache* stateCache;
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -139,9 +157,17 @@ protected:
 
 	virtual void CleanUp();
 
+	// Records every constant buffer's local data and bind, or
+	// just the named one's
+	void RecordAllBufferData(CommandBuffer& commands, StateCache::Stage stage);
+	void RecordBufferData(CommandBuffer& commands, StateCache::Stage stage, const char* bufferName);
+
+	// This thread's copy of a constant buffer's local data
+	unsigned char* GetLocalData(const SimpleConstantBuffer* cb);
+
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(const char* name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(const char* name);
 };
 
 // --------------------------------------------------------
@@ -157,8 +183,14 @@ public:
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
+
+	// Same as the above, but into a command buffer instead of the context
+	void RecordBufferData(CommandBuffer& commands) { RecordAllBufferData(commands, VertexStage); }
+	void RecordBufferData(CommandBuffer& commands, const char* bufferName) { ISimpleShader::RecordBufferData(commands, VertexStage, bufferName); }
+	bool RecordShaderResourceView(CommandBuffer& commands, const char* name, ID3D11ShaderResourceView* srv);
+	bool RecordSamplerState(CommandBuffer& commands, const char* name, ID3D11SamplerState* samplerState);
 
 protected:
 	bool perInstanceCompatible;
@@ -180,8 +212,13 @@ public:
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
+
+	// Same as the above, but into a command buffer instead of the context
+	void RecordBufferData(CommandBuffer& commands) { RecordAllBufferData(commands, PixelStage); }
+	bool RecordShaderResourceView(CommandBuffer& commands, const char* name, ID3D11ShaderResourceView* srv);
+	bool RecordSamplerState(CommandBuffer& commands, const char* name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11PixelShader* shader;
@@ -200,8 +237,8 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11DomainShader* shader;
@@ -220,8 +257,8 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11HullShader* shader;
@@ -240,8 +277,8 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
@@ -279,11 +316,11 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(const char* name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const char* name, ID3D11SamplerState* samplerState);
+	bool SetUnorderedAccessView(const char* name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(const char* name);
 
 protected:
 	ID3D11ComputeShader* shader;
@@ -0,0 +1,79 @@
+#include "SphereProjection.h"
+
+#include <cfloat>
+#include <cmath>
+
+// Projected extent of a sphere along one screen axis, working in
+// the 2D plane holding that axis and the view direction.  The
+// extremes are where the lines from the eye touch the circle, or
+// where the near plane cuts it if a touching point is behind the
+// near plane.  After "2D Polyhedral Bounds of a Clipped,
+// Perspective-Projected 3D Sphere" (Mara & McGuire 2013).
+bool ProjectSphereAxis(float c, float cz, float radius, float nearZ, float projScale, float& ndcMin, float& ndcMax)
+{
+	// Entirely behind the near plane
+	if (cz + radius <= nearZ)
+		return false;
+
+	// Eye inside the circle covers the whole axis
+	float tSquared = c * c + cz * cz - radius * radius;
+	if (tSquared <= 0.0f)
+	{
+		ndcMin = -1.0f;
+		ndcMax = 1.0f;
+		return true;
+	}
+
+	float lowest = FLT_MAX;
+	float highest = -FLT_MAX;
+
+	// The two tangent points, kept if they're past the near plane
+	float t = sqrtf(tSquared);
+	float invLengthSq = 1.0f / (c * c + cz * cz);
+	for (int side = -1; side <= 1; side += 2)
+	{
+		float x = (t * c - side * radius * cz) * t * invLengthSq;
+		float z = (t * cz + side * radius * c) * t * invLengthSq;
+		if (z < nearZ)
+			continue;
+
+		float projected = x / z;
+		lowest = projected < lowest ? projected : lowest;
+		highest = projected > highest ? projected : highest;
+	}
+
+	// Where the near plane cuts the circle, if it does
+	float toNear = nearZ - cz;
+	if (toNear * toNear < radius * radius)
+	{
+		float k = sqrtf(radius * radius - toNear * toNear);
+		lowest = fminf(lowest, (c - k) / nearZ);
+		highest = fmaxf(highest, (c + k) / nearZ);
+	}
+
+	ndcMin = lowest * projScale;
+	ndcMax = highest * projScale;
+	return lowest <= highest;
+}
+
+bool ProjectSphere(float centerX, float centerY, float centerZ, float radius, float projScaleX, float projScaleY,
+	float nearZ, float screenWidth, float screenHeight, ScreenRect& rect)
+{
+	float minX, maxX, minY, maxY;
+	if (!ProjectSphereAxis(centerX, centerZ, radius, nearZ, projScaleX, minX, maxX) ||
+		!ProjectSphereAxis(centerY, centerZ, radius, nearZ, projScaleY, minY, maxY))
+		return false;
+
+	// Clip to the screen
+	minX = fmaxf(minX, -1.0f); maxX = fminf(maxX, 1.0f);
+	minY = fmaxf(minY, -1.0f); maxY = fminf(maxY, 1.0f);
+	if (minX >= maxX || minY >= maxY)
+		return false;
+
+	// NDC y points up, pixels count down
+	rect.left = (minX * 0.5f + 0.5f) * screenWidth;
+	rect.top = (0.5f - maxY * 0.5f) * screenHeight;
+	rect.right = (maxX * 0.5f + 0.5f) * screenWidth;
+	rect.bottom = (0.5f - minY * 0.5f) * screenHeight;
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// --------------------------------------------------------
+// Screen bounds of a perspective projected sphere
+//
+// Plain floats in and out - nothing here depends on the
+// camera, DirectXMath or the device, so it's tested headless.
+// Spheres are given in view space (left handed, +z forward).
+// --------------------------------------------------------
+
+// Pixels, with y counting down from the top of the screen
+struct ScreenRect
+{
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+// Projected extent of a sphere along one screen axis, given the
+// center's coordinate on that axis (c) and its view depth (cz).
+// projScale is the projection matrix's _11 or _22.  Returns false
+// if the sphere is entirely behind the near plane; the extent is
+// in NDC and not clipped to the screen.
+bool ProjectSphereAxis(float c, float cz, float radius, float nearZ, float projScale, float& ndcMin, float& ndcMax);
+
+// Tight screen rectangle of a view space sphere, clipped by the
+// near plane and the screen edges.  Returns false if no part of
+// the sphere lands on screen.
+bool ProjectSphere(float centerX, float centerY, float centerZ, float radius, float projScaleX, float projScaleY,
+	float nearZ, float screenWidth, float screenHeight, ScreenRect& rect);
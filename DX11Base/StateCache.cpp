@@ -0,0 +1,262 @@
+#include "StateCache.h"
+
+#include <cstring>
+
+StateCache::StateCache(Target* target)
+{
+	this->target = target;
+	issued = 0;
+	filtered = 0;
+	constantBytes = 0;
+	Invalidate();
+}
+
+void StateCache::Invalidate()
+{
+	inputLayout.known = false;
+	vertexShader.known = false;
+	pixelShader.known = false;
+	for (unsigned int stage = 0; stage < StageCount; stage++)
+	{
+		for (unsigned int slot = 0; slot < SlotCount; slot++)
+		{
+			constantBuffers[stage][slot].known = false;
+			shaderResources[stage][slot].known = false;
+			samplers[stage][slot].known = false;
+		}
+	}
+	for (unsigned int slot = 0; slot < VertexBufferSlots; slot++)
+		vertexBuffers[slot].known = false;
+	indexBuffer.known = false;
+	topology.known = false;
+	rasterizerState.known = false;
+	blendState.known = false;
+	depthStencilState.known = false;
+}
+
+template <typename T>
+bool StateCache::Update(Binding<T>& binding, const T& value)
+{
+	if (binding.known && binding.value == value)
+	{
+		filtered++;
+		return false;
+	}
+
+	binding.value = value;
+	binding.known = true;
+	issued++;
+	return true;
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (Update(inputLayout, layout))
+		target->SetInputLayout(layout);
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (Update(vertexShader, shader))
+		target->SetVertexShader(shader);
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (Update(pixelShader, shader))
+		target->SetPixelShader(shader);
+}
+
+void StateCache::SetConstantBuffer(Stage stage, unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (slot >= SlotCount)
+	{
+		issued++;
+		target->SetConstantBuffer(stage, slot, buffer);
+	}
+	else if (Update(constantBuffers[stage][slot], buffer))
+	{
+		target->SetConstantBuffer(stage, slot, buffer);
+	}
+}
+
+void StateCache::SetShaderResource(Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (slot >= SlotCount)
+	{
+		issued++;
+		target->SetShaderResource(stage, slot, srv);
+	}
+	else if (Update(shaderResources[stage][slot], srv))
+	{
+		target->SetShaderResource(stage, slot, srv);
+	}
+}
+
+void StateCache::SetSampler(Stage stage, unsigned int slot, ID3D11SamplerState* sampler)
+{
+	if (slot >= SlotCount)
+	{
+		issued++;
+		target->SetSampler(stage, slot, sampler);
+	}
+	else if (Update(samplers[stage][slot], sampler))
+	{
+		target->SetSampler(stage, slot, sampler);
+	}
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	VertexBufferBinding binding = { buffer, stride, offset };
+	if (slot >= VertexBufferSlots)
+	{
+		issued++;
+		target->SetVertexBuffer(slot, buffer, stride, offset);
+	}
+	else if (Update(vertexBuffers[slot], binding))
+	{
+		target->SetVertexBuffer(slot, buffer, stride, offset);
+	}
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	IndexBufferBinding binding = { buffer, format, offset };
+	if (Update(indexBuffer, binding))
+		target->SetIndexBuffer(buffer, format, offset);
+}
+
+void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Update(this->topology, topology))
+		target->SetPrimitiveTopology(topology);
+}
+
+void StateCache::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	if (Update(rasterizerState, state))
+		target->SetRasterizerState(state);
+}
+
+void StateCache::SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask)
+{
+	// A null factor means all ones to D3D, so store it that way
+	BlendBinding binding = { state, { 1.0f, 1.0f, 1.0f, 1.0f }, sampleMask };
+	if (blendFactor)
+		memcpy(binding.factor, blendFactor, sizeof(binding.factor));
+
+	if (Update(blendState, binding))
+		target->SetBlendState(state, blendFactor, sampleMask);
+}
+
+void StateCache::SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	DepthStencilBinding binding = { state, stencilRef };
+	if (Update(depthStencilState, binding))
+		target->SetDepthStencilState(state, stencilRef);
+}
+
+void StateCache::SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth)
+{
+	issued++;
+	target->SetRenderTargets(count, targets, depth);
+
+	// Any SRV of a resource just bound for output was unbound
+	for (unsigned int stage = 0; stage < StageCount; stage++)
+	{
+		for (unsigned int slot = 0; slot < SlotCount; slot++)
+			shaderResources[stage][slot].known = false;
+	}
+}
+
+// --------------------------------------------------------
+// Real context target
+// --------------------------------------------------------
+void ContextStateTarget::SetInputLayout(ID3D11InputLayout* layout)
+{
+	context->IASetInputLayout(layout);
+}
+
+void ContextStateTarget::SetVertexShader(ID3D11VertexShader* shader)
+{
+	context->VSSetShader(shader, 0, 0);
+}
+
+void ContextStateTarget::SetPixelShader(ID3D11PixelShader* shader)
+{
+	context->PSSetShader(shader, 0, 0);
+}
+
+void ContextStateTarget::SetConstantBuffer(StateCache::Stage stage, unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (stage == VertexStage)
+		context->VSSetConstantBuffers(slot, 1, &buffer);
+	else
+		context->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void ContextStateTarget::SetShaderResource(StateCache::Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (stage == VertexStage)
+		context->VSSetShaderResources(slot, 1, &srv);
+	else
+		context->PSSetShaderResources(slot, 1, &srv);
+}
+
+void ContextStateTarget::SetSampler(StateCache::Stage stage, unsigned int slot, ID3D11SamplerState* sampler)
+{
+	if (stage == VertexStage)
+		context->VSSetSamplers(slot, 1, &sampler);
+	else
+		context->PSSetSamplers(slot, 1, &sampler);
+}
+
+void ContextStateTarget::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void ContextStateTarget::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void ContextStateTarget::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	context->IASetPrimitiveTopology(topology);
+}
+
+void ContextStateTarget::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	context->RSSetState(state);
+}
+
+void ContextStateTarget::SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask)
+{
+	context->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+void ContextStateTarget::SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void ContextStateTarget::SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth)
+{
+	context->OMSetRenderTargets(count, targets, depth);
+}
+
+// --------------------------------------------------------
+// Recording target
+// --------------------------------------------------------
+unsigned int RecordingStateTarget::CountCalls(CallType type) const
+{
+	unsigned int count = 0;
+	for (auto& call : calls)
+	{
+		if (call.type == type)
+			count++;
+	}
+	return count;
+}
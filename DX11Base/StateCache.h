@@ -0,0 +1,240 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+#include "ShaderStage.h"
+
+// --------------------------------------------------------
+// Redundant state filtering in front of a device context
+//
+// Remembers what is currently bound - shaders, constant
+// buffers, SRVs, samplers, IA buffers and the fixed function
+// states - and drops any call that would bind the same thing
+// again.  Everything that gets through goes to a Target, which
+// is normally the real context, or a recording fake so the
+// filtering can be checked without a GPU.
+//
+// Anything that binds state behind the cache's back must call
+// Invalidate() afterwards, so the next call of each kind goes
+// through.  SetRenderTargets() forgets the bound SRVs itself,
+// since the runtime silently unbinds any that alias a target.
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	typedef ShaderStage Stage;
+	static const unsigned int StageCount = ShaderStageCount;
+
+	static const unsigned int SlotCount = 16;	// Slots tracked per stage - higher ones always go through
+	static const unsigned int VertexBufferSlots = 2;
+
+	// Receives the calls that survive filtering
+	class Target
+	{
+	public:
+		virtual ~Target() {}
+		virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+		virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+		virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+		virtual void SetConstantBuffer(Stage stage, unsigned int slot, ID3D11Buffer* buffer) = 0;
+		virtual void SetShaderResource(Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv) = 0;
+		virtual void SetSampler(Stage stage, unsigned int slot, ID3D11SamplerState* sampler) = 0;
+		virtual void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset) = 0;
+		virtual void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+		virtual void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+		virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+		virtual void SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask) = 0;
+		virtual void SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) = 0;
+		virtual void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) = 0;
+	};
+
+	StateCache(Target* target);
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetConstantBuffer(Stage stage, unsigned int slot, ID3D11Buffer* buffer);
+	void SetShaderResource(Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv);
+	void SetSampler(Stage stage, unsigned int slot, ID3D11SamplerState* sampler);
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+
+	// Never filtered, but unbinds SRVs the same way the runtime does
+	void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth);
+
+	// Forgets everything - the next call of each kind goes through
+	void Invalidate();
+
+	// Uploads aren't state and are never filtered, but whoever
+	// makes them through this cache's context reports the bytes
+	void CountConstantUpload(unsigned int bytes) { constantBytes += bytes; }
+
+	// Calls passed on and dropped, and constant bytes uploaded,
+	// since the last ResetStats()
+	unsigned int GetIssuedCount() const { return issued; }
+	unsigned int GetFilteredCount() const { return filtered; }
+	unsigned int GetConstantBytes() const { return constantBytes; }
+	void ResetStats() { issued = 0; filtered = 0; constantBytes = 0; }
+
+private:
+	// A bound value, and whether it's actually known
+	template <typename T>
+	struct Binding
+	{
+		T value;
+		bool known;
+	};
+
+	struct VertexBufferBinding
+	{
+		ID3D11Buffer* buffer;
+		UINT stride;
+		UINT offset;
+
+		bool operator==(const VertexBufferBinding& other) const { return buffer == other.buffer && stride == other.stride && offset == other.offset; }
+	};
+
+	struct IndexBufferBinding
+	{
+		ID3D11Buffer* buffer;
+		DXGI_FORMAT format;
+		UINT offset;
+
+		bool operator==(const IndexBufferBinding& other) const { return buffer == other.buffer && format == other.format && offset == other.offset; }
+	};
+
+	struct BlendBinding
+	{
+		ID3D11BlendState* state;
+		float factor[4];
+		UINT sampleMask;
+
+		bool operator==(const BlendBinding& other) const
+		{
+			return state == other.state && sampleMask == other.sampleMask &&
+				factor[0] == other.factor[0] && factor[1] == other.factor[1] && factor[2] == other.factor[2] && factor[3] == other.factor[3];
+		}
+	};
+
+	struct DepthStencilBinding
+	{
+		ID3D11DepthStencilState* state;
+		UINT stencilRef;
+
+		bool operator==(const DepthStencilBinding& other) const { return state == other.state && stencilRef == other.stencilRef; }
+	};
+
+	Target* target;
+	unsigned int issued;
+	unsigned int filtered;
+	unsigned int constantBytes;
+
+	Binding<ID3D11InputLayout*> inputLayout;
+	Binding<ID3D11VertexShader*> vertexShader;
+	Binding<ID3D11PixelShader*> pixelShader;
+	Binding<ID3D11Buffer*> constantBuffers[StageCount][SlotCount];
+	Binding<ID3D11ShaderResourceView*> shaderResources[StageCount][SlotCount];
+	Binding<ID3D11SamplerState*> samplers[StageCount][SlotCount];
+	Binding<VertexBufferBinding> vertexBuffers[VertexBufferSlots];
+	Binding<IndexBufferBinding> indexBuffer;
+	Binding<D3D11_PRIMITIVE_TOPOLOGY> topology;
+	Binding<ID3D11RasterizerState*> rasterizerState;
+	Binding<BlendBinding> blendState;
+	Binding<DepthStencilBinding> depthStencilState;
+
+	// True if the call should go through, updating the binding
+	template <typename T>
+	bool Update(Binding<T>& binding, const T& value);
+};
+
+// --------------------------------------------------------
+// Passes filtered calls on to a real device context
+// --------------------------------------------------------
+class ContextStateTarget : public StateCache::Target
+{
+public:
+	ContextStateTarget(ID3D11DeviceContext* context = 0) { this->context = context; }
+	void SetContext(ID3D11DeviceContext* context) { this->context = context; }
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetConstantBuffer(StateCache::Stage stage, unsigned int slot, ID3D11Buffer* buffer);
+	void SetShaderResource(StateCache::Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv);
+	void SetSampler(StateCache::Stage stage, unsigned int slot, ID3D11SamplerState* sampler);
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+	void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth);
+
+private:
+	ID3D11DeviceContext* context;
+};
+
+// --------------------------------------------------------
+// Fake context that only writes down what reached it, for
+// checking the filtering without a device
+// --------------------------------------------------------
+class RecordingStateTarget : public StateCache::Target
+{
+public:
+	enum CallType
+	{
+		InputLayoutCall,
+		VertexShaderCall,
+		PixelShaderCall,
+		ConstantBufferCall,
+		ShaderResourceCall,
+		SamplerCall,
+		VertexBufferCall,
+		IndexBufferCall,
+		TopologyCall,
+		RasterizerCall,
+		BlendCall,
+		DepthStencilCall,
+		RenderTargetsCall
+	};
+
+	struct Call
+	{
+		CallType type;
+		unsigned int stage;
+		unsigned int slot;
+		const void* object;		// Whatever was bound, if anything
+	};
+
+	const std::vector<Call>& GetCalls() const { return calls; }
+	unsigned int CountCalls(CallType type) const;
+	void Clear() { calls.clear(); }
+
+	void SetInputLayout(ID3D11InputLayout* layout) { Record(InputLayoutCall, 0, 0, layout); }
+	void SetVertexShader(ID3D11VertexShader* shader) { Record(VertexShaderCall, 0, 0, shader); }
+	void SetPixelShader(ID3D11PixelShader* shader) { Record(PixelShaderCall, 0, 0, shader); }
+	void SetConstantBuffer(StateCache::Stage stage, unsigned int slot, ID3D11Buffer* buffer) { Record(ConstantBufferCall, stage, slot, buffer); }
+	void SetShaderResource(StateCache::Stage stage, unsigned int slot, ID3D11ShaderResourceView* srv) { Record(ShaderResourceCall, stage, slot, srv); }
+	void SetSampler(StateCache::Stage stage, unsigned int slot, ID3D11SamplerState* sampler) { Record(SamplerCall, stage, slot, sampler); }
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, UINT stride, UINT offset) { Record(VertexBufferCall, 0, slot, buffer); }
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) { Record(IndexBufferCall, 0, 0, buffer); }
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) { Record(TopologyCall, 0, (unsigned int)topology, 0); }
+	void SetRasterizerState(ID3D11RasterizerState* state) { Record(RasterizerCall, 0, 0, state); }
+	void SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask) { Record(BlendCall, 0, 0, state); }
+	void SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) { Record(DepthStencilCall, 0, stencilRef, state); }
+	void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) { Record(RenderTargetsCall, 0, count, depth); }
+
+private:
+	std::vector<Call> calls;
+
+	void Record(CallType type, unsigned int stage, unsigned int slot, const void* object)
+	{
+		Call call = { type, stage, slot, object };
+		calls.push_back(call);
+	}
+};
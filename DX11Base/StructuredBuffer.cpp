@@ -0,0 +1,87 @@
+#include "StructuredBuffer.h"
+
+#include <cstring>
+
+StructuredBuffer::StructuredBuffer()
+{
+	device = 0;
+	buffer = 0;
+	srv = 0;
+	stride = 0;
+	capacity = 0;
+	count = 0;
+}
+
+StructuredBuffer::~StructuredBuffer()
+{
+	Release();
+}
+
+bool StructuredBuffer::Init(ID3D11Device* device, unsigned int stride, unsigned int initialCapacity)
+{
+	this->device = device;
+	this->stride = stride;
+	count = 0;
+	return Create(initialCapacity > 0 ? initialCapacity : 1);
+}
+
+void StructuredBuffer::Release()
+{
+	if (srv) { srv->Release(); srv = 0; }
+	if (buffer) { buffer->Release(); buffer = 0; }
+	capacity = 0;
+}
+
+bool StructuredBuffer::Create(unsigned int newCapacity)
+{
+	Release();
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = stride * newCapacity;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = stride;
+	if (FAILED(device->CreateBuffer(&bufferDesc, 0, &buffer)))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = newCapacity;
+	if (FAILED(device->CreateShaderResourceView(buffer, &srvDesc, &srv)))
+	{
+		Release();
+		return false;
+	}
+
+	capacity = newCapacity;
+	return true;
+}
+
+bool StructuredBuffer::Upload(ID3D11DeviceContext* context, const void* data, unsigned int count)
+{
+	if (count > capacity)
+	{
+		unsigned int newCapacity = capacity * 2 > count ? capacity * 2 : count;
+		if (!Create(newCapacity))
+		{
+			this->count = 0;
+			return false;
+		}
+	}
+
+	this->count = count;
+	if (count == 0)
+		return true;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+
+	memcpy(mapped.pData, data, stride * count);
+	context->Unmap(buffer, 0);
+	return true;
+}
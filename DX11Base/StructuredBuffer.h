@@ -0,0 +1,44 @@
+#pragma once
+
+#include <d3d11.h>
+
+// --------------------------------------------------------
+// Dynamic StructuredBuffer the CPU refills when its list changes
+//
+// Upload() writes the whole list with one Map/discard, so the
+// driver renames the buffer instead of stalling on a GPU still
+// reading last frame's copy.  When a list outgrows the buffer
+// it's recreated (with its view) at twice the size, so a list
+// that keeps growing only costs a handful of reallocations.
+//
+// The element struct must match the HLSL one byte for byte -
+// structured buffers aren't packed like constant buffers, but
+// keeping the structs in 16 byte rows avoids any surprises.
+// --------------------------------------------------------
+class StructuredBuffer
+{
+public:
+	StructuredBuffer();
+	~StructuredBuffer();
+
+	// stride is the size of one element
+	bool Init(ID3D11Device* device, unsigned int stride, unsigned int initialCapacity = 64);
+	void Release();
+
+	// Replaces the contents with count elements of data
+	bool Upload(ID3D11DeviceContext* context, const void* data, unsigned int count);
+
+	ID3D11ShaderResourceView* GetSRV() { return srv; }
+	unsigned int GetCount() const { return count; }
+	unsigned int GetCapacity() const { return capacity; }
+
+private:
+	ID3D11Device* device;
+	ID3D11Buffer* buffer;
+	ID3D11ShaderResourceView* srv;
+	unsigned int stride;
+	unsigned int capacity;
+	unsigned int count;
+
+	bool Create(unsigned int newCapacity);
+};
@@ -0,0 +1,122 @@
+#include "Test.h"
+#include "../CommandBuffer.h"
+
+#include <cstdint>
+
+// Stand-ins for device objects - nothing here looks through them
+template <typename T>
+static T* Fake(uintptr_t address)
+{
+	return (T*)address;
+}
+
+static void RecordsInOrder()
+{
+	LinearArena arena;
+	CommandBuffer commands(&arena);
+	CHECK(commands.IsEmpty());
+
+	commands.RecordBindPipeline(Fake<ID3D11InputLayout>(0x10), Fake<ID3D11VertexShader>(0x20), 0, 4);
+	commands.RecordBindVertexBuffer(0, Fake<ID3D11Buffer>(0x30), 48, 0);
+	commands.RecordBindIndexBuffer(Fake<ID3D11Buffer>(0x40), 42, 0);
+	commands.RecordBindShaderResource(PixelStage, 3, Fake<ID3D11ShaderResourceView>(0x50));
+	commands.RecordDrawIndexed(36, 0, 0);
+	CHECK(commands.GetCount() == 5);
+
+	const CommandBuffer::Command* command = commands.GetFirst();
+	CHECK(command->type == CommandBuffer::BindPipelineCommand);
+	CHECK(static_cast<const CommandBuffer::BindPipeline*>(command)->pixelShader == 0);
+	command = command->next;
+	CHECK(command->type == CommandBuffer::BindVertexBufferCommand);
+	CHECK(static_cast<const CommandBuffer::BindVertexBuffer*>(command)->stride == 48);
+	command = command->next;
+	CHECK(command->type == CommandBuffer::BindIndexBufferCommand);
+	command = command->next;
+	CHECK(command->type == CommandBuffer::BindShaderResourceCommand);
+	const CommandBuffer::BindResource<ID3D11ShaderResourceView>* bind = static_cast<const CommandBuffer::BindResource<ID3D11ShaderResourceView>*>(command);
+	CHECK(bind->stage == PixelStage && bind->slot == 3);
+	command = command->next;
+	CHECK(command->type == CommandBuffer::DrawIndexedCommand);
+	CHECK(command->next == 0);
+
+	commands.Clear();
+	CHECK(commands.IsEmpty() && commands.GetFirst() == 0);
+}
+
+static void CopiesConstantData()
+{
+	LinearArena arena;
+	CommandBuffer commands(&arena);
+
+	// Changing the caller's copy afterwards mustn't reach the command
+	float constants[4] = { 1, 2, 3, 4 };
+	commands.RecordUpdateConstantBuffer(Fake<ID3D11Buffer>(0x10), constants, sizeof(constants));
+	constants[0] = 99;
+
+	const CommandBuffer::UpdateConstantBuffer* update = static_cast<const CommandBuffer::UpdateConstantBuffer*>(commands.GetFirst());
+	CHECK(update->size == sizeof(constants));
+	CHECK(((const float*)update->data)[0] == 1.0f);
+	CHECK(((const float*)update->data)[3] == 4.0f);
+
+	// The fill-in-later form hands back the command's own bytes
+	float* filled = (float*)commands.RecordUpdateConstantBuffer(Fake<ID3D11Buffer>(0x10), 16);
+	filled[0] = 5;
+	update = static_cast<const CommandBuffer::UpdateConstantBuffer*>(update->next);
+	CHECK(((const float*)update->data)[0] == 5.0f);
+}
+
+static void KeepsOrderAcrossArenaSpills()
+{
+	// Far more than the block holds, so most land in overflow blocks
+	LinearArena arena(256);
+	CommandBuffer commands(&arena);
+	const unsigned int drawCount = 1000;
+	for (unsigned int i = 0; i < drawCount; i++)
+		commands.RecordDraw(3, i * 3);
+	CHECK(arena.GetOverflowCount() > 0);
+	CHECK(commands.GetCount() == drawCount);
+
+	unsigned int expected = 0;
+	for (const CommandBuffer::Command* command = commands.GetFirst(); command; command = command->next)
+	{
+		if (static_cast<const CommandBuffer::Draw*>(command)->startVertex != expected * 3)
+			break;
+		expected++;
+	}
+	CHECK(expected == drawCount);
+}
+
+static void NullBackendCounts()
+{
+	LinearArena arena;
+	CommandBuffer commands(&arena);
+	unsigned char constants[64] = {};
+	commands.RecordBindSampler(PixelStage, 0, Fake<ID3D11SamplerState>(0x10));
+	commands.RecordBindConstantBuffer(VertexStage, 0, Fake<ID3D11Buffer>(0x20));
+	commands.RecordUpdateConstantBuffer(Fake<ID3D11Buffer>(0x20), constants, sizeof(constants));
+	commands.RecordDraw(3, 0);
+	commands.RecordDrawIndexed(36, 0, 0);
+	commands.RecordDrawIndexedInstanced(36, 10, 0, 0, 0);
+
+	NullCommandBackend backend;
+	backend.Execute(commands);
+	CHECK(backend.GetCommandCount(CommandBuffer::BindSamplerCommand) == 1);
+	CHECK(backend.GetCommandCount(CommandBuffer::BindConstantBufferCommand) == 1);
+	CHECK(backend.GetDrawCount() == 3);
+	CHECK(backend.GetPrimitiveVertexCount() == 3 + 36 + 360);
+	CHECK(backend.GetConstantBytes() == sizeof(constants));
+
+	// Counts add up across buffers until reset
+	backend.Execute(commands);
+	CHECK(backend.GetDrawCount() == 6);
+	backend.Reset();
+	CHECK(backend.GetDrawCount() == 0 && backend.GetConstantBytes() == 0);
+}
+
+void RunCommandBufferTests()
+{
+	RecordsInOrder();
+	CopiesConstantData();
+	KeepsOrderAcrossArenaSpills();
+	NullBackendCounts();
+}
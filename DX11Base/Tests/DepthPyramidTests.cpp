@@ -0,0 +1,170 @@
+#include "Test.h"
+#include "../DepthPyramid.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Made up depth - a 6x6 wall facing the camera at z = 5, with
+// nothing anywhere else
+static const float WallZ = 5.0f;
+static const float WallHalfSize = 3.0f;
+
+static void RenderWall(FXMMATRIX viewProjection, unsigned int width, unsigned int height, std::vector<float>& depth)
+{
+	depth.assign(width * height, 1.0f);
+	XMMATRIX inverse = XMMatrixInverse(0, viewProjection);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			// Where this pixel's ray crosses the wall's plane, if it does
+			float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+			float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+			XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0, 1), inverse);
+			XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1, 1), inverse);
+			float nearZ = XMVectorGetZ(nearPoint);
+			float farZ = XMVectorGetZ(farPoint);
+			if ((nearZ - WallZ) * (farZ - WallZ) > 0)
+				continue;
+
+			XMVECTOR hit = XMVectorLerp(nearPoint, farPoint, (WallZ - nearZ) / (farZ - nearZ));
+			if (fabsf(XMVectorGetX(hit)) > WallHalfSize || fabsf(XMVectorGetY(hit)) > WallHalfSize)
+				continue;
+
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(XMVectorSetW(hit, 1), viewProjection));
+			depth[y * width + x] = clip.z / clip.w;
+		}
+	}
+}
+
+static bool IsVisible(const DepthPyramid& pyramid, float x, float y, float z, float radius)
+{
+	return pyramid.IsVisible(XMFLOAT3(x - radius, y - radius, z - radius), XMFLOAT3(x + radius, y + radius, z + radius));
+}
+
+// Both cameras look down +z at the wall, the current one
+// slightly moved and turned from the previous one
+struct WallCameras
+{
+	static const unsigned int width = 160;
+	static const unsigned int height = 90;
+	XMMATRIX previous;
+	XMMATRIX current;
+	std::vector<float> previousDepth;
+	std::vector<float> currentDepth;
+
+	WallCameras()
+	{
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(0.785f, 16.0f / 9.0f, 0.1f, 100.0f);
+		XMVECTOR up = XMVectorSet(0, 1, 0, 0);
+		previous = XMMatrixMultiply(XMMatrixLookToLH(XMVectorSet(0, 0, 0, 0), XMVectorSet(0, 0, 1, 0), up), projection);
+		current = XMMatrixMultiply(XMMatrixLookToLH(XMVectorSet(0.3f, 0.1f, 0.5f, 0), XMVectorSet(0.05f, 0, 1, 0), up), projection);
+		RenderWall(previous, width, height, previousDepth);
+		RenderWall(current, width, height, currentDepth);
+	}
+};
+
+// Reprojecting to the same camera changes nothing
+static void UnmovedReprojectionMatchesBuild()
+{
+	WallCameras cameras;
+	DepthPyramid built, unmoved;
+	built.Build(&cameras.currentDepth[0], cameras.width, cameras.height, cameras.current);
+	unmoved.Reproject(&cameras.currentDepth[0], cameras.width, cameras.height, cameras.current, cameras.current);
+
+	unsigned int differences = 0;
+	for (unsigned int y = 0; y < cameras.height; y++)
+	{
+		for (unsigned int x = 0; x < cameras.width; x++)
+		{
+			if (fabsf(unmoved.GetDepth(0, x, y) - built.GetDepth(0, x, y)) > 1e-5f)
+				differences++;
+		}
+	}
+	CHECK(differences == 0);
+}
+
+// Reprojected depth may leave holes, but is never nearer than
+// the truth, and every level keeps the farthest of the four
+// below it
+static void ReprojectionIsConservative()
+{
+	WallCameras cameras;
+	DepthPyramid reprojected;
+	reprojected.Reproject(&cameras.previousDepth[0], cameras.width, cameras.height, cameras.previous, cameras.current);
+
+	unsigned int nearer = 0;
+	for (unsigned int i = 0; i < cameras.width * cameras.height; i++)
+	{
+		if (reprojected.GetDepth(0, i % cameras.width, i / cameras.width) < cameras.currentDepth[i] - 1e-4f)
+			nearer++;
+	}
+	CHECK(nearer == 0);
+
+	for (unsigned int level = 1; level < reprojected.GetLevelCount(); level++)
+	{
+		bool farthest = true;
+		for (unsigned int y = 0; y < reprojected.GetHeight(level - 1); y++)
+		{
+			for (unsigned int x = 0; x < reprojected.GetWidth(level - 1); x++)
+				farthest = farthest && reprojected.GetDepth(level, x / 2, y / 2) >= reprojected.GetDepth(level - 1, x, y);
+		}
+		CHECK(farthest);
+	}
+}
+
+// Both pyramids hide what's behind the wall and nothing else
+static void HidesBehindWall()
+{
+	WallCameras cameras;
+	DepthPyramid built, reprojected;
+	built.Build(&cameras.currentDepth[0], cameras.width, cameras.height, cameras.current);
+	reprojected.Reproject(&cameras.previousDepth[0], cameras.width, cameras.height, cameras.previous, cameras.current);
+
+	const DepthPyramid* pyramids[2] = { &built, &reprojected };
+	for (const DepthPyramid* pyramid : pyramids)
+	{
+		CHECK(!IsVisible(*pyramid, 0.0f, 0.0f, 10.0f, 0.5f));		// Right behind the wall
+		CHECK(!IsVisible(*pyramid, 0.5f, 0.5f, 9.0f, 0.7f));
+		CHECK(IsVisible(*pyramid, 0.0f, 0.0f, 4.0f, 0.5f));		// In front of it
+		CHECK(IsVisible(*pyramid, 5.0f, 0.0f, 10.0f, 0.5f));		// Off to the side
+		CHECK(IsVisible(*pyramid, 5.0f, 0.0f, 10.0f, 1.5f));
+	}
+
+	// Random boxes: anything culled must really be hidden
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> spread(-2.5f, 2.5f), distance(6.0f, 16.0f), size(0.1f, 0.6f);
+	unsigned int hidden = 0, wronglyCulled = 0;
+	XMFLOAT3 eye(0.3f, 0.1f, 0.5f);
+	for (int i = 0; i < 2000; i++)
+	{
+		float x = spread(rng), y = spread(rng), z = distance(rng), radius = size(rng);
+
+		// Hidden if the line from the eye to every corner crosses the wall
+		bool behindWall = true;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			float cx = (corner & 1 ? x + radius : x - radius) - eye.x;
+			float cy = (corner & 2 ? y + radius : y - radius) - eye.y;
+			float cz = (corner & 4 ? z + radius : z - radius) - eye.z;
+			float t = (WallZ - eye.z) / cz;
+			if (fabsf(eye.x + cx * t) > WallHalfSize || fabsf(eye.y + cy * t) > WallHalfSize)
+				behindWall = false;
+		}
+
+		hidden += behindWall ? 1 : 0;
+		if (!behindWall && (!IsVisible(built, x, y, z, radius) || !IsVisible(reprojected, x, y, z, radius)))
+			wronglyCulled++;
+	}
+	CHECK(hidden > 0);
+	CHECK(wronglyCulled == 0);
+}
+
+void RunDepthPyramidTests()
+{
+	UnmovedReprojectionMatchesBuild();
+	ReprojectionIsConservative();
+	HidesBehindWall();
+}
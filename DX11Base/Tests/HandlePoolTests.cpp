@@ -0,0 +1,108 @@
+#include "Test.h"
+#include "../HandlePool.h"
+
+struct Thing
+{
+	int value;
+	Thing(int value) : value(value) { }
+};
+
+static void RejectsStaleHandle()
+{
+	HandlePool<Thing> pool(4);
+	Handle<Thing> handle = pool.Create(7);
+	CHECK(!handle.IsNull());
+	CHECK(pool.Get(handle) && pool.Get(handle)->value == 7);
+
+	CHECK(pool.Destroy(handle));
+	CHECK(!pool.IsValid(handle));
+	CHECK(pool.Get(handle) == 0);
+	CHECK(!pool.Destroy(handle));
+	CHECK(pool.GetCount() == 0);
+
+	// Null handles are never valid either
+	CHECK(!pool.IsValid(Handle<Thing>()));
+	CHECK(pool.Get(Handle<Thing>()) == 0);
+}
+
+// The freed slot comes straight back off the free list, with a
+// new generation so the old handle still doesn't match
+static void ReusesSlotWithNewGeneration()
+{
+	HandlePool<Thing> pool(4);
+	Handle<Thing> first = pool.Create(1);
+	Handle<Thing> kept = pool.Create(2);
+	pool.Destroy(first);
+
+	Handle<Thing> second = pool.Create(3);
+	CHECK(second.GetIndex() == first.GetIndex());
+	CHECK(second.GetGeneration() == first.GetGeneration() + 1);
+	CHECK(second != first);
+	CHECK(!pool.IsValid(first));
+	CHECK(pool.Get(second)->value == 3);
+	CHECK(pool.Get(kept)->value == 2);
+
+	// Full pools hand out null handles
+	pool.Create(4);
+	pool.Create(5);
+	CHECK(pool.Create(6).IsNull());
+	CHECK(pool.GetCount() == 4);
+}
+
+// After 4095 reuses the generation wraps past zero (which would
+// be a null handle) back to 1
+static void GenerationWrapsPastZero()
+{
+	HandlePool<Thing> pool(2);
+	Handle<Thing> neighbour = pool.Create(-1);
+	Handle<Thing> handle = pool.Create(0);
+	Handle<Thing> previous;
+
+	bool everNull = false, everAliased = false, staleAccepted = false;
+	for (unsigned int i = 0; i < Handle<Thing>::GenerationMask; i++)
+	{
+		previous = handle;
+		pool.Destroy(handle);
+		handle = pool.Create((int)i);
+
+		everNull = everNull || handle.IsNull() || handle.GetGeneration() == 0;
+		everAliased = everAliased || handle == neighbour;
+		staleAccepted = staleAccepted || pool.IsValid(previous);
+	}
+	CHECK(!everNull);
+	CHECK(!everAliased);
+	CHECK(!staleAccepted);
+
+	CHECK(previous.GetGeneration() == Handle<Thing>::GenerationMask);
+	CHECK(handle.GetGeneration() == 1);
+	CHECK(pool.Get(handle)->value == (int)Handle<Thing>::GenerationMask - 1);
+	CHECK(pool.Get(neighbour)->value == -1);
+}
+
+static void SlotsRoundTrip()
+{
+	HandlePool<Thing> pool(8);
+	Handle<Thing> handles[5];
+	for (int i = 0; i < 5; i++)
+		handles[i] = pool.Create(i * 10);
+	pool.Destroy(handles[1]);
+
+	CHECK(pool.GetSlotRange() == 5);
+	CHECK(pool.GetBySlot(handles[1].GetIndex()) == 0);
+	for (int i = 0; i < 5; i++)
+	{
+		if (i == 1)
+			continue;
+		Thing* thing = pool.Get(handles[i]);
+		CHECK(pool.GetSlot(thing) == handles[i].GetIndex());
+		CHECK(pool.GetBySlot(pool.GetSlot(thing)) == thing);
+	}
+}
+
+void RunHandlePoolTests()
+{
+	RejectsStaleHandle();
+	ReusesSlotWithNewGeneration();
+	GenerationWrapsPastZero();
+	SlotsRoundTrip();
+}
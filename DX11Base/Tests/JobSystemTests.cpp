@@ -0,0 +1,72 @@
+#include "Test.h"
+#include "../JobSystem.h"
+
+#include <thread>
+#include <vector>
+
+static void CountJob(void* data, unsigned int begin, unsigned int end)
+{
+	((std::atomic<int>*)data)->fetch_add(1);
+}
+
+// Far more jobs queued than there are slots in a ring - the
+// ones that don't fit run inline, and none are lost or run twice
+static void RunsPastRingCapacity()
+{
+	JobSystem jobSystem(4);
+	const int jobCount = WorkStealingQueue::Capacity * 3;
+	std::atomic<int> ran(0);
+	JobCounter counter(0);
+	for (int i = 0; i < jobCount; i++)
+		jobSystem.Run(CountJob, &ran, &counter);
+	jobSystem.Wait(&counter);
+	CHECK(ran.load() == jobCount);
+	CHECK(counter.load() == 0);
+}
+
+// Same again from a thread the job system doesn't know about,
+// which goes through the shared queue
+static void RunsPastSharedCapacity()
+{
+	JobSystem jobSystem(4);
+	const int jobCount = WorkStealingQueue::Capacity * 3;
+	std::atomic<int> ran(0);
+	std::thread outsider([&jobSystem, &ran, jobCount]()
+	{
+		JobCounter counter(0);
+		for (int i = 0; i < jobCount; i++)
+			jobSystem.Run(CountJob, &ran, &counter);
+		jobSystem.Wait(&counter);
+	});
+	outsider.join();
+	CHECK(ran.load() == jobCount);
+}
+
+// A grain of 1 splits into far more ranges than a ring holds
+static void ParallelForCoversEveryIndex()
+{
+	JobSystem jobSystem(4);
+	const unsigned int count = WorkStealingQueue::Capacity * 8;
+	std::vector<std::atomic<int>> hits(count);
+	for (unsigned int i = 0; i < count; i++)
+		hits[i].store(0);
+
+	auto visit = [&hits](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			hits[i].fetch_add(1);
+	};
+	jobSystem.ParallelFor(count, 1, visit);
+
+	unsigned int wrong = 0;
+	for (unsigned int i = 0; i < count; i++)
+		wrong += hits[i].load() == 1 ? 0 : 1;
+	CHECK(wrong == 0);
+}
+
+void RunJobSystemTests()
+{
+	RunsPastRingCapacity();
+	RunsPastSharedCapacity();
+	ParallelForCoversEveryIndex();
+}
@@ -0,0 +1,52 @@
+#include "Test.h"
+#include "../LinearArena.h"
+
+#include <cstdint>
+#include <cstring>
+
+static void AlignsAndSpills()
+{
+	LinearArena arena(256);
+	char* first = (char*)arena.Allocate(3, 1);
+	void* aligned = arena.Allocate(8, 64);
+	CHECK(first != 0 && aligned != 0);
+	CHECK(((uintptr_t)aligned & 63) == 0);
+	CHECK(arena.GetOverflowCount() == 0);
+
+	// Past the end of the block, into a spill
+	void* spilled = arena.Allocate(512);
+	CHECK(spilled != 0);
+	CHECK(arena.GetOverflowCount() == 1);
+
+	// The next Reset makes one block big enough for all of it
+	arena.Reset();
+	CHECK(arena.GetOverflowCount() == 0);
+	CHECK(arena.GetCapacity() >= 512);
+}
+
+// A block the heap can't supply leaves the arena empty rather
+// than pointing it at address zero, so allocations spill onto
+// the heap and come back null only if that fails too
+static void SurvivesFailedBlock()
+{
+	const size_t huge = ~(size_t)0 / 2;
+	LinearArena arena(huge);
+	CHECK(arena.GetCapacity() == 0);
+
+	char* a = (char*)arena.Allocate(64);
+	char* b = (char*)arena.Allocate(64);
+	CHECK(a != 0 && b != 0 && a != b);
+	if (a && b)
+	{
+		memset(a, 1, 64);
+		memset(b, 2, 64);
+		CHECK(a[63] == 1 && b[0] == 2);
+	}
+	CHECK(arena.Allocate(huge) == 0);
+}
+
+void RunLinearArenaTests()
+{
+	AlignsAndSpills();
+	SurvivesFailedBlock();
+}
@@ -0,0 +1,99 @@
+#include "Test.h"
+#include "../OcclusionCuller.h"
+
+#include <cstdio>
+#include <vector>
+
+// A 4x4 wall, half a unit thick, straight ahead of a camera at
+// the origin looking down +z
+static void DrawWall(OcclusionCuller& culler, JobSystem& jobSystem)
+{
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(0.785f, 5.0f / 3.0f, 0.1f, 100.0f);
+	culler.Begin(XMMatrixMultiply(view, projection));
+	culler.AddOccluderBox(XMFLOAT3(-2.0f, -2.0f, 4.75f), XMFLOAT3(2.0f, 2.0f, 5.25f), XMMatrixIdentity());
+	culler.Rasterize(jobSystem);
+}
+
+static bool IsVisible(const OcclusionCuller& culler, float x, float y, float z, float halfSize)
+{
+	return culler.IsVisible(XMFLOAT3(x - halfSize, y - halfSize, z - halfSize), XMFLOAT3(x + halfSize, y + halfSize, z + halfSize));
+}
+
+static void HidesBehindOccluder()
+{
+	JobSystem jobSystem(2);
+	OcclusionCuller culler;
+	DrawWall(culler, jobSystem);
+	CHECK(culler.GetTriangleCount() == 12);
+
+	CHECK(!IsVisible(culler, 0.0f, 0.0f, 10.0f, 0.5f));		// Right behind the wall
+	CHECK(!IsVisible(culler, 0.5f, 0.5f, 8.0f, 0.3f));
+	CHECK(IsVisible(culler, 0.0f, 0.0f, 3.0f, 0.5f));		// In front of it
+	CHECK(IsVisible(culler, 6.0f, 0.0f, 10.0f, 0.5f));		// Off to the side
+	CHECK(IsVisible(culler, 2.5f, 0.0f, 10.0f, 1.5f));		// Poking out past its edge
+	CHECK(IsVisible(culler, 0.0f, 0.0f, -3.0f, 0.5f));		// Behind the camera
+}
+
+// Both rasterizers must write exactly the same depth.  Where the
+// CPU has no AVX2 this only compares the 4-wide path with itself.
+static void RasterizersAgree()
+{
+	JobSystem jobSystem(2);
+	OcclusionCuller fourWide, avx2;
+	fourWide.EnableAVX2(false);
+	CHECK(!fourWide.IsUsingAVX2());
+	avx2.EnableAVX2(true);
+	DrawWall(fourWide, jobSystem);
+	DrawWall(avx2, jobSystem);
+
+	unsigned int differences = 0, covered = 0;
+	for (unsigned int y = 0; y < fourWide.GetHeight(); y++)
+	{
+		for (unsigned int x = 0; x < fourWide.GetWidth(); x++)
+		{
+			differences += fourWide.GetDepth(x, y) != avx2.GetDepth(x, y) ? 1 : 0;
+			covered += fourWide.GetDepth(x, y) < 1.0f ? 1 : 0;
+		}
+	}
+	CHECK(differences == 0);
+	CHECK(covered > 0);
+}
+
+// The dump is a binary PGM - a header, then a byte per pixel
+static void DumpsDepth()
+{
+	JobSystem jobSystem(1);
+	OcclusionCuller culler;
+	DrawWall(culler, jobSystem);
+
+	const char* fileName = "occlusion_test_depth.pgm";
+	CHECK(culler.DumpDepth(fileName));
+
+	FILE* file = fopen(fileName, "rb");
+	CHECK(file != 0);
+	if (!file)
+		return;
+
+	unsigned int width = 0, height = 0, maxValue = 0;
+	CHECK(fscanf(file, "P5 %u %u %u", &width, &height, &maxValue) == 3);
+	CHECK(width == culler.GetWidth() && height == culler.GetHeight() && maxValue == 255);
+	fgetc(file);
+
+	std::vector<unsigned char> pixels(width * height);
+	CHECK(fread(pixels.data(), 1, pixels.size(), file) == pixels.size());
+	fclose(file);
+	remove(fileName);
+
+	// The wall is the nearest thing, so the middle is white and
+	// the empty corner black
+	CHECK(pixels[(height / 2) * width + width / 2] > 0);
+	CHECK(pixels[0] == 0);
+}
+
+void RunOcclusionCullerTests()
+{
+	HidesBehindOccluder();
+	RasterizersAgree();
+	DumpsDepth();
+}
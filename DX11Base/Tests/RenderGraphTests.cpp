@@ -0,0 +1,99 @@
+#include "Test.h"
+#include "../RenderGraph.h"
+
+static const RenderGraph::TextureDesc colorDesc = { 1280, 720, DXGI_FORMAT_R32G32B32A32_FLOAT, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+static const RenderGraph::TextureDesc depthDesc = { 1280, 720, DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE };
+static const RenderGraph::TextureDesc backBufferDesc = { 1280, 720, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET };
+
+// --------------------------------------------------------
+// A made up frame on the null backend - one pass nothing
+// reads, and targets whose lifetimes don't overlap
+// --------------------------------------------------------
+static void CullsAliasesAndRuns()
+{
+	NullGraphBackend backend;
+	RenderGraph graph;
+	RenderGraph::Texture noTexture = {};
+
+	unsigned int position = graph.CreateTexture("Position", colorDesc);
+	unsigned int normal = graph.CreateTexture("Normal", colorDesc);
+	unsigned int blurA = graph.CreateTexture("Blur A", colorDesc);
+	unsigned int blurB = graph.CreateTexture("Blur B", colorDesc);
+	unsigned int debug = graph.CreateTexture("Debug", colorDesc);
+	unsigned int depth = graph.CreateTexture("Depth", depthDesc);
+	unsigned int backBuffer = graph.ImportTexture("Back buffer", backBufferDesc, noTexture);
+
+	unsigned int executed = 0;
+	auto run = [&executed]() { executed++; };
+
+	unsigned int gBufferPass = graph.AddPass("G-buffer", run);
+	graph.WriteColor(gBufferPass, position, true);
+	graph.WriteColor(gBufferPass, normal, true);
+	graph.WriteDepth(gBufferPass, depth, true);
+
+	unsigned int blurPass = graph.AddPass("Blur", run);
+	graph.Read(blurPass, position);
+	graph.WriteColor(blurPass, blurA, true);
+
+	unsigned int debugPass = graph.AddPass("Debug view", run);
+	graph.Read(debugPass, normal);
+	graph.WriteColor(debugPass, debug, true);
+
+	unsigned int lightingPass = graph.AddPass("Lighting", run);
+	graph.Read(lightingPass, blurA);
+	graph.Read(lightingPass, normal);
+	graph.WriteColor(lightingPass, backBuffer, true);
+	graph.WriteDepth(lightingPass, depth, false);
+
+	unsigned int postPass = graph.AddPass("Post", run);
+	graph.Read(postPass, position);
+	graph.WriteColor(postPass, blurB, true);
+
+	unsigned int finalPass = graph.AddPass("Final", run);
+	graph.Read(finalPass, blurB);
+	graph.WriteColor(finalPass, backBuffer, false);
+
+	CHECK(graph.Compile(&backend));
+
+	// Nothing reads the debug view, so it and its target go
+	CHECK(graph.IsPassCulled(debugPass));
+	CHECK(!graph.IsPassCulled(gBufferPass));
+	CHECK(!graph.IsPassCulled(finalPass));
+	CHECK(graph.GetPhysicalIndex(debug) == RenderGraph::InvalidHandle);
+
+	// Blur B is only written once Blur A and Normal are done
+	// with, so it takes over one of their textures
+	unsigned int blurBTexture = graph.GetPhysicalIndex(blurB);
+	CHECK(blurBTexture == graph.GetPhysicalIndex(blurA) || blurBTexture == graph.GetPhysicalIndex(normal));
+	CHECK(graph.GetStats().transientCount == 5);
+	CHECK(graph.GetStats().physicalCount == 4);
+	CHECK(graph.GetStats().aliasedBytes < graph.GetStats().unaliasedBytes);
+
+	graph.Execute();
+	CHECK(executed == 5);
+	CHECK(backend.GetPassesBegun() == 5);
+	CHECK(backend.GetLiveTextureCount() == 4);
+
+	// Recompiling the same graph releases what it made before
+	CHECK(graph.Compile(&backend));
+	CHECK(backend.GetLiveTextureCount() == 4);
+}
+
+// A transient read before anything writes it can't compile
+static void RejectsUnwrittenRead()
+{
+	NullGraphBackend backend;
+	RenderGraph graph;
+
+	unsigned int unwritten = graph.CreateTexture("Unwritten", colorDesc);
+	unsigned int readPass = graph.AddPass("Reader", []() {});
+	graph.Read(readPass, unwritten);
+	graph.SetSideEffects(readPass);
+	CHECK(!graph.Compile(&backend));
+}
+
+void RunRenderGraphTests()
+{
+	CullsAliasesAndRuns();
+	RejectsUnwrittenRead();
+}
@@ -0,0 +1,121 @@
+#include "Test.h"
+#include "../ShadowCascades.h"
+#include "../FrustumCuller.h"
+
+#include <vector>
+
+static const float NearZ = 0.1f;
+static const float FarZ = 100.0f;
+static const unsigned int Resolution = 1024;
+
+static XMMATRIX CameraView(float x, float y, float z)
+{
+	return XMMatrixLookToLH(XMVectorSet(x, y, z, 0), XMVectorSet(0.3f, -0.2f, 1, 0), XMVectorSet(0, 1, 0, 0));
+}
+
+static XMMATRIX CameraProjection()
+{
+	return XMMatrixPerspectiveFovLH(0.785f, 16.0f / 9.0f, NearZ, FarZ);
+}
+
+static XMVECTOR LightDirection()
+{
+	return XMVectorSet(1.0f, -2.0f, 0.5f, 0);
+}
+
+// The light view has no translation and an orthonormal rotation,
+// so a cascade's size in world units comes from how much its
+// matrix scales x.  Where world (0, 0, 0) lands, in its _41 and
+// _42, gives its offset in light space.
+static float CascadeSize(const XMFLOAT4X4& viewProjection)
+{
+	const XMFLOAT4X4& m = viewProjection;
+	return 2.0f / sqrtf(m._11 * m._11 + m._21 * m._21 + m._31 * m._31);
+}
+
+static void SplitEndpoints()
+{
+	const float lambdas[3] = { 0.0f, 0.8f, 1.0f };
+	for (float lambda : lambdas)
+	{
+		float splits[ShadowCascades::MaxCascades + 1];
+		ShadowCascades::ComputeSplits(NearZ, FarZ, 4, lambda, splits);
+		CHECK(splits[0] == NearZ);
+		CHECK(splits[4] == FarZ);
+		for (unsigned int i = 0; i < 4; i++)
+			CHECK(splits[i] < splits[i + 1]);
+	}
+
+	// Lambda 0 is evenly spaced, lambda 1 a constant ratio apart
+	float uniform[5], logarithmic[5];
+	ShadowCascades::ComputeSplits(NearZ, FarZ, 4, 0.0f, uniform);
+	ShadowCascades::ComputeSplits(NearZ, FarZ, 4, 1.0f, logarithmic);
+	for (unsigned int i = 1; i < 4; i++)
+	{
+		CHECK_NEAR(uniform[i], NearZ + (FarZ - NearZ) * i / 4.0f, 1e-4);
+		CHECK_NEAR(logarithmic[i + 1] / logarithmic[i], logarithmic[1] / logarithmic[0], 1e-3);
+	}
+}
+
+// Small camera moves only ever shift each cascade by whole
+// shadow map texels, and never change its size
+static void SnapsToTexels()
+{
+	ShadowCascades cascades(4, Resolution);
+	cascades.Fit(CameraView(0, 2, -5), CameraProjection(), LightDirection());
+	float sizes[ShadowCascades::MaxCascades];
+	for (unsigned int c = 0; c < cascades.GetCascadeCount(); c++)
+		sizes[c] = CascadeSize(cascades.GetCascade(c).viewProjection);
+
+	for (int step = 1; step <= 20; step++)
+	{
+		cascades.Fit(CameraView(0.013f * step, 2.0f + 0.007f * step, -5.0f + 0.021f * step), CameraProjection(), LightDirection());
+		for (unsigned int c = 0; c < cascades.GetCascadeCount(); c++)
+		{
+			const XMFLOAT4X4& viewProjection = cascades.GetCascade(c).viewProjection;
+			CHECK_NEAR(CascadeSize(viewProjection), sizes[c], sizes[c] * 1e-5);
+
+			// The origin in texels, which must be a whole number
+			float texelsX = viewProjection._41 * Resolution * 0.5f;
+			float texelsY = viewProjection._42 * Resolution * 0.5f;
+			CHECK_NEAR(texelsX, floorf(texelsX + 0.5f), 0.01);
+			CHECK_NEAR(texelsY, floorf(texelsY + 0.5f), 0.01);
+		}
+	}
+}
+
+// Casters are culled against the cascade's box, except toward
+// the light - anything up there can still cast into it
+static void KeepsCastersTowardLight()
+{
+	ShadowCascades cascades(4, Resolution);
+	cascades.Fit(CameraView(0, 2, -5), CameraProjection(), LightDirection());
+	const ShadowCascades::Cascade& cascade = cascades.GetCascade(0);
+
+	// The middle of the cascade's box, and how far it reaches
+	XMMATRIX inverse = XMMatrixInverse(0, XMLoadFloat4x4(&cascade.viewProjection));
+	XMVECTOR center = XMVector3TransformCoord(XMVectorSet(0, 0, 0.5f, 1), inverse);
+	float reach = CascadeSize(cascade.viewProjection);
+	XMVECTOR direction = XMVector3Normalize(LightDirection());
+
+	XMFLOAT3 positions[3];
+	XMStoreFloat3(&positions[0], center);
+	XMStoreFloat3(&positions[1], XMVectorSubtract(center, XMVectorScale(direction, reach * 2.0f)));	// Toward the light
+	XMStoreFloat3(&positions[2], XMVectorAdd(center, XMVectorScale(direction, reach * 2.0f)));		// Past the far side
+
+	JobSystem jobSystem(1);
+	FrustumCuller culler;
+	for (const XMFLOAT3& position : positions)
+		culler.Add(XMFLOAT3(position.x - 0.5f, position.y - 0.5f, position.z - 0.5f), XMFLOAT3(position.x + 0.5f, position.y + 0.5f, position.z + 0.5f));
+
+	std::vector<unsigned int> visible;
+	culler.Cull(cascade.casterPlanes, jobSystem, visible);
+	CHECK(visible.size() == 2 && visible[0] == 0 && visible[1] == 1);
+}
+
+void RunShadowCascadesTests()
+{
+	SplitEndpoints();
+	SnapsToTexels();
+	KeepsCastersTowardLight();
+}
@@ -0,0 +1,87 @@
+#include "Test.h"
+#include "../SphereProjection.h"
+
+// A 90 degree field of view on a square screen, so one unit
+// sideways at one unit deep is the edge of the screen
+static const float ProjScale = 1.0f;
+static const float NearZ = 0.1f;
+static const float ScreenSize = 100.0f;
+
+// Where a view direction tan(angle) lands, in pixels from the left
+static double ToPixels(double tangent)
+{
+	return (tangent * 0.5 + 0.5) * ScreenSize;
+}
+
+// Angle of the line from the eye to where it touches the circle
+static double TangentAngle(double c, double cz, double radius, int side)
+{
+	return atan2(c, cz) + side * asin(radius / sqrt(c * c + cz * cz));
+}
+
+static void CenteredOnAxis()
+{
+	ScreenRect rect;
+	CHECK(ProjectSphere(0.0f, 0.0f, 10.0f, 1.0f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+
+	// Symmetric about the middle, and slightly wider than the
+	// naive radius / depth since the tangents touch nearer in
+	double halfWidth = 1.0 / sqrt(99.0);
+	CHECK_NEAR(rect.left, ToPixels(-halfWidth), 1e-3);
+	CHECK_NEAR(rect.right, ToPixels(halfWidth), 1e-3);
+	CHECK_NEAR(rect.top, ToPixels(-halfWidth), 1e-3);
+	CHECK_NEAR(rect.bottom, ToPixels(halfWidth), 1e-3);
+	CHECK(rect.right - rect.left > 0.1f * ScreenSize);
+}
+
+static void OffAxis()
+{
+	ScreenRect rect;
+	CHECK(ProjectSphere(5.0f, 0.0f, 10.0f, 1.0f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+
+	// Off to the side the rectangle stretches away from the middle
+	CHECK_NEAR(rect.left, ToPixels(tan(TangentAngle(5.0, 10.0, 1.0, -1))), 1e-3);
+	CHECK_NEAR(rect.right, ToPixels(tan(TangentAngle(5.0, 10.0, 1.0, 1))), 1e-3);
+	CHECK(rect.right - ToPixels(0.5) > ToPixels(0.5) - rect.left);
+
+	// Still centered vertically
+	CHECK_NEAR(rect.top + rect.bottom, ScreenSize, 1e-3);
+}
+
+static void CrossingNearPlane()
+{
+	// Straddles the near plane off to the right.  The left edge is
+	// still a tangent line; the right is where the near plane cuts
+	// the sphere, far past the edge of the screen.
+	float ndcMin, ndcMax;
+	CHECK(ProjectSphereAxis(0.5f, 0.5f, 0.6f, NearZ, ProjScale, ndcMin, ndcMax));
+	CHECK_NEAR(ndcMin, tan(TangentAngle(0.5, 0.5, 0.6, -1)), 1e-4);
+	CHECK_NEAR(ndcMax, (0.5 + sqrt(0.6 * 0.6 - 0.4 * 0.4)) / NearZ, 1e-3);
+
+	ScreenRect rect;
+	CHECK(ProjectSphere(0.5f, 0.0f, 0.5f, 0.6f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+	CHECK_NEAR(rect.left, ToPixels(tan(TangentAngle(0.5, 0.5, 0.6, -1))), 1e-3);
+	CHECK_NEAR(rect.right, ScreenSize, 1e-4);
+
+	// The eye is inside it vertically, so it covers the full height
+	CHECK_NEAR(rect.top, 0.0, 1e-4);
+	CHECK_NEAR(rect.bottom, ScreenSize, 1e-4);
+}
+
+static void BehindCamera()
+{
+	ScreenRect rect;
+	CHECK(!ProjectSphere(0.0f, 0.0f, -5.0f, 1.0f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+	CHECK(!ProjectSphere(3.0f, -2.0f, -5.0f, 1.0f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+
+	// In front of the eye but not reaching the near plane
+	CHECK(!ProjectSphere(0.0f, 0.0f, 0.05f, 0.04f, ProjScale, ProjScale, NearZ, ScreenSize, ScreenSize, rect));
+}
+
+void RunSphereProjectionTests()
+{
+	CenteredOnAxis();
+	OffAxis();
+	CrossingNearPlane();
+	BehindCamera();
+}
@@ -0,0 +1,80 @@
+#include "Test.h"
+#include "../StateCache.h"
+
+#include <cstdint>
+
+// Stand-ins for device objects - nothing here looks through them
+template <typename T>
+static T* Fake(uintptr_t address)
+{
+	return (T*)address;
+}
+
+static void FiltersRepeats()
+{
+	RecordingStateTarget target;
+	StateCache cache(&target);
+	float blendFactor[4] = { 1, 1, 1, 1 };
+
+	// Ten identical "draws" - the second blend state only differs
+	// by its factor, which doesn't matter without a blend state
+	for (int i = 0; i < 10; i++)
+	{
+		cache.SetVertexShader(Fake<ID3D11VertexShader>(0x10));
+		cache.SetPixelShader(Fake<ID3D11PixelShader>(0x20));
+		cache.SetConstantBuffer(PixelStage, 0, Fake<ID3D11Buffer>(0x30));
+		cache.SetShaderResource(PixelStage, 0, Fake<ID3D11ShaderResourceView>(0x40));
+		cache.SetVertexBuffer(0, Fake<ID3D11Buffer>(0x30), 44, 0);
+		cache.SetBlendState(0, blendFactor, ~0u);
+		cache.SetBlendState(0, 0, ~0u);
+	}
+	CHECK(target.GetCalls().size() == 6);
+	CHECK(cache.GetIssuedCount() == 6);
+	CHECK(cache.GetFilteredCount() == 64);
+}
+
+static void PassesChanges()
+{
+	RecordingStateTarget target;
+	StateCache cache(&target);
+	ID3D11Buffer* buffer = Fake<ID3D11Buffer>(0x30);
+	ID3D11ShaderResourceView* srv = Fake<ID3D11ShaderResourceView>(0x40);
+
+	// A different stride, or the same view on another stage, is a change
+	cache.SetVertexBuffer(0, buffer, 44, 0);
+	cache.SetVertexBuffer(0, buffer, 32, 0);
+	CHECK(target.CountCalls(RecordingStateTarget::VertexBufferCall) == 2);
+	cache.SetShaderResource(PixelStage, 0, srv);
+	cache.SetShaderResource(VertexStage, 0, srv);
+	CHECK(target.CountCalls(RecordingStateTarget::ShaderResourceCall) == 2);
+
+	// Binding targets unbinds conflicting views, so they go through again
+	cache.SetRenderTargets(0, 0, 0);
+	cache.SetShaderResource(PixelStage, 0, srv);
+	CHECK(target.CountCalls(RecordingStateTarget::ShaderResourceCall) == 3);
+
+	// Slots past the tracked range always go through
+	cache.SetShaderResource(PixelStage, StateCache::SlotCount + 4, srv);
+	cache.SetShaderResource(PixelStage, StateCache::SlotCount + 4, srv);
+	CHECK(target.CountCalls(RecordingStateTarget::ShaderResourceCall) == 5);
+}
+
+static void InvalidateForgetsEverything()
+{
+	RecordingStateTarget target;
+	StateCache cache(&target);
+
+	cache.SetVertexShader(Fake<ID3D11VertexShader>(0x10));
+	cache.SetVertexShader(Fake<ID3D11VertexShader>(0x10));
+	CHECK(target.CountCalls(RecordingStateTarget::VertexShaderCall) == 1);
+	cache.Invalidate();
+	cache.SetVertexShader(Fake<ID3D11VertexShader>(0x10));
+	CHECK(target.CountCalls(RecordingStateTarget::VertexShaderCall) == 2);
+}
+
+void RunStateCacheTests()
+{
+	FiltersRepeats();
+	PassesChanges();
+	InvalidateForgetsEverything();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Bare bones checks for the headless tests
+//
+// A failed check prints where it failed and carries on, so
+// one run reports everything that's broken.  The test
+// executable exits nonzero if anything failed.
+// --------------------------------------------------------
+extern int testFailures;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); testFailures++; } } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { double a_ = (actual), e_ = (expected); if (fabs(a_ - e_) > (tolerance)) { \
+		printf("%s(%d): CHECK_NEAR(%s, %s) failed - %f vs %f\n", __FILE__, __LINE__, #actual, #expected, a_, e_); testFailures++; } } while (0)
+
+// One of these per test file
+void RunCommandBufferTests();
+void RunHandlePoolTests();
+void RunJobSystemTests();
+void RunLinearArenaTests();
+void RunSphereProjectionTests();
+
+// These need DirectXMath
+void RunDepthPyramidTests();
+void RunOcclusionCullerTests();
+void RunShadowCascadesTests();
+
+// These need the D3D11 headers, though never a device
+void RunStateCacheTests();
+void RunRenderGraphTests();
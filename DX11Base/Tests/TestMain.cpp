@@ -0,0 +1,29 @@
+#include "Test.h"
+
+int testFailures = 0;
+
+int main()
+{
+	RunCommandBufferTests();
+	RunHandlePoolTests();
+	RunJobSystemTests();
+	RunLinearArenaTests();
+	RunSphereProjectionTests();
+#if defined(HAVE_DIRECTXMATH)
+	RunDepthPyramidTests();
+	RunOcclusionCullerTests();
+	RunShadowCascadesTests();
+#endif
+#if defined(HAVE_D3D11)
+	RunStateCacheTests();
+	RunRenderGraphTests();
+#endif
+
+	if (testFailures > 0)
+	{
+		printf("%d check(s) failed\n", testFailures);
+		return 1;
+	}
+	printf("All tests passed\n");
+	return 0;
+}